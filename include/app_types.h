@@ -1,29 +1,88 @@
 #pragma once
 
-#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 constexpr size_t kMaxPoints = 240;
+constexpr size_t kStateErrorLen = 48;
+constexpr size_t kStateSourceLen = 12;
+constexpr size_t kStateCurrencyLen = 8;
+constexpr size_t kStateAreaLen = 8;
 
+#ifndef CONFIG_NORDPOOL_MAX_AREAS
+#define CONFIG_NORDPOOL_MAX_AREAS 2
+#endif
+// Areas fetched in one request: the primary area plus up to
+// kMaxAreas - 1 extra areas, clamped to 1..4.
+constexpr size_t kMaxAreas =
+    CONFIG_NORDPOOL_MAX_AREAS < 1 ? 1 : (CONFIG_NORDPOOL_MAX_AREAS > 4 ? 4 : CONFIG_NORDPOOL_MAX_AREAS);
+constexpr size_t kMaxExtraAreas = kMaxAreas - 1;
+// AreaSeries::rawPrices value for a slot the area has no price for.
+constexpr int32_t kNoAreaPrice = INT32_MIN;
+
+// Stored as uint8_t in PricePoint and in the on-flash cache; keep values stable.
+enum class PriceLevel : uint8_t {
+  Unknown = 0,
+  VeryCheap = 1,
+  Cheap = 2,
+  Normal = 3,
+  Expensive = 4,
+  VeryExpensive = 5,
+};
+
+// Prices are fixed-point per kWh (1/100 minor unit, see price_fixed.h).
 struct PricePoint {
-  String startsAt;
-  String level;
-  float price = 0.0f;
-  float rawPricePerKwh = 0.0f;
+  uint32_t startsAt = 0;  // UTC epoch seconds of slot start
+  int32_t price = 0;      // with VAT and fixed cost
+  int32_t rawPrice = 0;   // market price as published
+  PriceLevel level = PriceLevel::Unknown;
   bool hasRawPrice = false;
 };
 
+// Raw prices of an extra area on the primary series' timeline: rawPrices[i]
+// belongs to points[i].startsAt. Levels, history and the moving average
+// stay with the primary area.
+struct AreaSeries {
+  char area[kStateAreaLen] = "";
+  int32_t rawPrices[kMaxPoints];
+};
+
+// Plain data only: copying a PriceState is a memcpy and never touches the heap.
 struct PriceState {
   bool ok = false;
-  String error;
-  String source = "UNKNOWN";
+  char error[kStateErrorLen] = "";
+  char source[kStateSourceLen] = "UNKNOWN";
+  char area[kStateAreaLen] = "";
   bool hasRunningAverage = false;
-  float runningAverage = 0.0f;
-  String currency = "SEK";
+  int32_t runningAverage = 0;
+  char currency[kStateCurrencyLen] = "SEK";
   uint16_t resolutionMinutes = 60;
-  String currentStartsAt;
-  String currentLevel = "UNKNOWN";
-  float currentPrice = 0.0f;
+  // Slot index: when slotsUniform is set, points[i].startsAt ==
+  // slotBaseStartsAt + i * resolutionMinutes * 60 for every point.
+  uint32_t slotBaseStartsAt = 0;
+  bool slotsUniform = false;
+  uint32_t currentStartsAt = 0;
+  PriceLevel currentLevel = PriceLevel::Unknown;
+  int32_t currentPrice = 0;
   int currentIndex = -1;
+  // priceStateFingerprint() of the points and running average, refreshed
+  // whenever prices or levels are (re)computed. 0 for an empty state.
+  uint32_t fingerprint = 0;
   size_t count = 0;
   PricePoint points[kMaxPoints];
+  uint8_t extraAreaCount = 0;
+  AreaSeries extraAreas[kMaxExtraAreas > 0 ? kMaxExtraAreas : 1];
 };
+
+template <size_t N>
+inline void copyStateText(char (&dst)[N], const char *src) {
+  if (src == nullptr) src = "";
+  strncpy(dst, src, N - 1);
+  dst[N - 1] = '\0';
+}
+
+template <size_t N>
+inline bool stateTextEquals(const char (&text)[N], const char *other) {
+  return strncmp(text, other != nullptr ? other : "", N) == 0;
+}
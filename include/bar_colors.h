@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "app_types.h"
+
+// Chart bar colours in RGB565. A bar keeps its level's hue and shades toward
+// the neighbouring levels' hues across that level's price band; a bar with
+// no level falls back to one gradient over the whole chart range. Integer
+// math only, so the same prices always give the same colours.
+
+constexpr size_t kLevelBandCount = 5;  // VeryCheap..VeryExpensive
+// Spans below this (0.001 per kWh) are treated as flat.
+constexpr int32_t kMinBandSpan = 10;
+
+// Price range of the points at one level.
+struct LevelBand {
+  bool has = false;
+  int32_t minPrice = 0;
+  int32_t maxPrice = 0;
+};
+
+uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b);
+// The unshaded colour of a level; white for Unknown.
+uint16_t levelColor(PriceLevel level);
+void computeLevelBands(const PriceState &state, LevelBand bands[kLevelBandCount]);
+// rangeMin/rangeSpan are the chart's price range, used by the fallback gradient.
+uint16_t barGradientColor(
+    const PricePoint &point,
+    const LevelBand bands[kLevelBandCount],
+    int32_t rangeMin,
+    int32_t rangeSpan);
@@ -1,9 +1,19 @@
 #pragma once
 
 #include "app_types.h"
+#include "history_view.h"
+#include "price_fixed.h"
 
 void displayInit();
 void displayDrawPrices(const PriceState &state);
+// Width in pixels of the chart; one HistoryView column per pixel.
+int displayChartWidth();
+// The multi-day history page. Currency and running average come from state;
+// columns hold raw prices, so formula turns them into displayed prices.
+void displayDrawHistory(const HistoryView &view, const PriceState &state, const PriceFormula &formula);
 void displayRefreshClock();
+// A status line shown above the chart until cleared with nullptr; takes
+// effect on the next draw.
+void displaySetNotice(const char *text);
 void displayDrawWifiConfigPortal(const char *apName, uint16_t timeoutSeconds);
 void displayDrawWifiConfigTimeout(uint16_t timeoutSeconds);
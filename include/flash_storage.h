@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <stdint.h>
+
+// Shared flash filesystem for the price cache, moving-average store and
+// price history. Owns the single mount, does crash-safe whole-file
+// replacement and counts I/O.
+
+#ifndef CONFIG_STORAGE_LITTLEFS
+#define CONFIG_STORAGE_LITTLEFS 0
+#endif
+
+struct StorageChunk {
+  const void *data = nullptr;
+  size_t len = 0;
+};
+
+// Counters are plain increments; both tasks doing I/O at once can lose a count.
+struct StorageStats {
+  uint32_t reads = 0;
+  uint32_t bytesRead = 0;
+  uint32_t readUs = 0;
+  uint32_t writes = 0;
+  uint32_t bytesWritten = 0;
+  uint32_t writeUs = 0;
+  uint32_t replaces = 0;
+  uint32_t recoveries = 0;  // finished temp files promoted after an interrupted replace
+};
+
+// Mounts once (formatting an unreadable partition); later calls return the result.
+bool storageMount();
+fs::FS &storageFs();
+const char *storageName();
+
+// Opening for read first finishes a replace of `path` that a reset
+// interrupted after the old file was removed.
+File storageOpen(const char *path, const char *mode);
+size_t storageRead(File &file, void *data, size_t len);
+size_t storageWrite(File &file, const void *data, size_t len);
+bool storageExists(const char *path);
+size_t storageFileSize(const char *path);
+// True when the file is gone afterwards, including when it never existed.
+bool storageRemove(const char *path);
+// Appends `len` bytes in one open/write/close.
+bool storageAppend(const char *path, const void *data, size_t len);
+
+// "<path>.tmp", the temp name storageCommit() expects.
+void storageTempPath(const char *path, char *out, size_t outSize);
+// Replaces `path` with the fully written and closed `tempPath`.
+bool storageCommit(const char *tempPath, const char *path);
+// Writes the chunks to the temp path, then commits. A reset at any point
+// leaves either the old or the new file readable.
+bool storageWriteAtomic(const char *path, const StorageChunk *chunks, size_t count);
+
+StorageStats storageStats();
+void storageLogStats();
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_HISTORY_VIEW_DAYS
+#define CONFIG_HISTORY_VIEW_DAYS 0
+#endif
+
+// Days the history page spans, ending with the newest recorded slot, at
+// most 14. The page is opt-in: 0 (the default) leaves it out.
+constexpr uint16_t kHistoryViewDays = CONFIG_HISTORY_VIEW_DAYS > 14 ? 14 : CONFIG_HISTORY_VIEW_DAYS;
+// Widest chart of the supported displays; no buffer while the page is off.
+constexpr size_t kHistoryViewMaxColumns = kHistoryViewDays > 0 ? 420 : 1;
+
+// Raw prices (fixed-point, before VAT/fixed cost) of every slot that falls
+// into one pixel column.
+struct HistoryColumn {
+  int32_t min = 0;
+  int32_t max = 0;
+  int32_t sum = 0;
+  uint16_t count = 0;
+};
+
+// The long-term price history decimated to one bucket per chart column.
+// Samples are folded in as they are recorded; once one lands past the
+// last column the window slides left by whole columns, so a draw never
+// rescans the series.
+struct HistoryView {
+  uint16_t columnCount = 0;
+  uint32_t secondsPerColumn = 0;
+  uint32_t endsAt = 0;         // UTC end of the last column, 0 while empty
+  uint32_t lastSlotStart = 0;  // newest sample folded in
+  uint32_t revision = 0;       // bumped by every change
+  HistoryColumn columns[kHistoryViewMaxColumns];
+};
+
+void historyViewReset(HistoryView &view, uint16_t columnCount);
+// Adds one slot; samples older than the window or already folded in are
+// ignored.
+void historyViewAdd(HistoryView &view, uint32_t slotStart, int32_t rawPrice);
+// Folds in the samples price_history recorded since the last call; the
+// first call after a reset reads the whole window. Reads flash, so call it
+// only while nothing else writes the history.
+bool historyViewUpdate(HistoryView &view);
+inline uint32_t historyViewStartsAt(const HistoryView &view) {
+  return view.endsAt - (uint32_t)view.columnCount * view.secondsPerColumn;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "app_types.h"
+
+// Optional read-only HTTP endpoint that lets other devices on the LAN reuse
+// the prices this device already fetched: GET /api/prices returns the
+// current PriceState as JSON with an ETag.
+
+#ifndef CONFIG_LAN_API
+#define CONFIG_LAN_API 0
+#endif
+#ifndef CONFIG_LAN_API_PORT
+#define CONFIG_LAN_API_PORT 80
+#endif
+
+// Starts the server task, which listens only while Wi-Fi is connected and
+// reopens the socket after every reconnect. Does nothing when CONFIG_LAN_API
+// is 0.
+bool lanApiStart();
+// Re-serializes the JSON body when `state` differs from what is being
+// served. Cheap when nothing changed; call after every state update.
+void lanApiUpdate(const PriceState &state);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// UTC <-> local time for the two zones timezoneSpecForNordpoolArea selects.
+// Both follow the EU rule (summer time from 01:00 UTC on the last Sunday of
+// March to 01:00 UTC on the last Sunday of October), so the switch epochs
+// are tabulated once and a conversion is an offset add after two compares,
+// instead of re-evaluating the POSIX TZ rule in localtime_r/mktime. Until a
+// known zone is selected, everything falls back to the C library.
+
+constexpr char kTimezoneCetCest[] = "CET-1CEST,M3.5.0/2,M10.5.0/3";
+constexpr char kTimezoneEetEest[] = "EET-2EEST,M3.5.0/3,M10.5.0/4";
+
+// Selects the zone for a CET/CEST or EET/EEST spec; other specs fall back.
+void localTimeSetZone(const char *timezoneSpec);
+// localtime_r equivalent; fills every struct tm field used in this project.
+bool localTimeFromUtc(time_t utc, struct tm &out);
+// mktime equivalent. tm_mday/tm_hour/tm_min/tm_sec may be out of range and
+// roll over; tm_isdst is ignored. A local time that occurs twice resolves to
+// the earlier (summer-time) instant. Returns 0 on failure.
+time_t localTimeToUtc(const struct tm &local);
+// Days since 1970-01-01 for a proleptic Gregorian date (month 1..12).
+int64_t daysFromCivil(int year, unsigned month, unsigned day);
@@ -1,3 +1,56 @@
 #pragma once
 
-void logf(const char *fmt, ...);
+#include <stdint.h>
+
+// Log lines are formatted by the caller and queued in a RAM ring that a
+// low-priority task drains to Serial, so logging never waits on the UART.
+// The newest lines are mirrored to RTC memory and printed on the next boot
+// after a watchdog reset or panic.
+
+#ifndef CONFIG_LOG_LEVEL
+#define CONFIG_LOG_LEVEL 3  // 0 off, 1 error, 2 warn, 3 info, 4 debug
+#endif
+#ifndef CONFIG_LOG_CATEGORIES
+#define CONFIG_LOG_CATEGORIES 0xFF  // bit per LogCategory
+#endif
+
+enum class LogLevel : uint8_t {
+  Error = 1,
+  Warn = 2,
+  Info = 3,
+  Debug = 4,
+};
+
+enum class LogCategory : uint8_t {
+  App = 0,
+  Net,
+  Display,
+  Storage,
+  Power,
+};
+
+constexpr bool logEnabled(LogLevel level, LogCategory category) {
+  return (uint8_t)level <= CONFIG_LOG_LEVEL && (CONFIG_LOG_CATEGORIES & (1u << (uint8_t)category)) != 0;
+}
+
+// Calls below the compile-time threshold, arguments included, are dropped
+// by the compiler.
+#define LOG_AT(level, category, ...)                                       \
+  do {                                                                     \
+    if (logEnabled(LogLevel::level, LogCategory::category)) {              \
+      logWrite(LogLevel::level, LogCategory::category, __VA_ARGS__);       \
+    }                                                                      \
+  } while (0)
+#define LOG_ERROR(category, ...) LOG_AT(Error, category, __VA_ARGS__)
+#define LOG_WARN(category, ...) LOG_AT(Warn, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_AT(Info, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG_AT(Debug, category, __VA_ARGS__)
+
+void logWrite(LogLevel level, LogCategory category, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+// Starts the drain task and prints lines kept from a crashed previous boot.
+// Lines logged before this are queued and printed once it runs.
+void logInit();
+// Writes everything queued to Serial from the calling task, e.g. before a
+// restart or light sleep.
+void logFlush();
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "app_types.h"
+
+// Optional MQTT push of price changes. The current slot is published when
+// it changes and the day-ahead series only when its fingerprint changes,
+// both as retained topics under CONFIG_MQTT_TOPIC_PREFIX. A worker task
+// owns the broker connection; producers only copy into a bounded queue.
+
+#ifndef CONFIG_MQTT
+#define CONFIG_MQTT 0
+#endif
+#ifndef CONFIG_MQTT_HOST
+#define CONFIG_MQTT_HOST ""
+#endif
+#ifndef CONFIG_MQTT_PORT
+#define CONFIG_MQTT_PORT 1883
+#endif
+#ifndef CONFIG_MQTT_USER
+#define CONFIG_MQTT_USER ""
+#endif
+#ifndef CONFIG_MQTT_PASSWORD
+#define CONFIG_MQTT_PASSWORD ""
+#endif
+#ifndef CONFIG_MQTT_CLIENT_ID
+#define CONFIG_MQTT_CLIENT_ID "nordpool-display"
+#endif
+#ifndef CONFIG_MQTT_TOPIC_PREFIX
+#define CONFIG_MQTT_TOPIC_PREFIX "nordpool"
+#endif
+
+// Starts the publisher task. Does nothing when CONFIG_MQTT is 0 or no host is set.
+bool mqttStart();
+// Queues whatever changed since the last call. Never blocks; call after
+// every state update.
+void mqttPublishState(const PriceState &state);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "app_types.h"
+#include "price_fixed.h"
+
+// Network jobs run on a FreeRTOS task pinned to the WiFi core so the
+// Arduino loop task only renders and keeps time. One job is in flight at a
+// time; the request, and the PriceState buffers it names, are handed over
+// through a single atomic phase word instead of a lock.
+
+enum class NetworkJob : uint8_t {
+  None = 0,
+  SyncClock,
+  FetchPrices,
+};
+
+constexpr size_t kNetworkApiUrlLen = 128;
+constexpr size_t kNetworkExtraAreasLen = kMaxAreas * kStateAreaLen;
+
+struct NetworkJobRequest {
+  NetworkJob job = NetworkJob::None;
+  // SyncClock
+  const char *timezoneSpec = nullptr;
+  // FetchPrices. `existing` is only read and its points must stay unchanged
+  // until the job completes; `out` belongs to the worker until then.
+  char apiUrl[kNetworkApiUrlLen] = "";
+  char area[kStateAreaLen] = "";
+  char extraAreas[kNetworkExtraAreasLen] = "";  // comma-separated
+  char currency[kStateCurrencyLen] = "";
+  PriceFormula formula;
+  const PriceState *existing = nullptr;
+  PriceState *out = nullptr;
+};
+
+typedef void (*NetworkJobDoneCallback)();
+
+// Starts the worker. While idle it keeps WiFi connected, reconnecting with
+// `wifiConnectTimeoutMs` whenever the station drops. `onJobDone` (may be
+// null) runs on the worker task after each job, e.g. to wake the loop.
+bool networkWorkerStart(uint32_t wifiConnectTimeoutMs, NetworkJobDoneCallback onJobDone = nullptr);
+// Wakes an idle worker, e.g. from a WiFi disconnect event.
+void networkWorkerWake();
+// Returns false when a job is already queued or running.
+bool networkWorkerSubmit(const NetworkJobRequest &request);
+// Returns the job that just finished (and frees the worker), or None.
+NetworkJob networkWorkerTakeCompleted();
+bool networkWorkerBusy();
+// Milliseconds the current job has been running, 0 when idle.
+uint32_t networkWorkerBusyMs();
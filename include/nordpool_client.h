@@ -1,14 +1,33 @@
 #pragma once
 
 #include "app_types.h"
+#include "price_fixed.h"
 
+// Prices are always fetched, cached and fed to the moving average at this
+// resolution; coarser display resolutions are derived on the device.
+constexpr uint16_t kNordPoolFetchResolutionMinutes = 15;
+
+// Fetches today and tomorrow into `out`, for `area` and the comma-separated
+// `extraAreas` (may be empty) in the same requests. Days that `existing`
+// (may be null) already fully covers for the same areas, currency and
+// resolution are merged in from it instead of being requested again.
 void fetchNordPoolPriceInfo(
     const char *apiBaseUrl,
     const char *area,
+    const char *extraAreas,
     const char *currency,
-    uint16_t resolutionMinutes,
-    float vatPercent,
-    float fixedCostPerKwh,
+    const PriceFormula &formula,
+    const PriceState *existing,
     PriceState &out);
-void nordPoolPreupdateMovingAverageFromPriceInfo(PriceState &state, float vatPercent, float fixedCostPerKwh);
-bool nordPoolRecalculatePricesFromRaw(PriceState &state, float vatPercent, float fixedCostPerKwh);
+void nordPoolPreupdateMovingAverageFromPriceInfo(PriceState &state, const PriceFormula &formula);
+bool nordPoolRecalculatePricesFromRaw(PriceState &state, const PriceFormula &formula);
+// The series for area `areaIndex` (0 primary, 1.. extraAreas) averaged into
+// `resolutionMinutes` slots, levelled against the primary area's moving
+// average and history thresholds. A resolution that is not a coarser
+// multiple of the series' own keeps the fetched slots.
+void nordPoolBuildView(
+    const PriceState &prices,
+    uint8_t areaIndex,
+    uint16_t resolutionMinutes,
+    const PriceFormula &formula,
+    PriceState &view);
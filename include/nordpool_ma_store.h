@@ -1,12 +1,12 @@
 #pragma once
 
-#include <Arduino.h>
+#include <stddef.h>
 #include <stdint.h>
 
 constexpr uint16_t kMovingAverageWindowHours = 72;
 constexpr uint16_t kMaxMovingAverageWindowSamples = kMovingAverageWindowHours * 4;  // 15-minute resolution
 constexpr uint32_t kMovingAverageStoreMagic = 0x4E504D41;  // "NPMA"
-constexpr uint16_t kMovingAverageStoreVersion = 3;
+constexpr uint16_t kMovingAverageStoreVersion = 6;
 
 struct MovingAverageStore {
   uint32_t magic = kMovingAverageStoreMagic;
@@ -15,14 +15,26 @@ struct MovingAverageStore {
   uint16_t windowSamples = kMovingAverageWindowHours;
   uint16_t count = 0;
   uint16_t head = 0;  // next write index
-  char lastSlotKey[20] = {0};  // YYYY-MM-DDTHH or YYYY-MM-DDTHH:MM
-  // Raw market prices in major currency units per kWh.
-  float values[kMaxMovingAverageWindowSamples] = {0.0f};
+  uint32_t lastSlotStart = 0;  // UTC epoch of the newest slot already added
+  // Exact running sum of values[0..count); rebuilt on load.
+  int64_t sum = 0;
+  // Raw market prices, fixed-point per kWh (see price_fixed.h).
+  int32_t values[kMaxMovingAverageWindowSamples] = {0};
+};
+
+struct MovingAverageSample {
+  uint32_t slotStart = 0;
+  int32_t value = 0;
 };
 
 void resetMovingAverageStore(MovingAverageStore &store);
 bool loadMovingAverageStore(MovingAverageStore &store);
+// Rewrites the full snapshot and starts a new, empty sample log.
 bool saveMovingAverageStore(const MovingAverageStore &store);
+// Persists samples that were just added to `store`. Appends them to the sample
+// log, or compacts into a new snapshot once the log grows past one window.
+bool appendMovingAverageSamples(const MovingAverageStore &store, const MovingAverageSample *samples, size_t count);
 bool clearMovingAverageStore();
-void addMovingAverageSample(MovingAverageStore &store, float value);
-float movingAverageValue(const MovingAverageStore &store);
+void addMovingAverageSample(MovingAverageStore &store, uint32_t slotStart, int32_t value);
+// Mean of the window rounded to the nearest price unit; 0 when empty.
+int32_t movingAverageValue(const MovingAverageStore &store);
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded-memory push parser for Nord Pool DayAheadPriceIndices responses.
+// Feed the body in arbitrary chunks; when a multiIndexEntries item with a
+// deliveryStart closes, each of its entryPerArea values for the requested
+// areas is reported through onEntry, in area order. No document is
+// materialised.
+
+constexpr size_t kNordPoolParserMaxDepth = 8;
+constexpr size_t kNordPoolParserTokenLen = 32;
+constexpr size_t kNordPoolParserMaxAreas = 4;
+
+enum class NordPoolParseStatus : uint8_t {
+  InProgress = 0,
+  Done,
+  Error,
+};
+
+// `areaIndex` indexes the list passed to nordPoolParserBegin; `pricePerKwh`
+// is the fixed-point market price (see price_fixed.h).
+typedef void (*NordPoolEntryCallback)(void *ctx, const char *deliveryStart, uint8_t areaIndex, int32_t pricePerKwh);
+
+struct NordPoolStreamParser {
+  const char *areas[kNordPoolParserMaxAreas] = {nullptr};
+  uint8_t areaCount = 0;
+  NordPoolEntryCallback onEntry = nullptr;
+  void *ctx = nullptr;
+
+  NordPoolParseStatus status = NordPoolParseStatus::InProgress;
+  size_t bytesFed = 0;
+  size_t entries = 0;
+  bool unauthorized = false;
+  char currency[8] = "";
+
+  // Tokenizer state.
+  uint8_t depth = 0;
+  char containers[kNordPoolParserMaxDepth] = {0};
+  bool expectKey[kNordPoolParserMaxDepth] = {false};
+  char keys[kNordPoolParserMaxDepth][kNordPoolParserTokenLen] = {{0}};
+  bool inString = false;
+  bool inEscape = false;
+  bool inScalar = false;
+  char token[kNordPoolParserTokenLen] = "";
+  uint8_t tokenLen = 0;
+
+  // Current multiIndexEntries item.
+  bool entriesDepthSet = false;
+  uint8_t entriesDepth = 0;
+  char deliveryStart[kNordPoolParserTokenLen] = "";
+  uint8_t priceMask = 0;  // bit i: prices[i] is set
+  int32_t prices[kNordPoolParserMaxAreas] = {0};
+};
+
+// Areas past kNordPoolParserMaxAreas are ignored.
+void nordPoolParserBegin(
+    NordPoolStreamParser &parser,
+    const char *const *areas,
+    size_t areaCount,
+    NordPoolEntryCallback onEntry,
+    void *ctx);
+NordPoolParseStatus nordPoolParserFeed(NordPoolStreamParser &parser, const uint8_t *data, size_t len);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "app_types.h"
+
+constexpr uint32_t kPublishStatsMagic = 0x4E505055;  // "NPPU"
+constexpr uint16_t kPublishStatsVersion = 1;
+constexpr size_t kPublishStatsMaxSamples = 30;
+// Samples needed before the learned window replaces the default one.
+constexpr size_t kPublishStatsMinSamples = 3;
+// Poll spacing inside the expected window, and before/after it.
+constexpr time_t kPublishTightPollSec = 2 * 60;
+constexpr time_t kPublishSparsePollSec = 15 * 60;
+// Upper bound of the random delay added to every poll.
+constexpr uint32_t kPublishPollJitterSec = 45;
+
+// When the next day's prices were first seen for one area, as local
+// minutes after midnight; a ring of the most recent days.
+struct PublishStats {
+  uint32_t magic = kPublishStatsMagic;
+  uint16_t version = kPublishStatsVersion;
+  uint8_t count = 0;
+  uint8_t head = 0;  // next write index
+  char area[kStateAreaLen] = "";
+  uint16_t minutes[kPublishStatsMaxSamples] = {0};
+};
+
+// Local minutes of day to poll tightly between. Until enough days are
+// learned it spans 12:30-13:30, wide enough around the usual publication
+// that the first poll of a day tends to miss and so yields a sample.
+struct PublishWindow {
+  uint16_t firstMinute = 12 * 60 + 30;
+  uint16_t lastMinute = 13 * 60 + 30;
+  bool learned = false;
+};
+
+void resetPublishStats(PublishStats &stats, const char *area);
+bool loadPublishStats(PublishStats &stats);
+bool savePublishStats(const PublishStats &stats);
+bool clearPublishStats();
+// Records a publication bracketed by a poll that missed it (missedAt) and
+// the one that saw it (seenAt), at their midpoint. Returns false, keeping
+// stats unchanged, unless both fall on the same local day and close enough
+// together for the midpoint to mean something.
+bool notePublishObserved(PublishStats &stats, time_t missedAt, time_t seenAt);
+// The first poll of the window already found the prices, so publication
+// has moved earlier than the window. Records the window start; repeated
+// early days pull the window forward until its first poll misses again.
+// Returns false when seenAt is not that first poll.
+bool notePublishedBeforeWindow(PublishStats &stats, time_t seenAt, const PublishWindow &window);
+// p10 minus a lead to p90 plus a tail of the learned samples.
+PublishWindow publishWindow(const PublishStats &stats);
+// The first poll of the window after `now` (today's, or tomorrow's once
+// today's has started). 0 while the clock is invalid.
+time_t publishFirstPollAfter(time_t now, const PublishWindow &window);
+// Delay after a poll at `now` that found nothing new: up to the window
+// start before it, tight inside it, sparse after it.
+time_t publishRetryDelaySec(time_t now, const PublishWindow &window);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Timing spans for the fetch and render phases. Each span keeps its last
+// kPerfWindow durations plus the heap and largest-free-block low-water marks
+// seen when it ended. Sending 'p' over serial prints the summary.
+
+#ifndef CONFIG_PERF_SPANS
+#define CONFIG_PERF_SPANS 1
+#endif
+
+enum class PerfSpan : uint8_t {
+  FetchConnect = 0,  // TCP + TLS handshake on a new connection
+  FetchFirstByte,    // request sent until response headers are parsed
+  FetchBodyRead,     // socket reads while streaming the body
+  FetchParse,        // parser time inside the body stream
+  MovingAverage,     // moving-average and history update, including flash writes
+  CacheSave,
+  DisplayFrame,
+  PriceText,
+  Count,
+};
+
+constexpr size_t kPerfWindow = 16;
+
+#if CONFIG_PERF_SPANS
+void perfRecord(PerfSpan span, uint32_t durationUs);
+void perfLogSummary();
+// Prints the summary when a 'p' is waiting on Serial; call from the loop.
+void perfPollSerial();
+
+class PerfScope {
+ public:
+  explicit PerfScope(PerfSpan span) : span_(span), startUs_(micros()) {}
+  ~PerfScope() { perfRecord(span_, micros() - startUs_); }
+  PerfScope(const PerfScope &) = delete;
+  PerfScope &operator=(const PerfScope &) = delete;
+
+ private:
+  PerfSpan span_;
+  uint32_t startUs_;
+};
+#else
+inline void perfRecord(PerfSpan, uint32_t) {}
+inline void perfLogSummary() {}
+inline void perfPollSerial() {}
+
+class PerfScope {
+ public:
+  explicit PerfScope(PerfSpan) {}
+};
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// CONFIG_POWER_MODE values.
+enum class PowerMode : uint8_t {
+  Performance = 0,  // radio and CPU always on (default)
+  ModemSleep = 1,   // WiFi stays associated with maximum modem sleep
+  LightSleep = 2,   // WiFi off except around network jobs, CPU light-sleeps between deadlines
+};
+
+// `wakePin` < 0 disables GPIO wake-up (the reset button otherwise).
+void powerInit(PowerMode mode, int wakePin, int wakeActiveLevel);
+PowerMode powerMode();
+// True when WiFi is only brought up for network jobs and is expected to be
+// down in between.
+bool powerRadioOnDemand();
+// Blocks the calling task for up to waitMs or until it is notified. In
+// LightSleep mode, with the radio off and `allowLightSleep` set, the chip
+// light-sleeps instead and wakes on the timer or the wake pin. Also logs
+// awake time and wake counts once per hour.
+void powerIdle(uint32_t waitMs, bool allowLightSleep);
+// Called by whoever switches the WiFi radio, for the hourly radio-on time.
+void powerNoteRadio(bool on);
+bool powerRadioOn();
@@ -3,6 +3,7 @@
 #include "app_types.h"
 
 bool priceCacheSave(const PriceState &state);
-bool priceCacheLoadIfCurrent(const char *expectedSource, PriceState &out);
-bool priceCacheLoadIfAvailable(const char *expectedSource, PriceState &out);
+// Loads any cached state for the source in a single read. coversCurrentInterval
+// reports whether the cache contains the slot for the current clock time.
+bool priceCacheLoad(const char *expectedSource, PriceState &out, bool &coversCurrentInterval);
 bool priceCacheClear();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Prices are int32 in 1/100 of a minor currency unit per kWh, i.e. 1/10000 of
+// the major unit: 1.2345 SEK/kWh is 12345. That equals 0.1 per MWh. Nord Pool
+// publishes two decimals per MWh, so parsing rounds to the nearest 0.1/MWh
+// and is not exact; stored prices compare equal only when they are the same
+// value.
+constexpr int32_t kPriceFixedPerMajor = 10000;
+constexpr int32_t kPriceFixedPerMinor = 100;
+
+// VAT and fixed cost as an integer multiplier/offset pair; build it once
+// when the settings load and apply it per point.
+struct PriceFormula {
+  int32_t vatMultiplier = 12500;  // (1 + VAT/100) * 10000
+  int32_t offset = 0;             // fixed cost in price units
+};
+
+// Clamps out-of-range settings to the defaults (25 % VAT, no fixed cost).
+PriceFormula makePriceFormula(float vatPercent, float fixedCostMinorPerKwh);
+
+inline int32_t applyPriceFormula(const PriceFormula &formula, int32_t rawPrice) {
+  const int64_t scaled = (int64_t)rawPrice * formula.vatMultiplier;
+  const int64_t half = kPriceFixedPerMajor / 2;
+  const int64_t rounded = (scaled >= 0 ? scaled + half : scaled - half) / kPriceFixedPerMajor;
+  return (int32_t)rounded + formula.offset;
+}
+
+inline float priceFixedToMajor(int32_t price) {
+  return (float)price / (float)kPriceFixedPerMajor;
+}
+
+// Rounds to the nearest price unit; only for values that are not already
+// fixed-point (settings, defaults).
+int32_t priceFixedFromMajor(float major);
+
+// Writes `price` in major units with 0..4 decimals, rounded half away from
+// zero, e.g. 12345 with 2 decimals is "1.23". Returns the length written.
+size_t formatPriceFixed(int32_t price, uint8_t decimals, char *out, size_t outSize);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "app_types.h"
+
+#ifndef CONFIG_PRICE_HISTORY_DAYS
+#define CONFIG_PRICE_HISTORY_DAYS 60
+#endif
+
+// Days of raw prices kept on flash, clamped to 30..90.
+constexpr uint16_t kPriceHistoryDays =
+    CONFIG_PRICE_HISTORY_DAYS < 30 ? 30 : (CONFIG_PRICE_HISTORY_DAYS > 90 ? 90 : CONFIG_PRICE_HISTORY_DAYS);
+constexpr size_t kPriceHistoryDecileCount = 9;  // p10..p90
+
+// One index record per local day. Queries read only these; the samples they
+// point at are needed only to rebuild a day that is extended later. Prices
+// are raw, fixed-point per kWh (see price_fixed.h).
+struct PriceHistoryDay {
+  uint32_t dayStart = 0;    // UTC epoch of local midnight
+  uint32_t dataOffset = 0;  // byte offset of the day's samples in the data file
+  uint16_t count = 0;
+  uint16_t resolutionMinutes = 60;
+  int32_t min = 0;
+  int32_t max = 0;
+  int64_t sum = 0;
+  int32_t deciles[kPriceHistoryDecileCount] = {0};
+};
+
+struct PriceHistoryStats {
+  uint16_t days = 0;
+  uint32_t samples = 0;
+  int32_t min = 0;
+  int32_t max = 0;
+  int32_t average = 0;  // rounded to the nearest price unit
+};
+
+// Appends raw prices of slots newer than the last recorded one. Prices are
+// stored before VAT/fixed cost, like the moving-average store.
+bool priceHistoryRecord(const PriceState &state);
+// Stats over the newest `days` recorded days; false when none are recorded.
+bool priceHistoryStats(uint16_t days, PriceHistoryStats &out);
+// Raw-price percentiles (`percents` in 0..100) over the newest `days` days,
+// estimated from the per-day deciles. Returns false below `minDays` days.
+bool priceHistoryPercentiles(uint16_t days, uint16_t minDays, const uint8_t *percents, size_t count, int32_t *out);
+// Newest recorded slot start; 0 when nothing is recorded.
+uint32_t priceHistoryLastSlotStart();
+// Calls `fn` for every recorded sample from `fromSlotStart` on, oldest
+// first, with its raw fixed-point price. Reads only the days that can hold
+// such samples; false when the index or a day can't be read.
+typedef void (*PriceHistorySampleFn)(void *ctx, uint32_t slotStart, int32_t rawPrice);
+bool priceHistoryForEachSample(uint32_t fromSlotStart, PriceHistorySampleFn fn, void *ctx);
+bool priceHistoryClear();
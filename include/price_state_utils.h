@@ -2,6 +2,15 @@
 
 #include "app_types.h"
 
+const char *priceLevelName(PriceLevel level);
+// FNV-1a over area, currency, resolution, running average, every point's
+// slot epoch, computed price, level and raw price, then the extra areas.
+// Computed prices carry the VAT/fixed-cost formula, so a formula change
+// also changes the hash.
+uint32_t priceStateFingerprint(const PriceState &state);
 bool hasNewPriceInfo(const PriceState &fetched, const PriceState &current);
+// True when fetched has fewer points or local days than current, unless it
+// reaches further ahead: then only past days dropped out, which on a DST
+// switch had 92 or 100 slots.
 bool wouldReduceCoverage(const PriceState &fetched, const PriceState &current);
 
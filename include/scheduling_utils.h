@@ -1,7 +1,53 @@
 #pragma once
 
+#include <stdint.h>
 #include <time.h>
 
 time_t scheduleNextMinuteBoundary(time_t now, time_t validEpochMin);
 time_t scheduleAfter(time_t now, time_t delaySec, time_t validEpochMin);
 
+// Fixed set of deadlines the main loop sleeps between. Wall-clock entries
+// (epoch seconds) only fire once the clock is valid; monotonic entries
+// (millis) fire regardless, e.g. error backoff before NTP has synced.
+enum class ScheduledTask : uint8_t {
+  MinuteTick = 0,
+  SlotChange,
+  ClockResync,
+  DailyFetch,
+  ErrorRetry,
+  PageRotate,
+  Count,
+};
+
+struct ScheduleEntry {
+  bool armed = false;
+  bool monotonic = false;
+  time_t wallAt = 0;
+  uint32_t monoAtMs = 0;
+};
+
+struct DeadlineQueue {
+  ScheduleEntry entries[(size_t)ScheduledTask::Count];
+};
+
+constexpr uint32_t scheduledTaskBit(ScheduledTask task) {
+  return 1u << (uint32_t)task;
+}
+
+// wallAt == 0 disarms, so the schedule* helpers above can be passed through.
+void deadlineArmAt(DeadlineQueue &queue, ScheduledTask task, time_t wallAt);
+void deadlineArmAfterMs(DeadlineQueue &queue, ScheduledTask task, uint32_t nowMs, uint32_t delayMs);
+void deadlineDisarm(DeadlineQueue &queue, ScheduledTask task);
+bool deadlineArmed(const DeadlineQueue &queue, ScheduledTask task);
+// Wall time of an armed wall-clock entry, 0 otherwise.
+time_t deadlineWallAt(const DeadlineQueue &queue, ScheduledTask task);
+bool deadlineDue(const DeadlineQueue &queue, ScheduledTask task, time_t now, uint32_t nowMs, time_t validEpochMin);
+// Milliseconds until the earliest armed entry not in `ignoreMask`, capped at
+// maxWaitMs; 0 when one is already due. wallNowMs is epoch milliseconds.
+uint32_t deadlineWaitMs(
+    const DeadlineQueue &queue,
+    int64_t wallNowMs,
+    uint32_t nowMs,
+    time_t validEpochMin,
+    uint32_t ignoreMask,
+    uint32_t maxWaitMs);
@@ -9,13 +9,40 @@ struct PriceState;
 // indicate the RTC has not been set yet.
 constexpr time_t kValidEpochMin = 1700000000;
 
+// The wall and monotonic clocks behind every scheduling, slot and fetch
+// decision. A replay or soak run installs a virtual source so days of
+// schedule pass in seconds; unset members, or no source, fall back to
+// gettimeofday()/millis() and real sleeps. Install before the network
+// worker starts.
+struct ClockSource {
+  int64_t (*wallMs)() = nullptr;        // UTC epoch milliseconds
+  uint32_t (*monotonicMs)() = nullptr;  // millis() equivalent
+  // Replaces the idle sleep between deadlines, e.g. by advancing the clock.
+  void (*idle)(uint32_t ms) = nullptr;
+};
+
+void clockSetSource(const ClockSource *source);
+int64_t clockNowMs();
+time_t clockNow();
+uint32_t clockMillis();
+// Returns false when the caller should sleep for real.
+bool clockIdle(uint32_t ms);
+
 uint16_t normalizeResolutionMinutes(uint16_t resolutionMinutes);
 bool isValidClock(time_t now, time_t validEpochMin);
 bool formatDateYmd(time_t ts, char *out, size_t outSize);
-String utcIsoToLocalIsoSlot(const String &utcIso);
-String intervalKeyFromIso(const String &iso, uint16_t resolutionMinutes);
-String currentIntervalKey(uint16_t resolutionMinutes);
-int findPricePointIndexForInterval(const PriceState &state, const String &intervalKey, uint16_t resolutionMinutes);
+// Parses "YYYY-MM-DDTHH:MM:SS..." (UTC) into epoch seconds; returns 0 on failure.
+time_t utcIsoToEpoch(const char *utcIso);
+// Formats a slot start as local "YYYY-MM-DDTHH:MM" for logs.
+bool formatLocalSlot(time_t ts, char *out, size_t outSize);
+time_t intervalStartForTime(time_t ts, uint16_t resolutionMinutes);
+// Local midnight `dayOffset` days after the day containing ts; 0 on failure.
+time_t localDayStart(time_t ts, int dayOffset);
+// True when every slot in [rangeStart, rangeEnd) has a point at the state resolution.
+bool stateCoversRange(const PriceState &state, time_t rangeStart, time_t rangeEnd);
+// Recomputes slotBaseStartsAt/slotsUniform after the point list changes.
+void updatePriceStateSlotIndex(PriceState &state);
+int findPricePointIndexForInterval(const PriceState &state, time_t intervalStart, uint16_t resolutionMinutes);
 int findCurrentPricePointIndex(const PriceState &state, uint16_t resolutionMinutes);
 bool shouldCatchUpMissedDailyUpdate(
     time_t now,
@@ -24,5 +51,8 @@ bool shouldCatchUpMissedDailyUpdate(
     int dailyFetchMinute,
     time_t validEpochMin);
 const char *timezoneSpecForNordpoolArea(const String &area);
+// Selects the local zone without NTP, e.g. to draw cached prices before
+// WiFi is up; syncClock selects it as well.
+void selectTimezone(const char *timezoneSpec);
 void syncClock(const char *timezoneSpec);
 time_t scheduleNextDailyFetch(time_t now, int hour, int minute);
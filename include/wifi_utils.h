@@ -6,6 +6,8 @@
 struct AppSecrets {
   String nordpoolApiUrl;
   String nordpoolArea;
+  // Comma-separated areas fetched alongside nordpoolArea, e.g. "SE4".
+  String nordpoolExtraAreas;
   String nordpoolCurrency;
   uint16_t nordpoolResolutionMinutes = 60;
   float vatPercent = 25.0f;
@@ -15,5 +17,24 @@ struct AppSecrets {
 
 void loadAppSecrets(AppSecrets &out);
 bool wifiConnectWithConfigPortal(AppSecrets &secrets, uint16_t portalTimeoutSeconds);
+
+enum class WifiPortalState : uint8_t {
+  Idle,       // no background portal
+  Open,
+  Connected,  // connected with the portal's settings, saved into secrets
+  Closed,     // timed out without new settings
+};
+
+// Opens the config portal without blocking and without replacing the
+// screen, for when prices are already shown but the station can't connect.
+// Reconnect attempts stand down while it is open; returns false without
+// opening while a reconnect is in progress.
+bool wifiConfigPortalStart(const AppSecrets &secrets, uint16_t portalTimeoutSeconds);
+// Serves a portal opened by wifiConfigPortalStart; call from the loop.
+WifiPortalState wifiConfigPortalProcess(AppSecrets &secrets);
+// Reconnect attempts that timed out since the last successful connect.
+uint8_t wifiReconnectFailures();
+// True while wifiReconnect is driving the station, on any task.
+bool wifiReconnectInProgress();
 bool wifiReconnect(uint32_t timeoutMs);
 void wifiResetSettings();
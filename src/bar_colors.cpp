@@ -0,0 +1,111 @@
+#include "bar_colors.h"
+
+namespace {
+struct Rgb {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+constexpr Rgb kLevelColors[kLevelBandCount] = {
+    {170, 255, 170},  // VERY_CHEAP, light green
+    {96, 210, 110},   // CHEAP, medium green
+    {245, 190, 70},   // NORMAL, warm yellow/orange
+    {185, 55, 35},    // EXPENSIVE, red
+    {100, 0, 0},      // VERY_EXPENSIVE, dark red
+};
+
+constexpr uint16_t kWhite565 = 0xFFFF;
+
+// Colour blend weights run 0..kBlendOne.
+constexpr int kBlendOne = 256;
+// How far a level's ends lean toward the neighbouring hues.
+constexpr int kLowerShift = (kBlendOne * 70) / 100;
+constexpr int kHigherShift = (kBlendOne * 45) / 100;
+
+int levelRank(PriceLevel level) {
+  if (level == PriceLevel::Unknown || level > PriceLevel::VeryExpensive) return -1;
+  return (int)level - (int)PriceLevel::VeryCheap;
+}
+
+uint8_t lerpU8(uint8_t a, uint8_t b, int weight) {
+  if (weight <= 0) return a;
+  if (weight >= kBlendOne) return b;
+  return (uint8_t)(((int)a * (kBlendOne - weight) + (int)b * weight + (kBlendOne / 2)) / kBlendOne);
+}
+
+Rgb lerpRgb(const Rgb &from, const Rgb &to, int weight) {
+  return Rgb{lerpU8(from.r, to.r, weight), lerpU8(from.g, to.g, weight), lerpU8(from.b, to.b, weight)};
+}
+
+uint16_t toRgb565(const Rgb &color) {
+  return rgb565(color.r, color.g, color.b);
+}
+
+// (value - low) / span as a blend weight, clamped to 0..kBlendOne * scale.
+int blendWeight(int32_t value, int32_t low, int32_t span, int scale = 1) {
+  if (span <= 0 || value <= low) return 0;
+  const int64_t weight = ((int64_t)(value - low) * kBlendOne * scale) / span;
+  return weight >= (int64_t)kBlendOne * scale ? kBlendOne * scale : (int)weight;
+}
+}  // namespace
+
+uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+uint16_t levelColor(PriceLevel level) {
+  const int rank = levelRank(level);
+  if (rank < 0) return kWhite565;
+  return toRgb565(kLevelColors[rank]);
+}
+
+void computeLevelBands(const PriceState &state, LevelBand bands[kLevelBandCount]) {
+  for (size_t i = 0; i < state.count; ++i) {
+    const int rank = levelRank(state.points[i].level);
+    if (rank < 0) continue;
+
+    LevelBand &band = bands[rank];
+    const int32_t price = state.points[i].price;
+    if (!band.has) {
+      band.has = true;
+      band.minPrice = price;
+      band.maxPrice = price;
+      continue;
+    }
+    if (price < band.minPrice) band.minPrice = price;
+    if (price > band.maxPrice) band.maxPrice = price;
+  }
+}
+
+uint16_t barGradientColor(
+    const PricePoint &point,
+    const LevelBand bands[kLevelBandCount],
+    int32_t rangeMin,
+    int32_t rangeSpan) {
+  const int rank = levelRank(point.level);
+  if (rank < 0 || !bands[rank].has) {
+    constexpr int kSegments = (int)kLevelBandCount - 1;
+    const int scaled = blendWeight(point.price, rangeMin, rangeSpan, kSegments);
+    int idx = scaled / kBlendOne;
+    if (idx >= kSegments) idx = kSegments - 1;
+    return toRgb565(lerpRgb(kLevelColors[idx], kLevelColors[idx + 1], scaled - (idx * kBlendOne)));
+  }
+
+  const LevelBand &band = bands[rank];
+  const int32_t span = band.maxPrice - band.minPrice;
+  if (span < kMinBandSpan) return toRgb565(kLevelColors[rank]);
+  const int weight = blendWeight(point.price, band.minPrice, span);
+
+  // Anchored in the level's own hue; the ends only lean toward a
+  // neighbouring hue when that level is present.
+  Rgb lowSide = kLevelColors[rank];
+  Rgb highSide = kLevelColors[rank];
+  if (rank > 0 && bands[rank - 1].has) {
+    lowSide = lerpRgb(kLevelColors[rank], kLevelColors[rank - 1], kLowerShift);
+  }
+  if (rank < (int)kLevelBandCount - 1 && bands[rank + 1].has) {
+    highSide = lerpRgb(kLevelColors[rank], kLevelColors[rank + 1], kHigherShift);
+  }
+  return toRgb565(lerpRgb(lowSide, highSide, weight));
+}
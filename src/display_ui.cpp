@@ -2,14 +2,40 @@
 #include <ctype.h>
 #include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <OpenFontRender.h>
 #include <TFT_eSPI.h>
+#include <esp_heap_caps.h>
 
 #include "NotoSans_Bold.h"
+#include "bar_colors.h"
 #include "display_ui.h"
+#include "local_time.h"
 #include "logging_utils.h"
+#include "perf_spans.h"
+#include "price_fixed.h"
+#include "time_utils.h"
+
+#ifndef CONFIG_DISPLAY_SPRITE_CHART
+#define CONFIG_DISPLAY_SPRITE_CHART 1
+#endif
+
+// TFT_eSPI defines ESP32_DMA for its SPI ports; the parallel bus has no DMA
+// path and pushes sprites synchronously. pushImageDMA sends 16-bit pixels,
+// but the ILI9488 takes 18-bit ones over SPI, so that build widens strips
+// to RGB666 in DMA buffers and sends them raw.
+#if defined(ESP32_DMA) && !defined(TFT_PARALLEL_8_BIT)
+#define DISPLAY_CHART_DMA 1
+#else
+#define DISPLAY_CHART_DMA 0
+#endif
+#if DISPLAY_CHART_DMA && defined(ILI9488_DRIVER)
+#define DISPLAY_CHART_DMA_RGB666 1
+#else
+#define DISPLAY_CHART_DMA_RGB666 0
+#endif
 
 namespace
 {
@@ -87,21 +113,156 @@ namespace
   constexpr int kYAxisFontSize        = 2;
   constexpr int kTopXAxisFontSize     = 2;
   constexpr int kSourceLabelY         = 2;
+  constexpr int kAreaLabelY           = kSourceLabelY + 28;  // below the font-4 clock
   constexpr uint16_t kAverageLineColor = TFT_CYAN;
+  constexpr int kPriceTextPadPx       = 2;
+  // Row count of each chart strip when the whole chart does not fit in one sprite.
+  constexpr int kChartBandRows        = 24;
+#if DISPLAY_CHART_DMA_RGB666
+  // Rows per RGB666 DMA buffer, 3 bytes a pixel. An even pixel count keeps
+  // the transfer a whole number of 16-bit words.
+  constexpr int kChartWideRows        = 12;
+  constexpr size_t kChartWideBytes    = (size_t)kChartW * kChartWideRows * 3;
+  static_assert(kChartW % 2 == 0, "RGB666 DMA pushes whole 16-bit words");
+  // Strips are copied out before the transfer, so one is enough.
+  constexpr int kChartBandSprites     = 1;
+#else
+  constexpr int kChartBandSprites     = 2;
+#endif
 
-  void formatPriceValue(float value, char *out, size_t outSize)
+  // Drawing target for the chart interior (kChartX/kChartY/kChartW/kChartH).
+  // Callers use screen coordinates; the canvas shifts them into the sprite or
+  // band it currently wraps, and the sprite clips anything outside.
+  struct ChartCanvas
   {
-    if (outSize == 0)
-      return;
-    snprintf(out, outSize, "%.2f", value);
+    TFT_eSPI *gfx = nullptr;
+    int originX = 0;
+    int originY = 0;
+
+    void fillRect(int x, int y, int w, int h, uint16_t color)
+    {
+      gfx->fillRect(x - originX, y - originY, w, h, color);
+    }
+
+    void drawFastHLine(int x, int y, int w, uint16_t color)
+    {
+      gfx->drawFastHLine(x - originX, y - originY, w, color);
+    }
+
+    void drawFastVLine(int x, int y, int h, uint16_t color)
+    {
+      gfx->drawFastVLine(x - originX, y - originY, h, color);
+    }
+
+    void fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, uint16_t color)
+    {
+      gfx->fillTriangle(
+          x0 - originX, y0 - originY, x1 - originX, y1 - originY, x2 - originX, y2 - originY, color);
+    }
+  };
+
+  // Off-screen chart buffers, allocated once at displayInit so the heap
+  // layout stays stable. With PSRAM the whole chart is one sprite; otherwise
+  // two strips alternate so one can be filled while the other is pushed.
+  // The RGB666 path alternates its two DMA buffers instead.
+  struct ChartSprites
+  {
+    TFT_eSprite full{&tft};
+    TFT_eSprite band[2] = {TFT_eSprite(&tft), TFT_eSprite(&tft)};
+    bool hasFull = false;
+    bool hasBands = false;
+    bool dmaReady = false;
+    bool pushPending = false;
+#if DISPLAY_CHART_DMA_RGB666
+    uint8_t *wide[2] = {nullptr, nullptr};
+    int nextWide = 0;
+#endif
+  };
+
+  ChartSprites gChart;
+
+  struct ScreenRect
+  {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+  };
+
+  // What is currently on the panel, so displayDrawPrices can repaint only
+  // the regions that differ from the previous frame.
+  struct RenderedFrame
+  {
+    bool valid = false;
+    bool hasErrorBanner = false;
+    uint32_t chartSignature = 0;
+    int currentIndex = -1;
+    int32_t currentPrice = 0;
+    uint16_t priceColor = 0;
+    char currency[kStateCurrencyLen] = "";
+    ScreenRect priceRect;
+  };
+
+  RenderedFrame gFrame;
+
+  // The history page on the panel; a redraw at the same revision only
+  // refreshes the clock.
+  struct HistoryFrame
+  {
+    bool valid = false;
+    uint32_t revision = 0;
+  };
+
+  HistoryFrame gHistoryFrame;
+
+  // Status line set by displaySetNotice; shown in place of the fetch banner.
+  char gNotice[48] = "";
+
+  // Glyphs the large price line can contain. Anything else (or a failed
+  // atlas build) makes drawPriceText fall back to OpenFontRender.
+  constexpr const char *kPriceGlyphChars    = "0123456789.-";
+  // Letters of the currencies offered in the config portal (SEK, EUR, NOK, DKK).
+  constexpr const char *kCurrencyGlyphChars = "DEKNORSU";
+  constexpr size_t kMaxAtlasGlyphs          = 12;
+  constexpr int kGlyphScratchMarginPx       = 8;
+
+  // One glyph cut out of an OpenFontRender string and stored as 4-bit
+  // coverage. dx/dy place the ink box relative to the reference glyph's ink
+  // box, so glyphs line up on a common baseline when laid out by advance.
+  struct AtlasGlyph
+  {
+    char ch = '\0';
+    int16_t dx = 0;
+    int16_t dy = 0;
+    int16_t advance = 0;
+    uint8_t w = 0;
+    uint8_t h = 0;
+    uint32_t nibbleOffset = 0;
+  };
+
+  struct GlyphAtlas
+  {
+    bool ready = false;
+    AtlasGlyph glyphs[kMaxAtlasGlyphs];
+    size_t glyphCount = 0;
+    uint8_t *coverage = nullptr;
+    uint32_t nibbleCount = 0;
+  };
+
+  GlyphAtlas gPriceAtlas;
+  GlyphAtlas gCurrencyAtlas;
+
+  void formatPriceValue(int32_t value, char *out, size_t outSize)
+  {
+    formatPriceFixed(value, 2, out, outSize);
   }
 
-  void formatCurrencyLabel(const String &currency, char *out, size_t outSize)
+  void formatCurrencyLabel(const char *currency, char *out, size_t outSize)
   {
     if (outSize == 0)
       return;
 
-    const char *src = currency.c_str();
+    const char *src = (currency != nullptr) ? currency : "";
     const size_t len = strlen(src);
     size_t start = 0;
     while (start < len && isspace((unsigned char)src[start]))
@@ -126,22 +287,6 @@ namespace
     }
   }
 
-  uint16_t levelColor(const String &level)
-  {
-    // 5-step gradient: light green -> dark red.
-    if (level == "VERY_CHEAP" || level == "LOW")
-      return tft.color565(170, 255, 170); // light green
-    if (level == "CHEAP")
-      return tft.color565(96, 210, 110); // medium green
-    if (level == "NORMAL")
-      return tft.color565(245, 190, 70); // warm yellow/orange
-    if (level == "EXPENSIVE" || level == "HIGH")
-      return tft.color565(185, 55, 35); // red
-    if (level == "VERY_EXPENSIVE")
-      return tft.color565(100, 0, 0); // dark red
-    return TFT_WHITE;
-  }
-
   void hardResetController()
   {
 #ifdef TFT_RST
@@ -157,13 +302,314 @@ namespace
 #endif
   }
 
-  void drawPriceText(float priceValue, const String &currency, uint16_t color)
+  void rememberPriceRect(int x, int y, int w, int h)
+  {
+    ScreenRect &rect = gFrame.priceRect;
+    rect.x = max(0, x - kPriceTextPadPx);
+    rect.y = max(0, y - kPriceTextPadPx);
+    rect.w = w + (2 * kPriceTextPadPx);
+    // Never reach into the day/hour labels above the chart.
+    rect.h = min(h + (2 * kPriceTextPadPx), (kDayLabelY - 1) - rect.y);
+  }
+
+  struct InkRun
+  {
+    int x0 = 0;
+    int x1 = 0;
+    int y0 = 0;
+    int y1 = 0;
+  };
+
+  uint8_t coverageAt(TFT_eSprite &sprite, int x, int y)
+  {
+    // Rendered white on black, so the 6-bit green channel is the coverage.
+    return (uint8_t)(((sprite.readPixel(x, y) >> 5) & 0x3F) >> 2);
+  }
+
+  // Splits the scratch sprite into horizontally separated ink runs. Returns
+  // -1 when ink touches the sprite edge (glyph clipped).
+  int findInkRuns(TFT_eSprite &sprite, int w, int h, InkRun *runs, int maxRuns)
+  {
+    int count = 0;
+    bool inRun = false;
+    for (int x = 0; x <= w; ++x)
+    {
+      int top = h;
+      int bottom = -1;
+      if (x < w)
+      {
+        for (int y = 0; y < h; ++y)
+        {
+          if (coverageAt(sprite, x, y) == 0)
+            continue;
+          if (x == 0 || x == (w - 1) || y == 0 || y == (h - 1))
+            return -1;
+          top = min(top, y);
+          bottom = y;
+        }
+      }
+
+      if (bottom >= 0)
+      {
+        if (!inRun)
+        {
+          if (count == maxRuns)
+            return maxRuns + 1;
+          runs[count].x0 = x;
+          runs[count].y0 = top;
+          runs[count].y1 = bottom + 1;
+          inRun = true;
+          ++count;
+        }
+        InkRun &run = runs[count - 1];
+        run.x1 = x + 1;
+        run.y0 = min(run.y0, top);
+        run.y1 = max(run.y1, bottom + 1);
+      }
+      else
+      {
+        inRun = false;
+      }
+    }
+    return count;
+  }
+
+  // Renders a two-glyph string into the scratch sprite and returns its two ink runs.
+  bool renderGlyphPair(TFT_eSprite &scratch, int w, int h, char first, char second, InkRun runs[2])
+  {
+    const char text[3] = {first, second, '\0'};
+    scratch.fillSprite(TFT_BLACK);
+    ofr.setCursor(kGlyphScratchMarginPx, kGlyphScratchMarginPx);
+    ofr.printf("%s", text);
+    return findInkRuns(scratch, w, h, runs, 2) == 2;
+  }
+
+  bool appendGlyphCoverage(GlyphAtlas &atlas, TFT_eSprite &scratch, const InkRun &run, AtlasGlyph &glyph)
+  {
+    const int w = run.x1 - run.x0;
+    const int h = run.y1 - run.y0;
+    if (w <= 0 || h <= 0 || w > 255 || h > 255)
+      return false;
+
+    const uint32_t newNibbles = atlas.nibbleCount + (uint32_t)(w * h);
+    uint8_t *grown = (uint8_t *)realloc(atlas.coverage, (newNibbles + 1) / 2);
+    if (grown == nullptr)
+      return false;
+    atlas.coverage = grown;
+
+    glyph.w = (uint8_t)w;
+    glyph.h = (uint8_t)h;
+    glyph.nibbleOffset = atlas.nibbleCount;
+    uint32_t nibble = atlas.nibbleCount;
+    for (int y = run.y0; y < run.y1; ++y)
+    {
+      for (int x = run.x0; x < run.x1; ++x, ++nibble)
+      {
+        const uint8_t value = coverageAt(scratch, x, y);
+        uint8_t &byte = atlas.coverage[nibble / 2];
+        byte = (nibble & 1) ? (uint8_t)((byte & 0x0F) | (value << 4)) : (uint8_t)((byte & 0xF0) | value);
+      }
+    }
+    atlas.nibbleCount = newNibbles;
+    return true;
+  }
+
+  void releaseGlyphAtlas(GlyphAtlas &atlas)
+  {
+    free(atlas.coverage);
+    atlas = GlyphAtlas();
+  }
+
+  // Builds the atlas from pairs rendered against a reference glyph:
+  // "RR" gives the reference advance, "Rc" the ink of c and its offset from
+  // the reference, "cR" the advance of c.
+  bool buildGlyphAtlas(GlyphAtlas &atlas, TFT_eSprite &scratch, int w, int h, unsigned fontSize, char reference, const char *chars)
+  {
+    ofr.setFontSize(fontSize);
+    InkRun runs[2];
+    if (!renderGlyphPair(scratch, w, h, reference, reference, runs))
+      return false;
+    const int refAdvance = runs[1].x0 - runs[0].x0;
+
+    for (const char *c = chars; *c != '\0' && atlas.glyphCount < kMaxAtlasGlyphs; ++c)
+    {
+      AtlasGlyph glyph;
+      glyph.ch = *c;
+      if (!renderGlyphPair(scratch, w, h, reference, *c, runs))
+        return false;
+      glyph.dx = (int16_t)((runs[1].x0 - runs[0].x0) - refAdvance);
+      glyph.dy = (int16_t)(runs[1].y0 - runs[0].y0);
+      if (!appendGlyphCoverage(atlas, scratch, runs[1], glyph))
+        return false;
+
+      if (!renderGlyphPair(scratch, w, h, *c, reference, runs))
+        return false;
+      glyph.advance = (int16_t)((runs[1].x0 - runs[0].x0) + glyph.dx);
+      atlas.glyphs[atlas.glyphCount++] = glyph;
+    }
+    atlas.ready = true;
+    return true;
+  }
+
+  void buildGlyphAtlases()
+  {
+    if (!gOpenFontReady)
+      return;
+
+    const uint32_t startMs = millis();
+    const int w = ((kPriceFontSize * 3) / 2) + (2 * kGlyphScratchMarginPx);
+    const int h = ((kPriceFontSize * 3) / 2) + (2 * kGlyphScratchMarginPx);
+    TFT_eSprite scratch(&tft);
+    scratch.setColorDepth(16);
+    if (scratch.createSprite(w, h) == nullptr)
+    {
+      LOG_WARN(Display, "Display glyph atlas: no memory for %dx%d scratch", w, h);
+      return;
+    }
+
+    ofr.setDrawer(scratch);
+    ofr.setFontColor(TFT_WHITE, TFT_BLACK);
+    ofr.setAlignment(Align::TopLeft);
+    if (!buildGlyphAtlas(gPriceAtlas, scratch, w, h, kPriceFontSize, '0', kPriceGlyphChars))
+      releaseGlyphAtlas(gPriceAtlas);
+    if (!buildGlyphAtlas(gCurrencyAtlas, scratch, w, h, kCurrencyFontSize, 'H', kCurrencyGlyphChars))
+      releaseGlyphAtlas(gCurrencyAtlas);
+    ofr.setDrawer(tft);
+    scratch.deleteSprite();
+
+    LOG_INFO(
+        Display,
+        "Display glyph atlas: price=%s currency=%s bytes=%lu ms=%lu",
+        gPriceAtlas.ready ? "ready" : "off",
+        gCurrencyAtlas.ready ? "ready" : "off",
+        (unsigned long)(((gPriceAtlas.nibbleCount + 1) / 2) + ((gCurrencyAtlas.nibbleCount + 1) / 2)),
+        (unsigned long)(millis() - startMs));
+  }
+
+  const AtlasGlyph *findAtlasGlyph(const GlyphAtlas &atlas, char ch)
+  {
+    for (size_t i = 0; i < atlas.glyphCount; ++i)
+    {
+      if (atlas.glyphs[i].ch == ch)
+        return &atlas.glyphs[i];
+    }
+    return nullptr;
+  }
+
+  // Ink box of `text` laid out from pen x = 0, in the atlas' reference frame.
+  struct AtlasTextBox
+  {
+    const AtlasGlyph *glyphs[16];
+    int16_t inkX[16];
+    size_t count = 0;
+    int left = 0;
+    int top = 0;
+    int right = 0;
+    int bottom = 0;
+  };
+
+  bool layoutAtlasText(const GlyphAtlas &atlas, const char *text, AtlasTextBox &box)
+  {
+    if (!atlas.ready || text[0] == '\0')
+      return false;
+
+    int pen = 0;
+    box.count = 0;
+    for (const char *c = text; *c != '\0'; ++c)
+    {
+      const AtlasGlyph *glyph = findAtlasGlyph(atlas, *c);
+      if (glyph == nullptr || box.count == (sizeof(box.glyphs) / sizeof(box.glyphs[0])))
+        return false;
+      const int inkX = pen + glyph->dx;
+      if (box.count == 0)
+      {
+        box.left = inkX;
+        box.right = inkX + glyph->w;
+        box.top = glyph->dy;
+        box.bottom = glyph->dy + glyph->h;
+      }
+      else
+      {
+        box.left = min(box.left, inkX);
+        box.right = max(box.right, inkX + (int)glyph->w);
+        box.top = min(box.top, (int)glyph->dy);
+        box.bottom = max(box.bottom, glyph->dy + (int)glyph->h);
+      }
+      box.glyphs[box.count] = glyph;
+      box.inkX[box.count] = (int16_t)inkX;
+      ++box.count;
+      pen += glyph->advance;
+    }
+    return true;
+  }
+
+  // Draws a laid-out string with its ink box at (x, y), shading the stored
+  // coverage between black and `color`.
+  void blitAtlasText(const GlyphAtlas &atlas, const AtlasTextBox &box, int x, int y, uint16_t color)
+  {
+    uint16_t shades[16];
+    for (int a = 0; a < 16; ++a)
+      shades[a] = tft.alphaBlend((uint8_t)(a * 17), color, TFT_BLACK);
+
+    uint16_t line[255];
+    const bool swapBytes = tft.getSwapBytes();
+    tft.setSwapBytes(true);
+    tft.startWrite();
+    for (size_t i = 0; i < box.count; ++i)
+    {
+      const AtlasGlyph &glyph = *box.glyphs[i];
+      tft.setAddrWindow(x + (box.inkX[i] - box.left), y + (glyph.dy - box.top), glyph.w, glyph.h);
+      uint32_t nibble = glyph.nibbleOffset;
+      for (int row = 0; row < glyph.h; ++row)
+      {
+        for (int col = 0; col < glyph.w; ++col, ++nibble)
+        {
+          const uint8_t byte = atlas.coverage[nibble / 2];
+          line[col] = shades[(nibble & 1) ? (byte >> 4) : (byte & 0x0F)];
+        }
+        tft.pushPixels(line, glyph.w);
+      }
+    }
+    tft.endWrite();
+    tft.setSwapBytes(swapBytes);
+  }
+
+  bool drawPriceTextFromAtlas(const char *priceText, const char *currencyText, uint16_t color)
+  {
+    AtlasTextBox priceBox;
+    AtlasTextBox currencyBox;
+    if (!layoutAtlasText(gPriceAtlas, priceText, priceBox) ||
+        !layoutAtlasText(gCurrencyAtlas, currencyText, currencyBox))
+      return false;
+
+    const int priceWidth = priceBox.right - priceBox.left;
+    const int priceHeight = priceBox.bottom - priceBox.top;
+    const int currencyWidth = currencyBox.right - currencyBox.left;
+    const int currencyHeight = currencyBox.bottom - currencyBox.top;
+
+    const int totalWidth = priceWidth + kPriceCurrencyGapPx + currencyWidth;
+    const int startX = kScreenCenterX - (totalWidth / 2);
+    const int priceTop = kPriceCenterY - (priceHeight / 2);
+    // Currency shares the bottom edge of the price digits.
+    const int currencyTop = priceTop + priceHeight - currencyHeight;
+
+    blitAtlasText(gPriceAtlas, priceBox, startX, priceTop, color);
+    blitAtlasText(gCurrencyAtlas, currencyBox, startX + priceWidth + kPriceCurrencyGapPx, currencyTop, color);
+    rememberPriceRect(startX, priceTop, totalWidth, priceHeight);
+    return true;
+  }
+
+  void drawPriceText(int32_t priceValue, const char *currency, uint16_t color)
   {
+    const PerfScope span(PerfSpan::PriceText);
     char priceText[16];
     char currencyText[8];
     formatPriceValue(priceValue, priceText, sizeof(priceText));
     formatCurrencyLabel(currency, currencyText, sizeof(currencyText));
 
+    if (drawPriceTextFromAtlas(priceText, currencyText, color))
+      return;
+
     if (gOpenFontReady)
     {
       ofr.setFontColor(color, TFT_BLACK);
@@ -188,6 +634,7 @@ namespace
       ofr.setFontSize(kCurrencyFontSize);
       ofr.setCursor(startX + priceWidth + kPriceCurrencyGapPx, currencyY);
       ofr.printf("%s", currencyText);
+      rememberPriceRect(startX, priceY - (priceHeight / 2), totalWidth, priceHeight);
       return;
     }
 
@@ -221,187 +668,165 @@ namespace
 
     tft.setTextSize(1);
     tft.setTextDatum(TL_DATUM);
+    rememberPriceRect(startX, priceY, totalWidth, priceHeight);
   }
 
   struct ChartRange
   {
-    float minPrice = 0.0f;
-    float maxPrice = 1.0f;
-    float span = 1.0f;
+    int32_t minPrice = 0;
+    int32_t maxPrice = kPriceFixedPerMajor;
+    int32_t span = kPriceFixedPerMajor;
   };
 
-  struct Rgb
+  ChartRange computeChartRange(const PriceState &state)
   {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
+    ChartRange range;
+    if (state.count == 0)
+      return range;
 
-    Rgb() : r(0), g(0), b(0) {}
-    Rgb(uint8_t rr, uint8_t gg, uint8_t bb) : r(rr), g(gg), b(bb) {}
-  };
+    range.minPrice = state.points[0].price;
+    range.maxPrice = state.points[0].price;
+    for (size_t i = 1; i < state.count; ++i)
+    {
+      if (state.points[i].price < range.minPrice)
+        range.minPrice = state.points[i].price;
+      if (state.points[i].price > range.maxPrice)
+        range.maxPrice = state.points[i].price;
+    }
+    range.span = (range.maxPrice - range.minPrice);
+    if (range.span < kMinBandSpan)
+      range.span = kMinBandSpan;
+    return range;
+  }
 
-  struct LevelBand
+  int32_t floorDiv(int32_t value, int32_t divisor)
   {
-    bool has = false;
-    float minPrice = 0.0f;
-    float maxPrice = 0.0f;
-  };
-
-  static const Rgb kLevelColors[] = {
-      Rgb(170, 255, 170), // VERY_CHEAP / LOW
-      Rgb(96, 210, 110),  // CHEAP
-      Rgb(245, 190, 70),  // NORMAL
-      Rgb(185, 55, 35),   // EXPENSIVE / HIGH
-      Rgb(100, 0, 0),     // VERY_EXPENSIVE
-  };
+    const int32_t quotient = value / divisor;
+    return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+  }
 
-  int levelRank(const String &level)
+  int priceToY(int32_t price, const ChartRange &range, int xAxisY, int drawableH)
   {
-    if (level == "VERY_CHEAP" || level == "LOW")
-      return 0;
-    if (level == "CHEAP")
-      return 1;
-    if (level == "NORMAL")
-      return 2;
-    if (level == "EXPENSIVE" || level == "HIGH")
-      return 3;
-    if (level == "VERY_EXPENSIVE")
-      return 4;
-    return -1;
+    return xAxisY - (int)(((int64_t)(price - range.minPrice) * drawableH) / range.span);
   }
 
-  uint8_t lerpU8(uint8_t a, uint8_t b, float t)
+  struct PlannedBar
   {
-    if (t <= 0.0f)
-      return a;
-    if (t >= 1.0f)
-      return b;
-    const float af = (float)a;
-    const float bf = (float)b;
-    int value = (int)lroundf(af + ((bf - af) * t));
-    if (value < 0)
-      value = 0;
-    if (value > 255)
-      value = 255;
-    return (uint8_t)value;
-  }
+    int16_t x = 0;
+    int16_t w = 0;
+    int16_t y = 0;
+    int16_t h = 0;
+    uint16_t color = 0;
+  };
 
-  uint16_t lerpRgb565(const Rgb &from, const Rgb &to, float t)
+  struct PlannedTick
   {
-    const uint8_t r = lerpU8(from.r, to.r, t);
-    const uint8_t g = lerpU8(from.g, to.g, t);
-    const uint8_t b = lerpU8(from.b, to.b, t);
-    return tft.color565(r, g, b);
-  }
+    int16_t x = 0;
+    uint8_t hour = 0;
+  };
 
-  Rgb lerpRgb(const Rgb &from, const Rgb &to, float t)
+  struct PlannedDayLabel
   {
-    return Rgb(lerpU8(from.r, to.r, t), lerpU8(from.g, to.g, t), lerpU8(from.b, to.b, t));
-  }
+    int16_t x = 0;
+    char text[6] = "";
+  };
+
+  constexpr size_t kMaxPlannedDayLabels = 8;
+  // History page day labels closer than this to the previous one are skipped.
+  constexpr int kHistoryDayLabelMinGapPx = 36;
 
-  float clamp01(float v)
+  // Chart geometry and colours that depend only on the point set. Built once
+  // per new PriceState (keyed by chartSignature) and replayed by every
+  // redraw, so marker and clock updates do no float or colour math.
+  struct RenderPlan
   {
-    if (v < 0.0f)
-      return 0.0f;
-    if (v > 1.0f)
-      return 1.0f;
-    return v;
-  }
+    bool valid = false;
+    uint32_t signature = 0;
+    ChartRange range;
+    int xAxisY = kChartY + kChartH - 1;
+    int drawableH = kChartH - 4;
+    int averageY = -1;
+    size_t barCount = 0;
+    PlannedBar bars[kMaxPoints];
+    size_t tickCount = 0;
+    PlannedTick ticks[kMaxPoints];
+    size_t dayLabelCount = 0;
+    PlannedDayLabel dayLabels[kMaxPlannedDayLabels];
+  };
 
-  void computeLevelBands(const PriceState &state, LevelBand bands[5])
+  RenderPlan gPlan;
+
+  void buildRenderPlan(const PriceState &state, uint32_t signature, RenderPlan &plan)
   {
-    for (size_t i = 0; i < state.count; ++i)
+    const uint32_t startUs = micros();
+    plan.valid = true;
+    plan.signature = signature;
+    plan.range = computeChartRange(state);
+    plan.barCount = 0;
+    plan.tickCount = 0;
+    plan.dayLabelCount = 0;
+    plan.averageY = -1;
+
+    LevelBand bands[kLevelBandCount];
+    computeLevelBands(state, bands);
+
+    const int pointCount = (int)state.count;
+    int lastYday = -1;
+    for (size_t i = 0; i < state.count && i < kMaxPoints; ++i)
     {
-      const int rank = levelRank(state.points[i].level);
-      if (rank < 0 || rank > 4)
+      const PricePoint &p = state.points[i];
+      const int x0 = kChartX + (((int)i * kChartW) / pointCount);
+      const int x1 = kChartX + ((((int)i + 1) * kChartW) / pointCount);
+      const int y = priceToY(p.price, plan.range, plan.xAxisY, plan.drawableH);
+
+      PlannedBar &bar = plan.bars[plan.barCount++];
+      bar.x = (int16_t)x0;
+      bar.w = (int16_t)max(1, x1 - x0);
+      bar.y = (int16_t)y;
+      bar.h = (int16_t)(plan.xAxisY - y + 1);
+      bar.color = barGradientColor(p, bands, plan.range.minPrice, plan.range.span);
+
+      const time_t startsAt = (time_t)p.startsAt;
+      struct tm localTm;
+      if (startsAt == 0 || !localTimeFromUtc(startsAt, localTm))
         continue;
 
-      LevelBand &band = bands[rank];
-      if (!band.has)
+      if (localTm.tm_min == 0)
       {
-        band.has = true;
-        band.minPrice = state.points[i].price;
-        band.maxPrice = state.points[i].price;
-        continue;
+        PlannedTick &tick = plan.ticks[plan.tickCount++];
+        tick.x = (int16_t)x0;
+        tick.hour = (uint8_t)localTm.tm_hour;
+      }
+      if (localTm.tm_yday != lastYday && plan.dayLabelCount < kMaxPlannedDayLabels)
+      {
+        lastYday = localTm.tm_yday;
+        PlannedDayLabel &label = plan.dayLabels[plan.dayLabelCount++];
+        label.x = (int16_t)x0;
+        snprintf(label.text, sizeof(label.text), "%02d/%02d", localTm.tm_mday, localTm.tm_mon + 1);
       }
-      if (state.points[i].price < band.minPrice)
-        band.minPrice = state.points[i].price;
-      if (state.points[i].price > band.maxPrice)
-        band.maxPrice = state.points[i].price;
-    }
-  }
-
-  uint16_t barGradientColor(const PricePoint &point, const LevelBand bands[5], const ChartRange &range)
-  {
-    const int rank = levelRank(point.level);
-    if (rank < 0 || rank > 4 || !bands[rank].has)
-    {
-      // Fallback to global gradient if level is unknown.
-      const float t = clamp01((point.price - range.minPrice) / range.span);
-      constexpr int kSegments = (int)(sizeof(kLevelColors) / sizeof(kLevelColors[0])) - 1;
-      const float scaled = t * (float)kSegments;
-      int idx = (int)floorf(scaled);
-      if (idx < 0)
-        idx = 0;
-      if (idx >= kSegments)
-        idx = kSegments - 1;
-      const float localT = scaled - (float)idx;
-      return lerpRgb565(kLevelColors[idx], kLevelColors[idx + 1], localT);
     }
 
-    const LevelBand &band = bands[rank];
-    const float span = band.maxPrice - band.minPrice;
-    if (span < 0.001f)
-      return tft.color565(kLevelColors[rank].r, kLevelColors[rank].g, kLevelColors[rank].b);
-    const float t = clamp01((point.price - band.minPrice) / span);
-
-    // Keep color anchored in current level hue.
-    // Only shift toward neighboring level hues when those levels are present.
-    Rgb lowSide = kLevelColors[rank];
-    Rgb highSide = kLevelColors[rank];
-    constexpr float kLowerShift = 0.70f;
-    constexpr float kHigherShift = 0.45f;
-
-    if (rank > 0 && bands[rank - 1].has)
+    if (state.hasRunningAverage)
     {
-      lowSide = lerpRgb(kLevelColors[rank], kLevelColors[rank - 1], kLowerShift);
+      const int yAvg = priceToY(state.runningAverage, plan.range, plan.xAxisY, plan.drawableH);
+      plan.averageY = min(max(yAvg, kChartY), plan.xAxisY);
     }
-    if (rank < 4 && bands[rank + 1].has)
-    {
-      highSide = lerpRgb(kLevelColors[rank], kLevelColors[rank + 1], kHigherShift);
-    }
-
-    return lerpRgb565(lowSide, highSide, t);
+    LOG_DEBUG(
+        Display,
+        "Display render plan: bars=%u ticks=%u %lu us",
+        (unsigned)plan.barCount,
+        (unsigned)plan.tickCount,
+        (unsigned long)(micros() - startUs));
   }
 
-  ChartRange computeChartRange(const PriceState &state)
+  const RenderPlan &renderPlanFor(const PriceState &state, uint32_t signature)
   {
-    ChartRange range;
-    if (state.count == 0)
-      return range;
-
-    range.minPrice = state.points[0].price;
-    range.maxPrice = state.points[0].price;
-    for (size_t i = 1; i < state.count; ++i)
-    {
-      if (state.points[i].price < range.minPrice)
-        range.minPrice = state.points[i].price;
-      if (state.points[i].price > range.maxPrice)
-        range.maxPrice = state.points[i].price;
-    }
-    range.span = (range.maxPrice - range.minPrice);
-    if (range.span < 0.001f)
-      range.span = 0.001f;
-    return range;
+    if (!gPlan.valid || gPlan.signature != signature)
+      buildRenderPlan(state, signature, gPlan);
+    return gPlan;
   }
 
-  int priceToY(float price, const ChartRange &range, int xAxisY, int drawableH)
-  {
-    const float normalized = (price - range.minPrice) / range.span;
-    return xAxisY - (int)(normalized * drawableH);
-  }
-
-  void drawErrorScreen(const String &errorText)
+  void drawErrorScreen(const char *errorText)
   {
     tft.setTextDatum(MC_DATUM);
     tft.setTextColor(TFT_RED, TFT_BLACK);
@@ -415,11 +840,11 @@ namespace
   void drawClockLabel()
   {
     char text[6] = "--:--";
-    const time_t now = time(nullptr);
+    const time_t now = clockNow();
     if (now > 1700000000)
     {
       struct tm tmNow;
-      if (localtime_r(&now, &tmNow))
+      if (localTimeFromUtc(now, tmNow))
       {
         strftime(text, sizeof(text), "%H:%M", &tmNow);
       }
@@ -432,14 +857,26 @@ namespace
     tft.setTextDatum(TL_DATUM);
   }
 
+  // Which area is shown, under the clock; only with several areas configured.
+  void drawAreaLabel(const PriceState &state)
+  {
+    if (state.extraAreaCount == 0)
+      return;
+    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    tft.setTextFont(2);
+    tft.setTextDatum(TR_DATUM);
+    tft.drawString(state.area, kSourceLabelX, kAreaLabelY);
+    tft.setTextDatum(TL_DATUM);
+  }
+
   void drawYAxis(const ChartRange &range, int xAxisY, int drawableH)
   {
     tft.setTextFont(kYAxisFontSize);
 
-    auto drawAxisValueLabel = [&](float value, int y)
+    auto drawAxisValueLabel = [&](int32_t value, int y)
     {
       char label[12];
-      snprintf(label, sizeof(label), "%.1f", value);
+      formatPriceFixed(value, 1, label, sizeof(label));
       tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
       tft.setTextDatum(MR_DATUM);
       tft.drawString(label, kChartX - 3, y);
@@ -448,13 +885,15 @@ namespace
     const int yTop = xAxisY - drawableH;
     const int yBottom = xAxisY;
 
-    const float halfStart = ceilf(range.minPrice * 2.0f) / 2.0f;
-    const float halfEnd = floorf(range.maxPrice * 2.0f) / 2.0f;
+    // Ticks every half unit, labels on whole units.
+    constexpr int32_t kHalf = kPriceFixedPerMajor / 2;
+    const int32_t halfStart = floorDiv(range.minPrice + kHalf - 1, kHalf) * kHalf;
+    const int32_t halfEnd = floorDiv(range.maxPrice, kHalf) * kHalf;
 
-    for (float tick = halfStart; tick <= halfEnd + 0.001f; tick += 0.5f)
+    for (int32_t tick = halfStart; tick <= halfEnd; tick += kHalf)
     {
       const int yTick = priceToY(tick, range, xAxisY, drawableH);
-      const bool isWhole = fabsf(tick - roundf(tick)) < 0.01f;
+      const bool isWhole = tick % kPriceFixedPerMajor == 0;
       const int tickLen = isWhole ? 6 : 3;
       tft.drawFastHLine(kChartX - tickLen, yTick, tickLen, TFT_DARKGREY);
 
@@ -464,7 +903,7 @@ namespace
         continue;
 
       char label[8];
-      snprintf(label, sizeof(label), "%d", (int)roundf(tick));
+      snprintf(label, sizeof(label), "%ld", (long)(tick / kPriceFixedPerMajor));
       tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
       tft.setTextDatum(MR_DATUM);
       tft.drawString(label, kAxisLabelX, yTick);
@@ -477,25 +916,25 @@ namespace
     tft.setTextDatum(TL_DATUM);
   }
 
-  void drawRunningAverage(const PriceState &state, const ChartRange &range, int xAxisY, int drawableH)
+  void drawRunningAverage(
+      ChartCanvas &canvas,
+      const RenderPlan &plan,
+      int clipX0 = kChartX,
+      int clipX1 = kChartX + kChartW)
   {
-    if (!state.hasRunningAverage)
+    if (plan.averageY < 0)
       return;
 
-    int yAvg = priceToY(state.runningAverage, range, xAxisY, drawableH);
-    if (yAvg < kChartY)
-      yAvg = kChartY;
-    if (yAvg > xAxisY)
-      yAvg = xAxisY;
-
     for (int x = kChartX; x < (kChartX + kChartW); x += 6)
     {
-      tft.drawFastHLine(x, yAvg, 3, kAverageLineColor);
+      if (x + 3 <= clipX0 || x >= clipX1)
+        continue;
+      canvas.drawFastHLine(x, plan.averageY, 3, kAverageLineColor);
     }
 
   }
 
-  void drawCurrentArrow(int barX, int barW, int barY)
+  void drawCurrentArrow(ChartCanvas &canvas, int barX, int barW, int barY)
   {
     const int centerX = barX + (barW / 2);
     int tipY = barY - 1;
@@ -509,7 +948,7 @@ namespace
       tipY = baseY + kCurrentArrowHeight;
     }
 
-    tft.fillTriangle(
+    canvas.fillTriangle(
         centerX - kCurrentArrowHalfWidth,
         baseY,
         centerX + kCurrentArrowHalfWidth,
@@ -519,121 +958,253 @@ namespace
         kCurrentArrowColor);
   }
 
-  void drawCurrentMarker(const PriceState &state, const ChartRange &range, int xAxisY, int drawableH)
+  // Horizontal span covered by the marker line and arrow for bar `index`.
+  void markerColumn(const RenderPlan &plan, int index, int &x0, int &x1)
+  {
+    const PlannedBar &bar = plan.bars[index];
+    const int centerX = bar.x + (bar.w / 2);
+    x0 = centerX - kCurrentArrowHalfWidth;
+    x1 = centerX + kCurrentArrowHalfWidth + 1;
+  }
+
+  void drawCurrentMarker(ChartCanvas &canvas, const RenderPlan &plan, int currentIndex)
   {
-    if (state.currentIndex < 0 || state.currentIndex >= (int)state.count)
+    if (currentIndex < 0 || currentIndex >= (int)plan.barCount)
       return;
-    const int pointCount = (int)state.count;
-    const int i = state.currentIndex;
-    const int x0 = kChartX + (((int)i * kChartW) / pointCount);
-    const int x1 = kChartX + ((((int)i + 1) * kChartW) / pointCount);
-    const int w = max(1, x1 - x0);
-    const int y = priceToY(state.points[i].price, range, xAxisY, drawableH);
+    const PlannedBar &bar = plan.bars[currentIndex];
     // Thin pointer line from chart top down to bar top; arrow is drawn on top.
-    const int centerX = x0 + (w / 2);
-    const int lineEnd = max(y - 1, kChartY);
-    tft.drawFastVLine(centerX, kChartY, lineEnd - kChartY + 1, kCurrentArrowColor);
-    drawCurrentArrow(x0, w, y);
+    const int centerX = bar.x + (bar.w / 2);
+    const int lineEnd = max(bar.y - 1, kChartY);
+    canvas.drawFastVLine(centerX, kChartY, lineEnd - kChartY + 1, kCurrentArrowColor);
+    drawCurrentArrow(canvas, bar.x, bar.w, bar.y);
   }
 
-  void drawBars(const PriceState &state, const ChartRange &range, const LevelBand bands[5], int xAxisY, int drawableH)
+  void drawBars(ChartCanvas &canvas, const RenderPlan &plan, int clipX0 = kChartX, int clipX1 = kChartX + kChartW)
   {
-    char lastDay[11] = {0};
-    bool hasLastDay = false;
-    const int pointCount = (int)state.count;
-    for (size_t i = 0; i < state.count; ++i)
+    for (size_t i = 0; i < plan.barCount; ++i)
     {
-      const PricePoint &p = state.points[i];
-      const int x0 = kChartX + (((int)i * kChartW) / pointCount);
-      const int x1 = kChartX + ((((int)i + 1) * kChartW) / pointCount);
-      const int x = x0;
-      const int w = max(1, x1 - x0);
-      const int y = priceToY(p.price, range, xAxisY, drawableH);
-      const int h = xAxisY - y + 1;
-
-      if (h > 0)
-      {
-        tft.fillRect(x, y, w, h, barGradientColor(p, bands, range));
-      }
-
-      if (p.startsAt.length() < 10)
-        continue;
-      const char *startsAt = p.startsAt.c_str();
-      char dayKey[11];
-      memcpy(dayKey, startsAt, 10);
-      dayKey[10] = '\0';
-      if (hasLastDay && strncmp(dayKey, lastDay, 10) == 0)
+      const PlannedBar &bar = plan.bars[i];
+      if (bar.h <= 0 || bar.x + bar.w <= clipX0 || bar.x >= clipX1)
         continue;
+      canvas.fillRect(bar.x, bar.y, bar.w, bar.h, bar.color);
+    }
+  }
 
-      memcpy(lastDay, dayKey, sizeof(lastDay));
-      hasLastDay = true;
-
-      char dayText[6];
-      dayText[0] = startsAt[8];
-      dayText[1] = startsAt[9];
-      dayText[2] = '/';
-      dayText[3] = startsAt[5];
-      dayText[4] = startsAt[6];
-      dayText[5] = '\0';
-      tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-      tft.setTextFont(kTopXAxisFontSize);
-      tft.setTextDatum(TC_DATUM);
-      tft.drawString(dayText, x, kDayLabelY);
-      tft.setTextDatum(TL_DATUM);
+  // Day labels sit above the chart border, so they always go straight to the panel.
+  void drawDayLabels(const RenderPlan &plan)
+  {
+    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    tft.setTextFont(kTopXAxisFontSize);
+    tft.setTextDatum(TC_DATUM);
+    for (size_t i = 0; i < plan.dayLabelCount; ++i)
+    {
+      tft.drawString(plan.dayLabels[i].text, plan.dayLabels[i].x, kDayLabelY);
     }
+    tft.setTextDatum(TL_DATUM);
   }
 
-  void drawXAxisTicks(const PriceState &state)
+  void drawXAxisTicks(ChartCanvas &canvas, const RenderPlan &plan, int clipX0 = kChartX, int clipX1 = kChartX + kChartW)
   {
-    if (state.count == 0)
-      return;
+    // Ticks hang down from the top interior edge of the chart: tall every
+    // six hours, short otherwise.
+    for (size_t i = 0; i < plan.tickCount; ++i)
+    {
+      const PlannedTick &tick = plan.ticks[i];
+      if (tick.x < clipX0 || tick.x >= clipX1)
+        continue;
+      canvas.drawFastVLine(tick.x, kChartY, (tick.hour % 6 == 0) ? 8 : 4, TFT_LIGHTGREY);
+    }
+  }
 
-    const int pointCount = (int)state.count;
-    // Ticks hang down from the top interior edge of the chart.
-    const int tickTopY = kChartY;
+  void drawXAxisLabels(const RenderPlan &plan)
+  {
     // Labels sit just above the chart top border (2 px gap before border at kChartY-1).
-    const int labelY = tickTopY - 10;
+    const int labelY = kChartY - 10;
 
     tft.setTextFont(1);
     tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
     tft.setTextDatum(TC_DATUM);
-
-    for (size_t i = 0; i < state.count; ++i)
+    for (size_t i = 0; i < plan.tickCount; ++i)
     {
-      const PricePoint &p = state.points[i];
-      if (p.startsAt.length() < 16)
-        continue;
-      const char *s = p.startsAt.c_str();
-      if (s[10] != 'T')
-        continue;
-
-      const int hour   = (s[11] - '0') * 10 + (s[12] - '0');
-      const int minute = (s[14] - '0') * 10 + (s[15] - '0');
-      if (minute != 0)
+      const PlannedTick &tick = plan.ticks[i];
+      if (tick.hour % 6 != 0 || tick.hour == 0)  // Skip "00" — date label is shown at that position
         continue;
+      char label[3];
+      snprintf(label, sizeof(label), "%02u", (unsigned)tick.hour);
+      tft.drawString(label, tick.x, labelY);
+    }
+    tft.setTextDatum(TL_DATUM);
+  }
 
-      const int x = kChartX + (((int)i * kChartW) / pointCount);
-      const bool isMajor = (hour % 6 == 0);
+  // Everything inside the chart border, in back-to-front order.
+  void drawChartInterior(ChartCanvas &canvas, const RenderPlan &plan, int currentIndex)
+  {
+    canvas.fillRect(kChartX, kChartY, kChartW, kChartH, TFT_BLACK);
+    canvas.drawFastHLine(kChartX, plan.xAxisY, kChartW, TFT_DARKGREY);
+    drawBars(canvas, plan);
+    drawXAxisTicks(canvas, plan);
+    drawRunningAverage(canvas, plan);
+    drawCurrentMarker(canvas, plan, currentIndex);
+  }
 
-      if (isMajor)
+#if DISPLAY_CHART_DMA
+  bool allocateChartDma()
+  {
+#if DISPLAY_CHART_DMA_RGB666
+    // Internal RAM: PSRAM can't feed the SPI DMA.
+    for (uint8_t *&buffer : gChart.wide)
+    {
+      buffer = (uint8_t *)heap_caps_malloc(kChartWideBytes, MALLOC_CAP_DMA);
+      if (buffer == nullptr)
       {
-        // Tall tick hanging down from top of chart.
-        tft.drawFastVLine(x, tickTopY, 8, TFT_LIGHTGREY);
-        if (hour != 0)  // Skip "00" — date label is shown at that position
+        for (uint8_t *&allocated : gChart.wide)
         {
-          char label[3];
-          snprintf(label, sizeof(label), "%02d", hour);
-          tft.drawString(label, x, labelY);
+          heap_caps_free(allocated);
+          allocated = nullptr;
         }
+        LOG_WARN(
+            Display,
+            "Display DMA buffers unavailable (%u B), pushing synchronously",
+            (unsigned)(kChartWideBytes * 2));
+        return false;
       }
-      else
+    }
+#endif
+    return tft.initDMA();
+  }
+#endif
+
+  void allocateChartSprites()
+  {
+#if CONFIG_DISPLAY_SPRITE_CHART
+    if (psramFound())
+    {
+      gChart.full.setColorDepth(16);
+      gChart.hasFull = gChart.full.createSprite(kChartW, kChartH) != nullptr;
+    }
+    if (!gChart.hasFull)
+    {
+      gChart.hasBands = true;
+      for (int i = 0; i < kChartBandSprites; ++i)
+      {
+        gChart.band[i].setColorDepth(16);
+        gChart.hasBands = gChart.hasBands && gChart.band[i].createSprite(kChartW, kChartBandRows) != nullptr;
+      }
+      if (!gChart.hasBands)
       {
-        // Short tick hanging down from top of chart.
-        tft.drawFastVLine(x, tickTopY, 4, TFT_LIGHTGREY);
+        for (int i = 0; i < kChartBandSprites; ++i)
+          gChart.band[i].deleteSprite();
       }
     }
+#if DISPLAY_CHART_DMA
+    if (gChart.hasFull || gChart.hasBands)
+      gChart.dmaReady = allocateChartDma();
+#endif
+#endif
+    LOG_INFO(
+        Display,
+        "Display chart buffer: %s%s",
+        gChart.hasFull ? "sprite" : (gChart.hasBands ? "bands" : "direct"),
+        gChart.dmaReady ? "+dma" : "");
+  }
 
-    tft.setTextDatum(TL_DATUM);
+  // A DMA push may still be reading a sprite when the next draw starts; every
+  // entry point that touches the panel calls this first.
+  void finishChartPush()
+  {
+#if DISPLAY_CHART_DMA
+    if (!gChart.pushPending)
+      return;
+    tft.dmaWait();
+    tft.endWrite();
+    gChart.pushPending = false;
+#endif
+  }
+
+#if DISPLAY_CHART_DMA_RGB666
+  // Sprite pixels are RGB565, byte-swapped for the bus. The ILI9488 wants the
+  // top six bits of each channel in a byte of its own, as TFT_eSPI's own
+  // ILI9488 writes do. Each chunk is widened while the previous one is still
+  // going out of the other buffer.
+  void pushChartRgb666(TFT_eSprite &sprite, int y, int h)
+  {
+    const uint16_t *pixels = (const uint16_t *)sprite.getPointer();
+    for (int row = 0; row < h; row += kChartWideRows)
+    {
+      const int rows = min(kChartWideRows, h - row);
+      uint8_t *wide = gChart.wide[gChart.nextWide];
+      gChart.nextWide ^= 1;
+      const uint16_t *in = pixels + (size_t)row * kChartW;
+      uint8_t *out = wide;
+      for (int i = 0; i < rows * kChartW; ++i)
+      {
+        const uint16_t color = (uint16_t)((in[i] >> 8) | (in[i] << 8));
+        *out++ = (uint8_t)((color >> 8) & 0xF8);
+        *out++ = (uint8_t)((color >> 3) & 0xFC);
+        *out++ = (uint8_t)((color << 3) & 0xF8);
+      }
+      // The window can only move once the previous transfer is done.
+      tft.dmaWait();
+      tft.setAddrWindow(kChartX, y + row, kChartW, rows);
+      // Raw: swap bytes is only on inside blitAtlasText.
+      tft.pushPixelsDMA((uint16_t *)wide, (uint32_t)(out - wide) / 2);
+    }
+  }
+#endif
+
+  void pushChartBuffer(TFT_eSprite &sprite, int y, int h)
+  {
+#if DISPLAY_CHART_DMA
+    if (gChart.dmaReady)
+    {
+      if (!gChart.pushPending)
+      {
+        tft.startWrite();
+        gChart.pushPending = true;
+      }
+#if DISPLAY_CHART_DMA_RGB666
+      pushChartRgb666(sprite, y, h);
+#else
+      // Waits for the previous strip, then returns as soon as this one is queued.
+      tft.pushImageDMA(kChartX, y, kChartW, h, (uint16_t *)sprite.getPointer());
+#endif
+      return;
+    }
+#endif
+    sprite.pushSprite(kChartX, y);
+  }
+
+  void renderChart(const RenderPlan &plan, int currentIndex)
+  {
+    ChartCanvas canvas;
+    if (gChart.hasFull)
+    {
+      canvas.gfx = &gChart.full;
+      canvas.originX = kChartX;
+      canvas.originY = kChartY;
+      drawChartInterior(canvas, plan, currentIndex);
+      pushChartBuffer(gChart.full, kChartY, kChartH);
+      return;
+    }
+
+    if (gChart.hasBands)
+    {
+      int next = 0;
+      for (int bandY = kChartY; bandY < (kChartY + kChartH); bandY += kChartBandRows)
+      {
+        TFT_eSprite &band = gChart.band[next];
+        next = (next + 1) % kChartBandSprites;
+        canvas.gfx = &band;
+        canvas.originX = kChartX;
+        canvas.originY = bandY;
+        drawChartInterior(canvas, plan, currentIndex);
+        pushChartBuffer(band, bandY, min(kChartBandRows, (kChartY + kChartH) - bandY));
+      }
+      return;
+    }
+
+    canvas.gfx = &tft;
+    drawChartInterior(canvas, plan, currentIndex);
   }
 
   void drawCenteredLine(const char *text, int y, int font, uint16_t color)
@@ -644,11 +1215,6 @@ namespace
     tft.drawString((text != nullptr) ? text : "", kScreenCenterX, y);
   }
 
-  void drawCenteredLine(const String &text, int y, int font, uint16_t color)
-  {
-    drawCenteredLine(text.c_str(), y, font, color);
-  }
-
   void drawFetchErrorBanner()
   {
     tft.setTextFont(2);
@@ -656,6 +1222,191 @@ namespace
     tft.setTextDatum(TL_DATUM);
     tft.drawString("Failed to contact Nordpool!", 4, kSourceLabelY + 5);
   }
+
+  void drawTopBanner(bool hasFetchError)
+  {
+    if (gNotice[0] == '\0')
+    {
+      if (hasFetchError)
+        drawFetchErrorBanner();
+      return;
+    }
+    tft.setTextFont(2);
+    tft.setTextColor(TFT_YELLOW, TFT_BLACK);
+    tft.setTextDatum(TL_DATUM);
+    tft.drawString(gNotice, 4, kSourceLabelY + 5);
+  }
+
+  uint32_t chartSignature(const PriceState &state)
+  {
+    // The price-set fingerprint already covers points and the average.
+    if (state.fingerprint != 0)
+      return state.fingerprint;
+
+    // FNV-1a over everything the chart area depends on.
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void *data, size_t len)
+    {
+      const uint8_t *bytes = (const uint8_t *)data;
+      for (size_t i = 0; i < len; ++i)
+      {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+      }
+    };
+    mix(&state.count, sizeof(state.count));
+    mix(&state.hasRunningAverage, sizeof(state.hasRunningAverage));
+    mix(&state.runningAverage, sizeof(state.runningAverage));
+    mix(state.points, state.count * sizeof(PricePoint));
+    return hash;
+  }
+
+  uint16_t currentPriceColor(const PriceState &state, const RenderPlan &plan)
+  {
+    if (state.currentIndex >= 0 && state.currentIndex < (int)plan.barCount)
+      return plan.bars[state.currentIndex].color;
+    return levelColor(state.currentLevel);
+  }
+
+  void rememberFrame(const PriceState &state, uint32_t signature, uint16_t priceColor)
+  {
+    gFrame.valid = true;
+    gFrame.hasErrorBanner = state.error[0] != '\0';
+    gFrame.chartSignature = signature;
+    gFrame.currentIndex = state.currentIndex;
+    gFrame.currentPrice = state.currentPrice;
+    gFrame.priceColor = priceColor;
+    copyStateText(gFrame.currency, state.currency);
+  }
+
+  // Repaints the chart strip [x0, x1) below the top border: background, bars,
+  // ticks and average line, in the same order as a full draw.
+  void restoreChartColumn(const RenderPlan &plan, int x0, int x1)
+  {
+    x0 = max(x0, kChartX);
+    x1 = min(x1, kChartX + kChartW);
+    if (x1 <= x0)
+      return;
+    ChartCanvas canvas;
+    canvas.gfx = &tft;
+    canvas.fillRect(x0, kChartY, x1 - x0, plan.xAxisY - kChartY + 1, TFT_BLACK);
+    canvas.drawFastHLine(x0, plan.xAxisY, x1 - x0, TFT_DARKGREY);
+    drawBars(canvas, plan, x0, x1);
+    drawXAxisTicks(canvas, plan, x0, x1);
+    drawRunningAverage(canvas, plan, x0, x1);
+  }
+
+  // Returns false when the change needs a full redraw.
+  bool drawPricesIncremental(const PriceState &state, uint32_t signature)
+  {
+    const bool hasErrorBanner = state.error[0] != '\0';
+    if (!gFrame.valid || !state.ok || state.count == 0)
+      return false;
+    if (gFrame.chartSignature != signature || gFrame.hasErrorBanner != hasErrorBanner)
+      return false;
+    if (gFrame.currentIndex >= (int)state.count)
+      return false;
+
+    const RenderPlan &plan = renderPlanFor(state, signature);
+    const uint16_t priceColor = currentPriceColor(state, plan);
+
+    const bool priceChanged = gFrame.currentPrice != state.currentPrice || gFrame.priceColor != priceColor ||
+                              (gFrame.currentIndex < 0) != (state.currentIndex < 0) ||
+                              !stateTextEquals(gFrame.currency, state.currency);
+    const bool markerChanged = gFrame.currentIndex != state.currentIndex;
+
+    tft.setTextWrap(false);
+    tft.setTextSize(1);
+    if (priceChanged)
+    {
+      const ScreenRect old = gFrame.priceRect;
+      if (old.w > 0 && old.h > 0)
+        tft.fillRect(old.x, old.y, old.w, old.h, TFT_BLACK);
+      gFrame.priceRect = ScreenRect();
+      if (state.currentIndex >= 0)
+        drawPriceText(state.currentPrice, state.currency, priceColor);
+      tft.setTextDatum(TL_DATUM);
+      drawTopBanner(hasErrorBanner);
+    }
+    drawClockLabel();
+
+    if (markerChanged)
+    {
+      if (gFrame.currentIndex >= 0)
+      {
+        int oldX0 = 0;
+        int oldX1 = 0;
+        markerColumn(plan, gFrame.currentIndex, oldX0, oldX1);
+        restoreChartColumn(plan, oldX0, oldX1);
+      }
+      ChartCanvas canvas;
+      canvas.gfx = &tft;
+      drawCurrentMarker(canvas, plan, state.currentIndex);
+    }
+
+    rememberFrame(state, signature, priceColor);
+    return true;
+  }
+
+  // One vertical min..max line per column, coloured by the column mean on
+  // the same global gradient the bars fall back to. Drawn straight to the
+  // panel: the page is only repainted when a new day lands.
+  void drawHistoryColumns(const HistoryView &view, const PriceFormula &formula, const ChartRange &range)
+  {
+    const int xAxisY = kChartY + kChartH - 1;
+    const int drawableH = kChartH - 4;
+    LevelBand bands[kLevelBandCount];  // no level bands: every column takes the global gradient
+    PricePoint sample;
+    sample.level = PriceLevel::Unknown;
+
+    ChartCanvas canvas;
+    canvas.gfx = &tft;
+    canvas.fillRect(kChartX, kChartY, kChartW, kChartH, TFT_BLACK);
+    canvas.drawFastHLine(kChartX, xAxisY, kChartW, TFT_DARKGREY);
+    const int columns = min((int)view.columnCount, kChartW);
+    for (int x = 0; x < columns; ++x)
+    {
+      const HistoryColumn &column = view.columns[x];
+      if (column.count == 0)
+        continue;
+      const int yTop = priceToY(applyPriceFormula(formula, column.max), range, xAxisY, drawableH);
+      const int yBottom = priceToY(applyPriceFormula(formula, column.min), range, xAxisY, drawableH);
+      sample.price = applyPriceFormula(formula, (int32_t)(column.sum / column.count));
+      const uint16_t color = barGradientColor(sample, bands, range.minPrice, range.span);
+      canvas.drawFastVLine(kChartX + x, yTop, yBottom - yTop + 1, color);
+    }
+  }
+
+  void drawHistoryDayLabels(const HistoryView &view)
+  {
+    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    tft.setTextFont(kTopXAxisFontSize);
+    tft.setTextDatum(TC_DATUM);
+    const uint32_t startsAt = historyViewStartsAt(view);
+    const int columns = min((int)view.columnCount, kChartW);
+    int lastYday = -1;
+    int lastLabelX = -kHistoryDayLabelMinGapPx;
+    for (int x = 0; x < columns; ++x)
+    {
+      struct tm localTm;
+      if (!localTimeFromUtc((time_t)(startsAt + (uint32_t)x * view.secondsPerColumn), localTm))
+        continue;
+      if (localTm.tm_yday == lastYday)
+        continue;
+      const bool firstColumn = lastYday < 0;
+      lastYday = localTm.tm_yday;
+      if (firstColumn && localTm.tm_hour != 0)
+        continue;  // the window starts mid-day; label the next midnight
+      if (x - lastLabelX < kHistoryDayLabelMinGapPx)
+        continue;
+      lastLabelX = x;
+      char text[6];
+      snprintf(text, sizeof(text), "%02d/%02d", localTm.tm_mday, localTm.tm_mon + 1);
+      tft.drawString(text, kChartX + x, kDayLabelY);
+      tft.drawFastVLine(kChartX + x, kChartY, 4, TFT_LIGHTGREY);
+    }
+    tft.setTextDatum(TL_DATUM);
+  }
 } // namespace
 
 void displayInit()
@@ -670,11 +1421,25 @@ void displayInit()
   ofr.setDrawer(tft);
   ofr.setBackgroundFillMethod(BgFillMethod::Block);
   gOpenFontReady = (ofr.loadFont(NotoSans_Bold, sizeof(NotoSans_Bold)) == 0);
-  logf("Display OpenFontRender: %s", gOpenFontReady ? "ready" : "fallback");
+  LOG_INFO(Display, "Display OpenFontRender: %s", gOpenFontReady ? "ready" : "fallback");
+  buildGlyphAtlases();
+  allocateChartSprites();
 }
 
 void displayDrawPrices(const PriceState &state)
 {
+  const PerfScope span(PerfSpan::DisplayFrame);
+  finishChartPush();
+  const uint32_t startUs = micros();
+  const uint32_t signature = chartSignature(state);
+  if (drawPricesIncremental(state, signature))
+  {
+    LOG_DEBUG(Display, "Display frame: partial %lu us", (unsigned long)(micros() - startUs));
+    return;
+  }
+
+  gFrame = RenderedFrame();
+  gHistoryFrame = HistoryFrame();
   tft.fillScreen(TFT_BLACK);
   tft.setTextWrap(false);
   tft.setTextSize(1);
@@ -683,13 +1448,11 @@ void displayDrawPrices(const PriceState &state)
   if (!state.ok)
   {
     drawErrorScreen(state.error);
+    drawTopBanner(false);
     return;
   }
 
-  if (!state.error.isEmpty())
-  {
-    drawFetchErrorBanner();
-  }
+  drawTopBanner(state.error[0] != '\0');
 
   if (state.count == 0)
   {
@@ -698,31 +1461,114 @@ void displayDrawPrices(const PriceState &state)
     return;
   }
 
-  const int xAxisY = kChartY + kChartH - 1;
-  const int drawableH = kChartH - 4;
-  const ChartRange range = computeChartRange(state);
-  LevelBand bands[5];
-  computeLevelBands(state, bands);
+  const RenderPlan &plan = renderPlanFor(state, signature);
+  const uint16_t priceColor = currentPriceColor(state, plan);
+  // No current slot until the clock is valid: chart only, no price or marker.
+  if (state.currentIndex >= 0)
+    drawPriceText(state.currentPrice, state.currency, priceColor);
+  tft.setTextDatum(TL_DATUM);
+  drawAreaLabel(state);
+
+  tft.drawRect(kChartX - 1, kChartY - 1, kChartW + 2, kChartH + 2, TFT_DARKGREY);
+  drawYAxis(plan.range, plan.xAxisY, plan.drawableH);
+  drawDayLabels(plan);
+  drawXAxisLabels(plan);
+  // Last, so a DMA push of the chart can overlap whatever the caller does next.
+  renderChart(plan, state.currentIndex);
+  rememberFrame(state, signature, priceColor);
+  LOG_DEBUG(Display, "Display frame: full %lu us", (unsigned long)(micros() - startUs));
+}
 
-  uint16_t currentPriceColor = levelColor(state.currentLevel);
-  if (state.currentIndex >= 0 && state.currentIndex < (int)state.count)
+int displayChartWidth()
+{
+  return kChartW;
+}
+
+void displayDrawHistory(const HistoryView &view, const PriceState &state, const PriceFormula &formula)
+{
+  const PerfScope span(PerfSpan::DisplayFrame);
+  finishChartPush();
+  if (gHistoryFrame.valid && gHistoryFrame.revision == view.revision)
   {
-    currentPriceColor = barGradientColor(state.points[state.currentIndex], bands, range);
+    drawClockLabel();
+    return;
   }
-  drawPriceText(state.currentPrice, state.currency, currentPriceColor);
+
+  const uint32_t startUs = micros();
+  gFrame = RenderedFrame();
+  tft.fillScreen(TFT_BLACK);
+  tft.setTextWrap(false);
+  tft.setTextSize(1);
+  drawClockLabel();
+  drawTopBanner(false);
+
+  ChartRange range;
+  bool hasSamples = false;
+  int64_t sum = 0;
+  uint32_t samples = 0;
+  const int columns = min((int)view.columnCount, kChartW);
+  for (int x = 0; x < columns; ++x)
+  {
+    const HistoryColumn &column = view.columns[x];
+    if (column.count == 0)
+      continue;
+    const int32_t low = applyPriceFormula(formula, column.min);
+    const int32_t high = applyPriceFormula(formula, column.max);
+    if (!hasSamples || low < range.minPrice)
+      range.minPrice = low;
+    if (!hasSamples || high > range.maxPrice)
+      range.maxPrice = high;
+    hasSamples = true;
+    sum += column.sum;
+    samples += column.count;
+  }
+  gHistoryFrame.valid = true;
+  gHistoryFrame.revision = view.revision;
+  if (!hasSamples)
+  {
+    drawCenteredLine("No price history yet", kErrorTitleY, 4, TFT_LIGHTGREY);
+    return;
+  }
+  range.span = range.maxPrice - range.minPrice;
+  if (range.span < kMinBandSpan)
+    range.span = kMinBandSpan;
+
+  char average[12];
+  formatPriceFixed(applyPriceFormula(formula, (int32_t)(sum / samples)), 2, average, sizeof(average));
+  char title[40];
+  snprintf(title, sizeof(title), "%u days  avg %s %s", (unsigned)kHistoryViewDays, average, state.currency);
+  drawCenteredLine(title, kPriceCenterY, 4, TFT_WHITE);
   tft.setTextDatum(TL_DATUM);
 
+  const int xAxisY = kChartY + kChartH - 1;
+  const int drawableH = kChartH - 4;
   tft.drawRect(kChartX - 1, kChartY - 1, kChartW + 2, kChartH + 2, TFT_DARKGREY);
-  tft.drawFastHLine(kChartX, xAxisY, kChartW, TFT_DARKGREY);
   drawYAxis(range, xAxisY, drawableH);
-  drawBars(state, range, bands, xAxisY, drawableH);
-  drawXAxisTicks(state);
-  drawRunningAverage(state, range, xAxisY, drawableH);
-  drawCurrentMarker(state, range, xAxisY, drawableH);
+  drawHistoryColumns(view, formula, range);
+  drawHistoryDayLabels(view);
+  if (state.hasRunningAverage && state.runningAverage >= range.minPrice && state.runningAverage <= range.maxPrice)
+  {
+    const int yAvg = priceToY(state.runningAverage, range, xAxisY, drawableH);
+    for (int x = kChartX; x < (kChartX + kChartW); x += 6)
+      tft.drawFastHLine(x, yAvg, 3, kAverageLineColor);
+  }
+  LOG_DEBUG(Display, "Display frame: history %lu us", (unsigned long)(micros() - startUs));
+}
+
+void displaySetNotice(const char *text)
+{
+  const char *next = (text != nullptr) ? text : "";
+  if (strcmp(gNotice, next) == 0)
+    return;
+  snprintf(gNotice, sizeof(gNotice), "%s", next);
+  // The next draw repaints everything, banner included.
+  gFrame = RenderedFrame();
+  gHistoryFrame = HistoryFrame();
 }
 
 void displayRefreshClock()
 {
+  finishChartPush();
   drawClockLabel();
 }
 
@@ -732,6 +1578,9 @@ void displayDrawWifiConfigPortal(const char *apName, uint16_t timeoutSeconds)
   char timeoutBuf[24];
   snprintf(timeoutBuf, sizeof(timeoutBuf), "Portal timeout: %us", (unsigned)timeoutSeconds);
 
+  finishChartPush();
+  gFrame = RenderedFrame();
+  gHistoryFrame = HistoryFrame();
   tft.fillScreen(TFT_BLACK);
   tft.setTextWrap(false);
   drawCenteredLine("Wi-Fi Setup Mode", kWifiTitleY, 4, TFT_CYAN);
@@ -749,6 +1598,9 @@ void displayDrawWifiConfigTimeout(uint16_t timeoutSeconds)
   char timeoutBuf[40];
   snprintf(timeoutBuf, sizeof(timeoutBuf), "Timed out after %us", (unsigned)timeoutSeconds);
 
+  finishChartPush();
+  gFrame = RenderedFrame();
+  gHistoryFrame = HistoryFrame();
   tft.fillScreen(TFT_BLACK);
   tft.setTextWrap(false);
   drawCenteredLine("Wi-Fi Setup Timed Out", kWifiToutTitleY, 4, TFT_RED);
@@ -0,0 +1,202 @@
+#include "flash_storage.h"
+
+#if CONFIG_STORAGE_LITTLEFS
+#include <LittleFS.h>
+#else
+#include <SPIFFS.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+
+#include "logging_utils.h"
+
+namespace {
+#if CONFIG_STORAGE_LITTLEFS
+// LittleFS renames over an existing file atomically and opens/appends
+// without scanning the whole partition.
+auto &gFs = LittleFS;
+constexpr char kStorageName[] = "LittleFS";
+constexpr bool kRenameReplaces = true;
+#else
+// SPIFFS refuses to rename onto an existing name, so a replace goes through
+// a "<path>.new" name and the gap is covered by recoverInterruptedReplace.
+auto &gFs = SPIFFS;
+constexpr char kStorageName[] = "SPIFFS";
+constexpr bool kRenameReplaces = false;
+#endif
+
+constexpr size_t kMaxPathLen = 32;
+
+StorageStats gStats;
+
+void committedPath(const char *path, char *out, size_t outSize) {
+  snprintf(out, outSize, "%s.new", path);
+}
+
+// A "<path>.new" only exists once its temp file was fully written and
+// closed, so it is safe to finish the replace with it. A leftover
+// "<path>.tmp" may be partial and is never promoted; the next save
+// truncates it.
+void recoverInterruptedReplace(const char *path) {
+  char newPath[kMaxPathLen];
+  committedPath(path, newPath, sizeof(newPath));
+  if (!gFs.exists(newPath)) return;
+  if (gFs.exists(path) && !gFs.remove(path)) return;
+  if (gFs.rename(newPath, path)) {
+    ++gStats.recoveries;
+    LOG_WARN(Storage, "Storage recovered %s from interrupted replace", path);
+  }
+}
+}  // namespace
+
+bool storageMount() {
+  static bool attempted = false;
+  static bool mounted = false;
+  if (!attempted) {
+    attempted = true;
+    const uint32_t startMs = millis();
+    mounted = gFs.begin(true);
+    const unsigned long elapsedMs = millis() - startMs;
+    if (mounted) {
+      LOG_INFO(
+          Storage,
+          "%s mount: ok in %lu ms, used=%u total=%u",
+          kStorageName,
+          elapsedMs,
+          (unsigned)gFs.usedBytes(),
+          (unsigned)gFs.totalBytes());
+    } else {
+      LOG_ERROR(Storage, "%s mount: failed in %lu ms", kStorageName, elapsedMs);
+    }
+  }
+  return mounted;
+}
+
+fs::FS &storageFs() {
+  return gFs;
+}
+
+const char *storageName() {
+  return kStorageName;
+}
+
+File storageOpen(const char *path, const char *mode) {
+  if (!storageMount()) return File();
+  if (strcmp(mode, FILE_READ) == 0) recoverInterruptedReplace(path);
+  return gFs.open(path, mode);
+}
+
+size_t storageRead(File &file, void *data, size_t len) {
+  const uint32_t startUs = micros();
+  const size_t read = file.read((uint8_t *)data, len);
+  gStats.readUs += micros() - startUs;
+  ++gStats.reads;
+  gStats.bytesRead += read;
+  return read;
+}
+
+size_t storageWrite(File &file, const void *data, size_t len) {
+  const uint32_t startUs = micros();
+  const size_t written = file.write((const uint8_t *)data, len);
+  gStats.writeUs += micros() - startUs;
+  ++gStats.writes;
+  gStats.bytesWritten += written;
+  return written;
+}
+
+bool storageExists(const char *path) {
+  if (!storageMount()) return false;
+  recoverInterruptedReplace(path);
+  return gFs.exists(path);
+}
+
+size_t storageFileSize(const char *path) {
+  File file = storageOpen(path, FILE_READ);
+  if (!file) return 0;
+  const size_t size = (size_t)file.size();
+  file.close();
+  return size;
+}
+
+bool storageRemove(const char *path) {
+  if (!storageMount()) return false;
+  char tempPath[kMaxPathLen];
+  storageTempPath(path, tempPath, sizeof(tempPath));
+  if (gFs.exists(tempPath)) gFs.remove(tempPath);
+  committedPath(path, tempPath, sizeof(tempPath));
+  if (gFs.exists(tempPath)) gFs.remove(tempPath);
+  return !gFs.exists(path) || gFs.remove(path);
+}
+
+bool storageAppend(const char *path, const void *data, size_t len) {
+  File file = storageOpen(path, FILE_APPEND);
+  if (!file) return false;
+  const bool written = storageWrite(file, data, len) == len;
+  file.flush();
+  file.close();
+  return written;
+}
+
+void storageTempPath(const char *path, char *out, size_t outSize) {
+  snprintf(out, outSize, "%s.tmp", path);
+}
+
+bool storageCommit(const char *tempPath, const char *path) {
+  if (!storageMount()) return false;
+  const uint32_t startUs = micros();
+  bool renamed = false;
+  if (kRenameReplaces) {
+    renamed = gFs.rename(tempPath, path);
+  } else {
+    // Mark the temp complete before the target goes away.
+    char newPath[kMaxPathLen];
+    committedPath(path, newPath, sizeof(newPath));
+    if (gFs.exists(newPath)) gFs.remove(newPath);
+    renamed = gFs.rename(tempPath, newPath) && (!gFs.exists(path) || gFs.remove(path)) && gFs.rename(newPath, path);
+  }
+  gStats.writeUs += micros() - startUs;
+  if (!renamed) {
+    LOG_ERROR(Storage, "Storage commit failed: %s", path);
+    return false;
+  }
+  ++gStats.replaces;
+  return true;
+}
+
+bool storageWriteAtomic(const char *path, const StorageChunk *chunks, size_t count) {
+  char tempPath[kMaxPathLen];
+  storageTempPath(path, tempPath, sizeof(tempPath));
+  File file = storageOpen(tempPath, FILE_WRITE);
+  if (!file) return false;
+
+  bool written = true;
+  for (size_t i = 0; i < count && written; ++i) {
+    written = storageWrite(file, chunks[i].data, chunks[i].len) == chunks[i].len;
+  }
+  file.flush();
+  file.close();
+  if (!written) {
+    gFs.remove(tempPath);
+    return false;
+  }
+  return storageCommit(tempPath, path);
+}
+
+StorageStats storageStats() {
+  return gStats;
+}
+
+void storageLogStats() {
+  LOG_INFO(
+      Storage,
+      "%s I/O: reads=%lu read=%luB in %lu us, writes=%lu written=%luB in %lu us, replaces=%lu recovered=%lu",
+      kStorageName,
+      (unsigned long)gStats.reads,
+      (unsigned long)gStats.bytesRead,
+      (unsigned long)gStats.readUs,
+      (unsigned long)gStats.writes,
+      (unsigned long)gStats.bytesWritten,
+      (unsigned long)gStats.writeUs,
+      (unsigned long)gStats.replaces,
+      (unsigned long)gStats.recoveries);
+}
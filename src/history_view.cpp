@@ -0,0 +1,73 @@
+#include "history_view.h"
+
+#include <string.h>
+
+#include "logging_utils.h"
+#include "price_history.h"
+
+namespace {
+constexpr uint32_t kSecondsPerDay = 86400;
+
+void addHistorySample(void *ctx, uint32_t slotStart, int32_t rawPrice) {
+  historyViewAdd(*(HistoryView *)ctx, slotStart, rawPrice);
+}
+
+void slideWindow(HistoryView &view, uint32_t columns) {
+  if (columns >= view.columnCount) {
+    for (uint16_t i = 0; i < view.columnCount; ++i) view.columns[i] = HistoryColumn();
+  } else {
+    const size_t kept = view.columnCount - columns;
+    memmove(view.columns, view.columns + columns, kept * sizeof(HistoryColumn));
+    for (size_t i = kept; i < view.columnCount; ++i) view.columns[i] = HistoryColumn();
+  }
+  view.endsAt += columns * view.secondsPerColumn;
+}
+}  // namespace
+
+void historyViewReset(HistoryView &view, uint16_t columnCount) {
+  view = HistoryView();
+  view.columnCount = columnCount < kHistoryViewMaxColumns ? columnCount : (uint16_t)kHistoryViewMaxColumns;
+  if (view.columnCount == 0) return;
+  view.secondsPerColumn = ((uint32_t)kHistoryViewDays * kSecondsPerDay) / view.columnCount;
+  if (view.secondsPerColumn == 0) view.secondsPerColumn = 1;
+}
+
+void historyViewAdd(HistoryView &view, uint32_t slotStart, int32_t rawPrice) {
+  if (view.columnCount == 0 || slotStart == 0 || slotStart <= view.lastSlotStart) return;
+
+  if (view.endsAt == 0) {
+    view.endsAt = slotStart + view.secondsPerColumn;
+  } else if (slotStart >= view.endsAt) {
+    slideWindow(view, (slotStart - view.endsAt) / view.secondsPerColumn + 1);
+  }
+  view.lastSlotStart = slotStart;
+  const uint32_t startsAt = historyViewStartsAt(view);
+  if (slotStart < startsAt) return;
+
+  HistoryColumn &column = view.columns[(slotStart - startsAt) / view.secondsPerColumn];
+  if (column.count == 0 || rawPrice < column.min) column.min = rawPrice;
+  if (column.count == 0 || rawPrice > column.max) column.max = rawPrice;
+  column.sum += rawPrice;
+  ++column.count;
+  ++view.revision;
+}
+
+bool historyViewUpdate(HistoryView &view) {
+  if (view.columnCount == 0) return false;
+
+  // The first pass places the window so it ends with the newest recorded
+  // slot and reads only the days inside it; later passes read new days.
+  uint32_t from = view.lastSlotStart + 1;
+  if (view.endsAt == 0) {
+    const uint32_t newest = priceHistoryLastSlotStart();
+    if (newest == 0) return true;
+    view.endsAt = newest + view.secondsPerColumn;
+    from = historyViewStartsAt(view);
+  }
+  const uint32_t before = view.revision;
+  const bool ok = priceHistoryForEachSample(from, addHistorySample, &view);
+  if (view.revision != before) {
+    LOG_DEBUG(App, "History view updated: revision=%lu", (unsigned long)view.revision);
+  }
+  return ok;
+}
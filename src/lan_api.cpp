@@ -0,0 +1,326 @@
+#include "lan_api.h"
+
+#if CONFIG_LAN_API
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "logging_utils.h"
+#include "price_fixed.h"
+#include "price_state_utils.h"
+
+namespace {
+// [epoch,price,level] is at most ~26 bytes; 240 points plus the header fit.
+constexpr size_t kBodyCapacity = 7168;
+constexpr size_t kBodyBuffers = 2;
+constexpr size_t kRequestLineLen = 160;
+constexpr uint32_t kRequestTimeoutMs = 1000;
+constexpr uint32_t kAcceptPollMs = 25;
+constexpr uint32_t kLinkPollMs = 250;
+constexpr uint32_t kListenRetryMs = 5000;
+constexpr uint32_t kServerStackBytes = 4096;
+constexpr UBaseType_t kServerPriority = 1;
+constexpr BaseType_t kServerCore = 0;
+constexpr uint8_t kNoBuffer = 0xFF;
+
+struct BodyBuffer {
+  char json[kBodyCapacity];
+  size_t len = 0;
+  char etag[12] = "";
+};
+
+// The loop task serializes into a buffer that is neither published nor
+// being sent, then publishes it; the server task marks the buffer it sends.
+// Neither side ever copies or locks the body.
+BodyBuffer gBodies[kBodyBuffers];
+std::atomic<uint8_t> gPublished{kNoBuffer};
+std::atomic<uint8_t> gSending{kNoBuffer};
+
+// What the published body was built from.
+struct ServedKey {
+  bool valid = false;
+  bool ok = false;
+  uint32_t fingerprint = 0;
+  int currentIndex = -1;
+  char source[kStateSourceLen] = "";
+  char error[kStateErrorLen] = "";
+};
+ServedKey gServed;
+
+WiFiServer gServer(CONFIG_LAN_API_PORT);
+TaskHandle_t gServerTask = nullptr;
+
+struct JsonWriter {
+  char *out;
+  size_t capacity;
+  size_t len = 0;
+  bool overflow = false;
+
+  void append(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (overflow) return;
+    va_list args;
+    va_start(args, fmt);
+    const int written = vsnprintf(out + len, capacity - len, fmt, args);
+    va_end(args);
+    if (written < 0 || (size_t)written >= capacity - len) {
+      overflow = true;
+      return;
+    }
+    len += (size_t)written;
+  }
+};
+
+// State text is device-generated (area codes, currency, short errors), so
+// only quotes and backslashes need escaping.
+void appendJsonString(JsonWriter &writer, const char *key, const char *value) {
+  writer.append("\"%s\":\"", key);
+  for (const char *c = value; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      writer.append("\\%c", *c);
+    } else if ((unsigned char)*c >= 0x20) {
+      writer.append("%c", *c);
+    }
+  }
+  writer.append("\"");
+}
+
+bool serializeState(const PriceState &state, BodyBuffer &body) {
+  JsonWriter writer{body.json, sizeof(body.json)};
+  writer.append("{\"ok\":%s,", state.ok ? "true" : "false");
+  appendJsonString(writer, "source", state.source);
+  writer.append(",");
+  appendJsonString(writer, "area", state.area);
+  writer.append(",");
+  appendJsonString(writer, "currency", state.currency);
+  writer.append(",");
+  appendJsonString(writer, "error", state.error);
+  writer.append(",\"resolutionMinutes\":%u", (unsigned)state.resolutionMinutes);
+  char price[16];
+  if (state.hasRunningAverage) {
+    formatPriceFixed(state.runningAverage, 4, price, sizeof(price));
+    writer.append(",\"runningAverage\":%s", price);
+  }
+  if (state.currentIndex >= 0 && state.currentIndex < (int)state.count) {
+    formatPriceFixed(state.currentPrice, 4, price, sizeof(price));
+    writer.append(
+        ",\"current\":{\"index\":%d,\"startsAt\":%lu,\"price\":%s,\"level\":\"%s\"}",
+        state.currentIndex,
+        (unsigned long)state.currentStartsAt,
+        price,
+        priceLevelName(state.currentLevel));
+  }
+  // Points are [startsAt, price, level] with level as the PriceLevel value.
+  writer.append(",\"points\":[");
+  for (size_t i = 0; i < state.count; ++i) {
+    const PricePoint &point = state.points[i];
+    formatPriceFixed(point.price, 4, price, sizeof(price));
+    writer.append("%s[%lu,%s,%u]", i == 0 ? "" : ",", (unsigned long)point.startsAt, price, (unsigned)point.level);
+  }
+  writer.append("]}");
+  if (writer.overflow) return false;
+
+  body.len = writer.len;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < body.len; ++i) {
+    hash = (hash ^ (uint8_t)body.json[i]) * 16777619u;
+  }
+  snprintf(body.etag, sizeof(body.etag), "\"%08lx\"", (unsigned long)hash);
+  return true;
+}
+
+bool sameAsServed(const PriceState &state) {
+  return gServed.valid && gServed.ok == state.ok && gServed.fingerprint == state.fingerprint &&
+         gServed.currentIndex == state.currentIndex && stateTextEquals(gServed.source, state.source) &&
+         stateTextEquals(gServed.error, state.error);
+}
+
+// Reads one CRLF-terminated line; false on timeout or disconnect.
+bool readLine(WiFiClient &client, char *line, size_t lineSize, uint32_t deadlineMs) {
+  size_t len = 0;
+  while ((int32_t)(deadlineMs - millis()) > 0) {
+    if (!client.connected() && client.available() <= 0) return false;
+    const int c = client.read();
+    if (c < 0) {
+      vTaskDelay(pdMS_TO_TICKS(2));
+      continue;
+    }
+    if (c == '\n') {
+      if (len > 0 && line[len - 1] == '\r') --len;
+      line[len] = '\0';
+      return true;
+    }
+    if (len + 1 < lineSize) line[len++] = (char)c;
+  }
+  return false;
+}
+
+void sendStatus(WiFiClient &client, const char *status) {
+  char head[128];
+  const int len = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", status);
+  client.write((const uint8_t *)head, (size_t)len);
+}
+
+void handleClient(WiFiClient &client) {
+  const uint32_t deadlineMs = millis() + kRequestTimeoutMs;
+  char line[kRequestLineLen];
+  if (!readLine(client, line, sizeof(line), deadlineMs)) return;
+
+  const bool isGet = strncmp(line, "GET ", 4) == 0;
+  const bool isHead = strncmp(line, "HEAD ", 5) == 0;
+  const char *path = line + (isHead ? 5 : 4);
+  const bool pricesPath = strncmp(path, "/api/prices ", 12) == 0 || strncmp(path, "/api/prices?", 12) == 0;
+
+  char ifNoneMatch[16] = "";
+  while (readLine(client, line, sizeof(line), deadlineMs) && line[0] != '\0') {
+    if (strncasecmp(line, "If-None-Match:", 14) == 0) {
+      const char *value = line + 14;
+      while (*value == ' ') ++value;
+      strncpy(ifNoneMatch, value, sizeof(ifNoneMatch) - 1);
+    }
+  }
+
+  if (!isGet && !isHead) {
+    sendStatus(client, "405 Method Not Allowed");
+    return;
+  }
+  if (!pricesPath) {
+    sendStatus(client, "404 Not Found");
+    return;
+  }
+
+  // Mark first, then confirm it is still the published one: the loop only
+  // rewrites a buffer it saw neither published nor marked.
+  uint8_t index = kNoBuffer;
+  do {
+    index = gPublished.load();
+    gSending.store(index);
+  } while (gPublished.load() != index);
+  if (index == kNoBuffer) {
+    sendStatus(client, "503 Service Unavailable");
+    return;
+  }
+  const BodyBuffer &body = gBodies[index];
+
+  const bool notModified = ifNoneMatch[0] != '\0' && strcmp(ifNoneMatch, body.etag) == 0;
+  char head[256];
+  const int headLen = snprintf(
+      head,
+      sizeof(head),
+      "HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\nETag: %s\r\n"
+      "Cache-Control: no-cache\r\nConnection: close\r\n\r\n",
+      notModified ? "304 Not Modified" : "200 OK",
+      notModified ? 0u : (unsigned)body.len,
+      body.etag);
+  client.write((const uint8_t *)head, (size_t)headLen);
+  if (isGet && !notModified) client.write((const uint8_t *)body.json, body.len);
+  gSending.store(kNoBuffer);
+}
+
+// True while a listener is bound to the current address. Binding before the
+// station has an address, or keeping a socket across a reconnect that may
+// have changed it, leaves the API dead, so the listener follows the link:
+// closed while down, opened after each connect, retried until it binds.
+bool serviceListener(bool &listening, uint32_t &boundIp, uint32_t &retryAtMs) {
+  const bool linkUp = WiFi.status() == WL_CONNECTED;
+  const uint32_t ip = linkUp ? (uint32_t)WiFi.localIP() : 0;
+  if (listening && linkUp && ip == boundIp) return true;
+
+  if (listening) {
+    gServer.end();
+    listening = false;
+    LOG_INFO(Net, "LAN API closed: %s", linkUp ? "address changed" : "wifi down");
+  }
+  if (!linkUp || ip == 0) return false;
+  const uint32_t now = millis();
+  if ((int32_t)(now - retryAtMs) < 0) return false;
+
+  gServer.begin();
+  if (!gServer) {
+    retryAtMs = now + kListenRetryMs;
+    LOG_WARN(Net, "LAN API listen failed on port %u", (unsigned)CONFIG_LAN_API_PORT);
+    return false;
+  }
+  gServer.setNoDelay(true);
+  listening = true;
+  boundIp = ip;
+  LOG_INFO(Net, "LAN API listening on %s:%u", WiFi.localIP().toString().c_str(), (unsigned)CONFIG_LAN_API_PORT);
+  return true;
+}
+
+void serverMain(void *) {
+  bool listening = false;
+  uint32_t boundIp = 0;
+  uint32_t retryAtMs = millis();
+  for (;;) {
+    if (!serviceListener(listening, boundIp, retryAtMs)) {
+      vTaskDelay(pdMS_TO_TICKS(kLinkPollMs));
+      continue;
+    }
+    WiFiClient client = gServer.available();
+    if (!client) {
+      vTaskDelay(pdMS_TO_TICKS(kAcceptPollMs));
+      continue;
+    }
+    handleClient(client);
+    client.stop();
+  }
+}
+}  // namespace
+
+bool lanApiStart() {
+  if (gServerTask != nullptr) return true;
+  const BaseType_t created = xTaskCreatePinnedToCore(
+      serverMain, "lan_api", kServerStackBytes, nullptr, kServerPriority, &gServerTask, kServerCore);
+  if (created != pdPASS) {
+    gServerTask = nullptr;
+    LOG_ERROR(Net, "LAN API start failed");
+    return false;
+  }
+  return true;
+}
+
+void lanApiUpdate(const PriceState &state) {
+  if (sameAsServed(state)) return;
+
+  const uint8_t published = gPublished.load();
+  const uint8_t sending = gSending.load();
+  uint8_t target = kNoBuffer;
+  for (uint8_t i = 0; i < kBodyBuffers; ++i) {
+    if (i != published && i != sending) {
+      target = i;
+      break;
+    }
+  }
+  // Both buffers in use: the next update after the send finishes catches up.
+  if (target == kNoBuffer) return;
+
+  if (!serializeState(state, gBodies[target])) {
+    LOG_WARN(Net, "LAN API body overflow: points=%u", (unsigned)state.count);
+    return;
+  }
+  gPublished.store(target);
+
+  gServed.valid = true;
+  gServed.ok = state.ok;
+  gServed.fingerprint = state.fingerprint;
+  gServed.currentIndex = state.currentIndex;
+  copyStateText(gServed.source, state.source);
+  copyStateText(gServed.error, state.error);
+}
+
+#else
+
+bool lanApiStart() {
+  return false;
+}
+
+void lanApiUpdate(const PriceState &) {}
+
+#endif  // CONFIG_LAN_API
@@ -0,0 +1,161 @@
+#include "local_time.h"
+
+#include <atomic>
+#include <string.h>
+
+namespace {
+constexpr int64_t kSecondsPerDay = 86400;
+constexpr int32_t kSummerShiftSec = 3600;
+constexpr int32_t kSwitchUtcSec = 3600;  // 01:00 UTC in every EU zone
+constexpr int kTableFirstYear = 2024;
+constexpr int kTableYears = 77;  // through 2100
+constexpr int64_t kAverageYearSec = 31556952;  // 365.2425 days
+
+struct SummerTime {
+  int64_t start = 0;  // UTC epoch summer time begins
+  int64_t end = 0;    // UTC epoch it ends
+};
+
+struct SummerTimeTable {
+  int64_t firstYearStart = 0;  // UTC epoch of kTableFirstYear-01-01
+  SummerTime years[kTableYears];
+};
+
+// Standard-time offset of the selected zone; kNoZone until one is set.
+constexpr int32_t kNoZone = INT32_MIN;
+std::atomic<int32_t> gStandardOffsetSec{kNoZone};
+
+int64_t floorDiv(int64_t value, int64_t divisor) {
+  const int64_t quotient = value / divisor;
+  return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+}
+
+int weekdayFromDays(int64_t days) {
+  const int64_t weekday = (days + 4) % 7;  // 1970-01-01 was a Thursday
+  return (int)(weekday < 0 ? weekday + 7 : weekday);
+}
+
+void civilFromDays(int64_t days, int &year, unsigned &month, unsigned &day) {
+  days += 719468;
+  const int64_t era = floorDiv(days, 146097);
+  const unsigned doe = (unsigned)(days - era * 146097);                       // [0, 146096]
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0, 399]
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);               // [0, 365]
+  const unsigned mp = (5 * doy + 2) / 153;                                     // [0, 11]
+  day = doy - (153 * mp + 2) / 5 + 1;
+  month = mp < 10 ? mp + 3 : mp - 9;
+  year = (int)(yoe + era * 400) + (month <= 2 ? 1 : 0);
+}
+
+int64_t lastSundaySwitch(int year, unsigned month) {
+  const int64_t lastDay = month == 12 ? daysFromCivil(year + 1, 1, 1) - 1 : daysFromCivil(year, month + 1, 1) - 1;
+  return (lastDay - weekdayFromDays(lastDay)) * kSecondsPerDay + kSwitchUtcSec;
+}
+
+SummerTime summerTimeForYear(int year) {
+  SummerTime summer;
+  summer.start = lastSundaySwitch(year, 3);
+  summer.end = lastSundaySwitch(year, 10);
+  return summer;
+}
+
+SummerTimeTable buildSummerTimeTable() {
+  SummerTimeTable table;
+  table.firstYearStart = daysFromCivil(kTableFirstYear, 1, 1) * kSecondsPerDay;
+  for (int i = 0; i < kTableYears; ++i) {
+    table.years[i] = summerTimeForYear(kTableFirstYear + i);
+  }
+  return table;
+}
+
+const SummerTimeTable &summerTimeTable() {
+  static const SummerTimeTable table = buildSummerTimeTable();
+  return table;
+}
+
+bool inSummerTime(int64_t utc) {
+  const SummerTimeTable &table = summerTimeTable();
+  // Summer time never spans New Year, so a year index that is off by one
+  // near the boundary still answers correctly.
+  const int64_t index = floorDiv(utc - table.firstYearStart, kAverageYearSec);
+  if (index >= 0 && index < kTableYears) {
+    const SummerTime &summer = table.years[index];
+    return utc >= summer.start && utc < summer.end;
+  }
+
+  int year = 0;
+  unsigned month = 0;
+  unsigned day = 0;
+  civilFromDays(floorDiv(utc, kSecondsPerDay), year, month, day);
+  const SummerTime summer = summerTimeForYear(year);
+  return utc >= summer.start && utc < summer.end;
+}
+
+}  // namespace
+
+void localTimeSetZone(const char *timezoneSpec) {
+  int32_t offset = kNoZone;
+  if (timezoneSpec != nullptr && strcmp(timezoneSpec, kTimezoneCetCest) == 0) {
+    offset = 3600;
+  } else if (timezoneSpec != nullptr && strcmp(timezoneSpec, kTimezoneEetEest) == 0) {
+    offset = 7200;
+  }
+  gStandardOffsetSec.store(offset);
+}
+
+bool localTimeFromUtc(time_t utc, struct tm &out) {
+  const int32_t standard = gStandardOffsetSec.load();
+  if (standard == kNoZone) return localtime_r(&utc, &out) != nullptr;
+
+  const bool summer = inSummerTime((int64_t)utc);
+  const int64_t local = (int64_t)utc + standard + (summer ? kSummerShiftSec : 0);
+  const int64_t days = floorDiv(local, kSecondsPerDay);
+  const int64_t secondOfDay = local - days * kSecondsPerDay;
+
+  int year = 0;
+  unsigned month = 0;
+  unsigned day = 0;
+  civilFromDays(days, year, month, day);
+  out = {};
+  out.tm_year = year - 1900;
+  out.tm_mon = (int)month - 1;
+  out.tm_mday = (int)day;
+  out.tm_hour = (int)(secondOfDay / 3600);
+  out.tm_min = (int)((secondOfDay / 60) % 60);
+  out.tm_sec = (int)(secondOfDay % 60);
+  out.tm_wday = weekdayFromDays(days);
+  out.tm_yday = (int)(days - daysFromCivil(year, 1, 1));
+  out.tm_isdst = summer ? 1 : 0;
+  return true;
+}
+
+time_t localTimeToUtc(const struct tm &local) {
+  const int32_t standard = gStandardOffsetSec.load();
+  if (standard == kNoZone) {
+    struct tm copy = local;
+    copy.tm_isdst = -1;
+    const time_t result = mktime(&copy);
+    return result == (time_t)-1 ? 0 : result;
+  }
+
+  const int64_t monthIndex = (int64_t)local.tm_year * 12 + local.tm_mon;
+  const int year = (int)floorDiv(monthIndex, 12) + 1900;
+  const unsigned month = (unsigned)(monthIndex - floorDiv(monthIndex, 12) * 12) + 1;
+  const int64_t localSec = (daysFromCivil(year, month, 1) + local.tm_mday - 1) * kSecondsPerDay +
+                           (int64_t)local.tm_hour * 3600 + (int64_t)local.tm_min * 60 + local.tm_sec;
+
+  // Try summer time first so a repeated hour maps to its first occurrence;
+  // a time in the spring-forward gap lands one hour later, as mktime does.
+  const int64_t asSummer = localSec - standard - kSummerShiftSec;
+  const int64_t utc = inSummerTime(asSummer) ? asSummer : localSec - standard;
+  return utc > 0 ? (time_t)utc : 0;
+}
+
+int64_t daysFromCivil(int year, unsigned month, unsigned day) {
+  year -= (month <= 2);
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = (unsigned)(year - era * 400);                              // [0, 399]
+  const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1; // [0, 365]
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                     // [0, 146096]
+  return era * 146097 + (int64_t)doe - 719468;
+}
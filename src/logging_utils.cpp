@@ -1,16 +1,198 @@
 #include <Arduino.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include "logging_utils.h"
 
-constexpr bool kDebugLogEnabled = true;
+namespace {
+constexpr size_t kLogRingEntries = 64;
+constexpr size_t kLogTextLen = 120;
+constexpr size_t kRtcLogEntries = 16;
+constexpr size_t kRtcLogTextLen = 60;
+constexpr uint32_t kRtcLogMagic = 0x4C4F4752;  // "LOGR"
+constexpr uint32_t kDrainStackBytes = 3072;
+constexpr UBaseType_t kDrainPriority = tskIDLE_PRIORITY;
+constexpr BaseType_t kDrainCore = 1;
 
-void logf(const char *fmt, ...) {
-  if (!kDebugLogEnabled) return;
-  char message[256];
+struct LogEntry {
+  uint32_t ms = 0;
+  LogLevel level = LogLevel::Info;
+  LogCategory category = LogCategory::App;
+  char text[kLogTextLen] = "";
+};
+
+// Kept in RTC slow memory, which survives watchdog and software resets but
+// not power loss; the magic tells a surviving ring from power-on noise.
+struct RtcLogRing {
+  uint32_t magic;
+  uint32_t head;
+  uint32_t count;
+  struct {
+    uint32_t ms;
+    char text[kRtcLogTextLen];
+  } entries[kRtcLogEntries];
+};
+
+RTC_NOINIT_ATTR RtcLogRing gRtcLog;
+
+// Producers copy a finished line in under the spinlock; formatting happens
+// outside it. When the drain falls behind, the oldest lines are dropped.
+LogEntry gRing[kLogRingEntries];
+size_t gRingHead = 0;  // next slot to write
+size_t gRingCount = 0;
+uint32_t gDropped = 0;
+portMUX_TYPE gRingMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t gDrainTask = nullptr;
+// Off until logInit has printed what the previous boot left behind.
+bool gRtcMirror = false;
+
+char levelTag(LogLevel level) {
+  switch (level) {
+    case LogLevel::Error: return 'E';
+    case LogLevel::Warn: return 'W';
+    case LogLevel::Debug: return 'D';
+    case LogLevel::Info:
+    default: return 'I';
+  }
+}
+
+const char *categoryName(LogCategory category) {
+  switch (category) {
+    case LogCategory::Net: return "net";
+    case LogCategory::Display: return "disp";
+    case LogCategory::Storage: return "fs";
+    case LogCategory::Power: return "pwr";
+    case LogCategory::App:
+    default: return "app";
+  }
+}
+
+void rtcLogAppend(uint32_t ms, const char *text) {
+  if (gRtcLog.magic != kRtcLogMagic || gRtcLog.head >= kRtcLogEntries || gRtcLog.count > kRtcLogEntries) {
+    gRtcLog.magic = kRtcLogMagic;
+    gRtcLog.head = 0;
+    gRtcLog.count = 0;
+  }
+  auto &entry = gRtcLog.entries[gRtcLog.head];
+  entry.ms = ms;
+  strncpy(entry.text, text, kRtcLogTextLen - 1);
+  entry.text[kRtcLogTextLen - 1] = '\0';
+  gRtcLog.head = (gRtcLog.head + 1) % kRtcLogEntries;
+  if (gRtcLog.count < kRtcLogEntries) ++gRtcLog.count;
+}
+
+void enqueue(LogLevel level, LogCategory category, const char *text) {
+  const uint32_t ms = millis();
+  portENTER_CRITICAL(&gRingMux);
+  LogEntry &entry = gRing[gRingHead];
+  entry.ms = ms;
+  entry.level = level;
+  entry.category = category;
+  memcpy(entry.text, text, kLogTextLen);
+  gRingHead = (gRingHead + 1) % kLogRingEntries;
+  if (gRingCount < kLogRingEntries) {
+    ++gRingCount;
+  } else {
+    ++gDropped;
+  }
+  if (gRtcMirror) rtcLogAppend(ms, text);
+  portEXIT_CRITICAL(&gRingMux);
+
+  if (gDrainTask != nullptr) xTaskNotifyGive(gDrainTask);
+}
+
+bool takeOldest(LogEntry &out, uint32_t &dropped) {
+  portENTER_CRITICAL(&gRingMux);
+  const bool has = gRingCount > 0;
+  if (has) {
+    out = gRing[(gRingHead + kLogRingEntries - gRingCount) % kLogRingEntries];
+    --gRingCount;
+  }
+  dropped = gDropped;
+  gDropped = 0;
+  portEXIT_CRITICAL(&gRingMux);
+  return has;
+}
+
+void drainToSerial() {
+  LogEntry entry;
+  uint32_t dropped = 0;
+  while (takeOldest(entry, dropped)) {
+    if (dropped > 0) {
+      Serial.printf("[%10lu] W app: %lu log lines dropped\n", (unsigned long)entry.ms, (unsigned long)dropped);
+    }
+    Serial.printf(
+        "[%10lu] %c %s: %s\n",
+        (unsigned long)entry.ms,
+        levelTag(entry.level),
+        categoryName(entry.category),
+        entry.text);
+  }
+}
+
+void drainMain(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    drainToSerial();
+  }
+}
+
+bool resetLostState(esp_reset_reason_t reason) {
+  return reason == ESP_RST_TASK_WDT || reason == ESP_RST_INT_WDT || reason == ESP_RST_WDT ||
+         reason == ESP_RST_PANIC;
+}
+
+void printPreviousBootLog() {
+  const esp_reset_reason_t reason = esp_reset_reason();
+  if (gRtcLog.magic != kRtcLogMagic || gRtcLog.count == 0 || gRtcLog.count > kRtcLogEntries ||
+      gRtcLog.head >= kRtcLogEntries || !resetLostState(reason)) {
+    gRtcLog.magic = 0;
+    return;
+  }
+
+  // Printed directly: these lines predate everything now in the RAM ring.
+  Serial.printf("Previous boot ended by reset reason %d; its last %u log lines:\n", (int)reason, (unsigned)gRtcLog.count);
+  const uint32_t first = (gRtcLog.head + kRtcLogEntries - gRtcLog.count) % kRtcLogEntries;
+  for (uint32_t i = 0; i < gRtcLog.count; ++i) {
+    auto &entry = gRtcLog.entries[(first + i) % kRtcLogEntries];
+    entry.text[kRtcLogTextLen - 1] = '\0';
+    Serial.printf("  [%10lu] %s\n", (unsigned long)entry.ms, entry.text);
+  }
+  gRtcLog.magic = 0;
+}
+
+void vlogWrite(LogLevel level, LogCategory category, const char *fmt, va_list args) {
+  char message[kLogTextLen];
+  vsnprintf(message, sizeof(message), fmt, args);
+  enqueue(level, category, message);
+}
+}  // namespace
+
+void logWrite(LogLevel level, LogCategory category, const char *fmt, ...) {
   va_list args;
   va_start(args, fmt);
-  vsnprintf(message, sizeof(message), fmt, args);
+  vlogWrite(level, category, fmt, args);
   va_end(args);
-  Serial.printf("[%10lu] %s\n", millis(), message);
+}
+
+void logInit() {
+  if (gDrainTask != nullptr) return;
+  printPreviousBootLog();
+  gRtcMirror = true;
+  const BaseType_t created =
+      xTaskCreatePinnedToCore(drainMain, "log_drain", kDrainStackBytes, nullptr, kDrainPriority, &gDrainTask, kDrainCore);
+  if (created != pdPASS) {
+    gDrainTask = nullptr;
+    drainToSerial();
+    return;
+  }
+  xTaskNotifyGive(gDrainTask);
+}
+
+void logFlush() {
+  drainToSerial();
+  Serial.flush();
 }
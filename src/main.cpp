@@ -2,14 +2,27 @@
 #include <WiFi.h>
 #include <esp_idf_version.h>
 #include <esp_task_wdt.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <time.h>
 
 #include "app_types.h"
 #include "display_ui.h"
+#include "flash_storage.h"
+#include "history_view.h"
+#include "lan_api.h"
+#include "local_time.h"
 #include "logging_utils.h"
+#include "mqtt_publisher.h"
+#include "network_worker.h"
+#include "perf_spans.h"
+#include "power_manager.h"
 #include "nordpool_ma_store.h"
 #include "nordpool_client.h"
+#include "nordpool_publish_stats.h"
 #include "price_cache.h"
+#include "price_fixed.h"
+#include "price_history.h"
 #include "price_state_utils.h"
 #include "scheduling_utils.h"
 #include "time_utils.h"
@@ -17,14 +30,18 @@
 
 constexpr uint32_t kWifiConnectTimeoutMs = 20000;
 constexpr uint16_t kWifiPortalTimeoutSec = 120;
+// Background connects that may time out after a cache boot before the
+// config portal opens beside the cached chart.
+constexpr uint8_t kPortalAfterFailedConnects = 2;
+constexpr uint32_t kPortalServiceMs = 20;  // loop wait while the portal serves clients
 constexpr uint32_t kRetryOnErrorMinMs = 30000;   // 30 s — first retry after error
 constexpr uint32_t kRetryOnErrorMaxMs = 1800000; // 30 min — backoff ceiling
-constexpr time_t kRetryDailyIfUnchangedSec = 10 * 60;
 constexpr uint32_t kResetHoldMs = 2000;
 constexpr uint32_t kResetPollIntervalMs = 50;
-constexpr int kDailyFetchHour = 13;
-constexpr int kDailyFetchMinute = 0;
 constexpr uint32_t kWatchdogTimeoutMs = 60000; // 60 s — covers worst-case WiFi + 2 HTTP fetches
+constexpr uint32_t kMaxIdleWaitMs = 5000;      // upper bound on one wait, keeps the watchdog fed
+// Light sleep pauses the watchdog timer, so longer sleeps are safe there.
+constexpr uint32_t kMaxLightSleepMs = kWatchdogTimeoutMs / 2;
 constexpr char kActiveSourceLabel[] = "NORDPOOL";
 
 #ifndef CONFIG_CLOCK_RESYNC_INTERVAL_SEC
@@ -48,22 +65,95 @@ constexpr time_t kClockResyncRetrySec =
 #define CONFIG_RESET_ACTIVE_LEVEL LOW
 #endif
 
-PriceState gState;
-PriceState gFetchBuffer;
+#ifndef CONFIG_POWER_MODE
+#define CONFIG_POWER_MODE 0
+#endif
+
+#ifndef CONFIG_PAGE_ROTATE_SEC
+#define CONFIG_PAGE_ROTATE_SEC 15
+#endif
+
+// How long each page (an area, or the history chart) stays on screen; 0
+// shows only the primary area.
+constexpr uint32_t kPageRotateMs = CONFIG_PAGE_ROTATE_SEC > 0 ? (uint32_t)CONFIG_PAGE_ROTATE_SEC * 1000 : 0;
+
+// The displayed state and a spare the network worker fetches into. A
+// successful fetch swaps the two pointers instead of copying the struct.
+PriceState gStateBuffers[2];
+PriceState *gState = &gStateBuffers[0];
+PriceState *gSpareState = &gStateBuffers[1];
 PriceState gCacheBuffer;
+// *gState aggregated to the configured resolution. This is what is drawn,
+// served and published; rebuilt by refreshView() whenever *gState changes.
+PriceState gView;
+// The extra area on screen while rotating; displayedState() builds it.
+PriceState gAreaView;
+// The price history decimated to the chart width, for the history page.
+HistoryView gHistoryView;
+// 0 primary area, 1.. gState->extraAreas, then the history page.
+uint8_t gDisplayPage = 0;
 AppSecrets gSecrets;
+// gSecrets' VAT and fixed cost as integer factors; refreshed whenever the
+// settings are (re)loaded.
+PriceFormula gPriceFormula;
+// When the main area's next-day prices have been appearing; schedules the
+// daily polls.
+PublishStats gPublishStats;
+time_t gPublishMissAt = 0;  // last daily poll that found nothing new, 0 if none
 uint32_t gLastFetchMs = 0;
 uint32_t gRetryIntervalMs = kRetryOnErrorMinMs;
-time_t gNextDailyFetch = 0;
-time_t gNextMinuteBoundary = 0;
-time_t gNextClockResync = 0;
+DeadlineQueue gSchedule;
+TaskHandle_t gLoopTask = nullptr;
 bool gPendingCatchUpRecheck = false;
 bool gNeedsOnlineInit = false;
 bool gWatchdogInitialized = false;
+// Set by a cache boot until WiFi first connects: the boot skipped the
+// blocking portal, so the loop offers it if the background connects fail.
+bool gPortalFallbackPending = false;
+bool gPortalOpen = false;
+
+enum class FetchReason : uint8_t
+{
+  Startup,
+  ErrorRetry,
+  Daily,
+};
+
+FetchReason gFetchReason = FetchReason::Startup;
+// Set while the online-init clock sync is in flight; it primes all
+// schedules and starts the startup fetch once the worker reports back.
+bool gClockSyncForOnlineInit = false;
 
 constexpr int kConfigResetPin = CONFIG_RESET_PIN;
 constexpr int kConfigResetActiveLevel = CONFIG_RESET_ACTIVE_LEVEL;
 
+// Jobs that need the network worker, and the one that also needs WiFi up.
+constexpr uint32_t kNetworkScheduledTasks = scheduledTaskBit(ScheduledTask::ClockResync) |
+                                            scheduledTaskBit(ScheduledTask::DailyFetch) |
+                                            scheduledTaskBit(ScheduledTask::ErrorRetry);
+
+void wakeMainLoop()
+{
+  if (gLoopTask != nullptr)
+    xTaskNotifyGive(gLoopTask);
+}
+
+void IRAM_ATTR onResetPinChange()
+{
+  BaseType_t higherPriorityWoken = pdFALSE;
+  if (gLoopTask != nullptr)
+    vTaskNotifyGiveFromISR(gLoopTask, &higherPriorityWoken);
+  if (higherPriorityWoken == pdTRUE)
+    portYIELD_FROM_ISR();
+}
+
+void onWifiEvent(arduino_event_id_t event, arduino_event_info_t)
+{
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+    networkWorkerWake();
+  wakeMainLoop();
+}
+
 bool resetButtonPressed()
 {
   if (kConfigResetPin < 0)
@@ -92,16 +182,28 @@ void handleResetRequest()
   if (!resetButtonHeld())
     return;
 
-  logf("Reset button held, clearing WiFi/config settings, price cache, and moving average");
+  LOG_WARN(
+      App,
+      "Reset button held, clearing WiFi/config settings, price cache, moving average, price history and "
+      "publication stats");
   if (!priceCacheClear())
   {
-    logf("Price cache clear failed during reset");
+    LOG_WARN(Storage, "Price cache clear failed during reset");
   }
   if (!clearMovingAverageStore())
   {
-    logf("Moving average clear failed during reset");
+    LOG_WARN(Storage, "Moving average clear failed during reset");
+  }
+  if (!priceHistoryClear())
+  {
+    LOG_WARN(Storage, "Price history clear failed during reset");
+  }
+  if (!clearPublishStats())
+  {
+    LOG_WARN(Storage, "Publication stats clear failed during reset");
   }
   wifiResetSettings();
+  logFlush();
   delay(250);
   ESP.restart();
 }
@@ -111,36 +213,264 @@ void logNextFetch(time_t nextFetch)
   if (nextFetch == 0)
     return;
   struct tm tmNext;
-  localtime_r(&nextFetch, &tmNext);
+  localTimeFromUtc(nextFetch, tmNext);
   char buf[24];
   strftime(buf, sizeof(buf), "%d/%m %H:%M", &tmNext);
-  logf("Next daily fetch scheduled: %s", buf);
+  LOG_INFO(App, "Next daily fetch scheduled: %s", buf);
+}
+
+void scheduleDailyFetchAt(time_t at)
+{
+  deadlineArmAt(gSchedule, ScheduledTask::DailyFetch, at);
+  logNextFetch(at);
+}
+
+// Spreads a fleet of devices over a few seconds instead of one.
+time_t pollJitterSec()
+{
+  return (time_t)random(0, (long)kPublishPollJitterSec + 1);
+}
+
+void syncPublishStatsArea()
+{
+  const char *area = gSecrets.nordpoolArea.c_str();
+  if (stateTextEquals(gPublishStats.area, area))
+    return;
+  if (!loadPublishStats(gPublishStats) || !stateTextEquals(gPublishStats.area, area))
+    resetPublishStats(gPublishStats, area);
 }
 
 void scheduleDailyFetch(time_t now)
 {
-  gNextDailyFetch = scheduleNextDailyFetch(now, kDailyFetchHour, kDailyFetchMinute);
-  logNextFetch(gNextDailyFetch);
+  const PublishWindow window = publishWindow(gPublishStats);
+  LOG_INFO(
+      App,
+      "Publication window %02u:%02u-%02u:%02u (%s, samples=%u)",
+      (unsigned)(window.firstMinute / 60),
+      (unsigned)(window.firstMinute % 60),
+      (unsigned)(window.lastMinute / 60),
+      (unsigned)(window.lastMinute % 60),
+      window.learned ? "learned" : "default",
+      (unsigned)gPublishStats.count);
+  const time_t at = publishFirstPollAfter(now, window);
+  scheduleDailyFetchAt(at == 0 ? 0 : at + pollJitterSec());
+}
+
+void scheduleDailyRetry(time_t now, const char *reason)
+{
+  const time_t delay = publishRetryDelaySec(now, publishWindow(gPublishStats)) + pollJitterSec();
+  LOG_INFO(App, "%s, retry in %ld sec", reason, (long)delay);
+  scheduleDailyFetchAt(now + delay);
+}
+
+void recordPublication(time_t seenAt)
+{
+  const bool recorded = gPublishMissAt != 0
+                            ? notePublishObserved(gPublishStats, gPublishMissAt, seenAt)
+                            : notePublishedBeforeWindow(gPublishStats, seenAt, publishWindow(gPublishStats));
+  if (recorded && !savePublishStats(gPublishStats))
+  {
+    LOG_WARN(Storage, "Publication stats save failed");
+  }
+  gPublishMissAt = 0;
+}
+
+void scheduleSlotChange(time_t now)
+{
+  const PriceState &state = gView;
+  if (!isValidClock(now, kValidEpochMin) || !state.ok || state.count == 0)
+  {
+    deadlineDisarm(gSchedule, ScheduledTask::SlotChange);
+    return;
+  }
+  const uint16_t resolution = normalizeResolutionMinutes(state.resolutionMinutes);
+  deadlineArmAt(gSchedule, ScheduledTask::SlotChange, intervalStartForTime(now, resolution) + ((time_t)resolution * 60));
+}
+
+// Keeps the backoff deadline in step with the state: armed from the last
+// fetch while an error is shown, cleared once prices are healthy.
+void syncErrorRetryDeadline()
+{
+  const bool hasError = !gState->ok || gState->error[0] != '\0';
+  if (!hasError)
+  {
+    deadlineDisarm(gSchedule, ScheduledTask::ErrorRetry);
+    return;
+  }
+  if (!deadlineArmed(gSchedule, ScheduledTask::ErrorRetry))
+    deadlineArmAfterMs(gSchedule, ScheduledTask::ErrorRetry, gLastFetchMs, gRetryIntervalMs);
 }
 
 void syncClockForSelectedArea()
 {
   const char *timezoneSpec = timezoneSpecForNordpoolArea(gSecrets.nordpoolArea);
-  logf("Clock timezone selected: area=%s", gSecrets.nordpoolArea.c_str());
+  LOG_INFO(App, "Clock timezone selected: area=%s", gSecrets.nordpoolArea.c_str());
   syncClock(timezoneSpec);
 }
 
 void primeSchedulesFromNow(time_t now)
 {
   scheduleDailyFetch(now);
-  gNextMinuteBoundary = scheduleNextMinuteBoundary(now, kValidEpochMin);
-  gNextClockResync = scheduleAfter(now, kClockResyncIntervalSec, kValidEpochMin);
+  deadlineArmAt(gSchedule, ScheduledTask::MinuteTick, scheduleNextMinuteBoundary(now, kValidEpochMin));
+  deadlineArmAt(gSchedule, ScheduledTask::ClockResync, scheduleAfter(now, kClockResyncIntervalSec, kValidEpochMin));
+  scheduleSlotChange(now);
 }
 
 void syncClockAndPrimeSchedules()
 {
   syncClockForSelectedArea();
-  primeSchedulesFromNow(time(nullptr));
+  primeSchedulesFromNow(clockNow());
+}
+
+bool requestClockSync(bool forOnlineInit)
+{
+  NetworkJobRequest request;
+  request.job = NetworkJob::SyncClock;
+  request.timezoneSpec = timezoneSpecForNordpoolArea(gSecrets.nordpoolArea);
+  if (!networkWorkerSubmit(request))
+    return false;
+  LOG_INFO(App, "Clock timezone selected: area=%s", gSecrets.nordpoolArea.c_str());
+  gClockSyncForOnlineInit = forOnlineInit;
+  return true;
+}
+
+bool requestFetch(FetchReason reason)
+{
+  NetworkJobRequest request;
+  request.job = NetworkJob::FetchPrices;
+  copyStateText(request.apiUrl, gSecrets.nordpoolApiUrl.c_str());
+  copyStateText(request.area, gSecrets.nordpoolArea.c_str());
+  copyStateText(request.extraAreas, gSecrets.nordpoolExtraAreas.c_str());
+  copyStateText(request.currency, gSecrets.nordpoolCurrency.c_str());
+  request.formula = gPriceFormula;
+  request.existing = gState;
+  request.out = gSpareState;
+  if (!networkWorkerSubmit(request))
+    return false;
+  gFetchReason = reason;
+  LOG_DEBUG(App, "Fetch requested (reason=%u)", (unsigned)reason);
+  return true;
+}
+
+void reloadPriceFormula()
+{
+  gPriceFormula = makePriceFormula(gSecrets.vatPercent, gSecrets.fixedCostPerKwh);
+}
+
+const PriceState &refreshView()
+{
+  nordPoolBuildView(*gState, 0, gSecrets.nordpoolResolutionMinutes, gPriceFormula, gView);
+  return gView;
+}
+
+bool historyPageAvailable()
+{
+  return kHistoryViewDays > 0 && gHistoryView.lastSlotStart != 0;
+}
+
+uint8_t displayPageCount()
+{
+  if (!gState->ok)
+    return 1;
+  return (uint8_t)(gState->extraAreaCount + 1 + (historyPageAvailable() ? 1 : 0));
+}
+
+// gView, or the extra area the rotation is on, built from the same state.
+const PriceState &displayedState()
+{
+  if (gDisplayPage == 0 || gDisplayPage > gState->extraAreaCount)
+    return gView;
+  nordPoolBuildView(*gState, gDisplayPage, gSecrets.nordpoolResolutionMinutes, gPriceFormula, gAreaView);
+  return gAreaView;
+}
+
+void drawDisplayedPage()
+{
+  if (gDisplayPage >= displayPageCount())
+    gDisplayPage = 0;
+  if (gDisplayPage > gState->extraAreaCount)
+  {
+    displayDrawHistory(gHistoryView, gView, gPriceFormula);
+    return;
+  }
+  displayDrawPrices(displayedState());
+}
+
+void drawPrices()
+{
+  refreshView();
+  drawDisplayedPage();
+}
+
+// Reads flash; only call while the network worker is idle, as it records
+// the history after each fetch.
+void updateHistoryView()
+{
+  if (kHistoryViewDays == 0)
+    return;
+  if (gHistoryView.columnCount == 0)
+    historyViewReset(gHistoryView, (uint16_t)displayChartWidth());
+  if (!historyViewUpdate(gHistoryView))
+  {
+    LOG_WARN(Storage, "History view update failed");
+  }
+}
+
+void schedulePageRotation()
+{
+  if (kPageRotateMs == 0 || displayPageCount() <= 1)
+  {
+    gDisplayPage = 0;
+    deadlineDisarm(gSchedule, ScheduledTask::PageRotate);
+    return;
+  }
+  if (!deadlineArmed(gSchedule, ScheduledTask::PageRotate))
+    deadlineArmAfterMs(gSchedule, ScheduledTask::PageRotate, clockMillis(), kPageRotateMs);
+}
+
+void rotateDisplayedPage()
+{
+  gDisplayPage = (uint8_t)((gDisplayPage + 1) % displayPageCount());
+  drawDisplayedPage();
+  deadlineArmAfterMs(gSchedule, ScheduledTask::PageRotate, clockMillis(), kPageRotateMs);
+}
+
+// Opens the portal at most once per boot, and only with an always-on
+// radio: on demand the worker powers WiFi down between jobs.
+void handleBackgroundPortal()
+{
+  if (gPortalOpen)
+  {
+    const WifiPortalState portal = wifiConfigPortalProcess(gSecrets);
+    if (portal == WifiPortalState::Open)
+      return;
+    gPortalOpen = false;
+    // Connected: the online init picks up the saved settings.
+    drawDisplayedPage();
+    return;
+  }
+  if (!gPortalFallbackPending)
+    return;
+  if (WiFi.status() == WL_CONNECTED)
+  {
+    gPortalFallbackPending = false;
+    return;
+  }
+  // The idle worker reconnects without a job, so busy alone is not enough.
+  if (powerRadioOnDemand() || networkWorkerBusy() || wifiReconnectInProgress() ||
+      wifiReconnectFailures() < kPortalAfterFailedConnects)
+    return;
+
+  LOG_WARN(
+      Net,
+      "WiFi failed %u times in the background, offering the config portal",
+      (unsigned)wifiReconnectFailures());
+  gPortalOpen = wifiConfigPortalStart(gSecrets, kWifiPortalTimeoutSec);
+  // A reconnect that won the radio after the check above keeps it for the
+  // whole connect timeout; offer the portal again once it is done.
+  gPortalFallbackPending = !gPortalOpen && wifiReconnectInProgress();
+  if (gPortalOpen)
+    drawDisplayedPage();
 }
 
 void initWatchdog()
@@ -160,102 +490,107 @@ void initWatchdog()
 #endif
   esp_task_wdt_add(NULL);
   gWatchdogInitialized = true;
-  logf("Watchdog started: %ums timeout", (unsigned)kWatchdogTimeoutMs);
+  LOG_INFO(App, "Watchdog started: %ums timeout", (unsigned)kWatchdogTimeoutMs);
 }
 
+// Debug only: runs on every slot change.
 void logCurrentPriceCalculation(const PriceState &state, const AppSecrets &secrets)
 {
+  if (!logEnabled(LogLevel::Debug, LogCategory::App))
+    return;
   if (!state.ok || state.count == 0)
     return;
   if (state.currentIndex < 0 || state.currentIndex >= (int)state.count)
     return;
 
   const PricePoint &point = state.points[state.currentIndex];
+  char priceText[16];
+  formatPriceFixed(point.price, 4, priceText, sizeof(priceText));
+  char slotText[20];
+  if (!formatLocalSlot((time_t)point.startsAt, slotText, sizeof(slotText)))
+  {
+    snprintf(slotText, sizeof(slotText), "%lu", (unsigned long)point.startsAt);
+  }
   if (!point.hasRawPrice)
   {
-    logf(
-        "Current price calc: idx=%d slot=%s raw=n/a price=%.4f",
+    LOG_DEBUG(
+        App,
+        "Current price calc: idx=%d slot=%s raw=n/a price=%s",
         state.currentIndex,
-        point.startsAt.c_str(),
-        point.price);
+        slotText,
+        priceText);
     return;
   }
 
-  const float vatMultiplier = 1.0f + (secrets.vatPercent / 100.0f);
-  const float rawMinorPerKwh = point.rawPricePerKwh * 100.0f;
-  const float withVatMinorPerKwh = rawMinorPerKwh * vatMultiplier;
-  const float computedPricePerKwh = (withVatMinorPerKwh + secrets.fixedCostPerKwh) / 100.0f;
-  logf(
-      "Current price calc: idx=%d slot=%s raw=%.4f vat=%.2f%% fixed_minor=%.2f computed=%.4f stored=%.4f",
+  char rawText[16];
+  char computedText[16];
+  formatPriceFixed(point.rawPrice, 4, rawText, sizeof(rawText));
+  formatPriceFixed(applyPriceFormula(gPriceFormula, point.rawPrice), 4, computedText, sizeof(computedText));
+  LOG_DEBUG(
+      App,
+      "Current price calc: idx=%d slot=%s raw=%s vat=%.2f%% fixed_minor=%.2f computed=%s stored=%s",
       state.currentIndex,
-      point.startsAt.c_str(),
-      point.rawPricePerKwh,
+      slotText,
+      rawText,
       secrets.vatPercent,
       secrets.fixedCostPerKwh,
-      computedPricePerKwh,
-      point.price);
+      computedText,
+      priceText);
+}
+
+void showFetchedState()
+{
+  PriceState *previous = gState;
+  gState = gSpareState;
+  gSpareState = previous;
 }
 
-void applyFetchedState(const PriceState &fetched)
+void applyFetchedState()
 {
+  const PriceState &fetched = *gSpareState;
   if (fetched.ok)
   {
     gRetryIntervalMs = kRetryOnErrorMinMs;
-    gState = fetched;
-    if (!priceCacheSave(gState))
+    showFetchedState();
+    if (!priceCacheSave(*gState))
     {
-      logf("Price cache save failed");
+      LOG_WARN(Storage, "Price cache save failed");
     }
-    logCurrentPriceCalculation(gState, gSecrets);
+    logCurrentPriceCalculation(refreshView(), gSecrets);
   }
-  else if (gState.count > 0)
+  else if (gState->count > 0)
   {
-    gState.error = fetched.error;
+    copyStateText(gState->error, fetched.error);
   }
   else
   {
-    gState = fetched;
+    showFetchedState();
   }
-  displayDrawPrices(gState);
-  gLastFetchMs = millis();
-}
-
-void fetchAndRender()
-{
-  logf("Fetch+render start");
-  fetchNordPoolPriceInfo(
-      gSecrets.nordpoolApiUrl.c_str(),
-      gSecrets.nordpoolArea.c_str(),
-      gSecrets.nordpoolCurrency.c_str(),
-      gSecrets.nordpoolResolutionMinutes,
-      gSecrets.vatPercent,
-      gSecrets.fixedCostPerKwh,
-      gFetchBuffer);
-  applyFetchedState(gFetchBuffer);
-  logf("Fetch+render done");
+  drawPrices();
+  gLastFetchMs = clockMillis();
 }
 
 bool applyLoadedCacheState(const PriceState &cacheState, const char *cacheLabel, bool saveBackToCache)
 {
-  if (cacheState.resolutionMinutes != gSecrets.nordpoolResolutionMinutes)
+  if (cacheState.resolutionMinutes != kNordPoolFetchResolutionMinutes)
   {
-    logf(
-        "Using %s cache with different resolution: cache=%u configured=%u",
+    LOG_INFO(
+        App,
+        "Using %s cache at resolution=%u until the next fetch",
         cacheLabel,
-        (unsigned)cacheState.resolutionMinutes,
-        (unsigned)gSecrets.nordpoolResolutionMinutes);
+        (unsigned)cacheState.resolutionMinutes);
   }
 
-  gState = cacheState;
-  if (saveBackToCache && !priceCacheSave(gState))
+  *gState = cacheState;
+  if (saveBackToCache && !priceCacheSave(*gState))
   {
-    logf("Price cache save failed");
+    LOG_WARN(Storage, "Price cache save failed");
   }
 
-  logCurrentPriceCalculation(gState, gSecrets);
+  logCurrentPriceCalculation(refreshView(), gSecrets);
 
-  displayDrawPrices(gState);
-  logf("Loaded %s prices from cache: points=%u", cacheLabel, (unsigned)gState.count);
+  drawDisplayedPage();
+  LOG_INFO(App, "Loaded %s prices from cache: points=%u", cacheLabel, (unsigned)gState->count);
   gPendingCatchUpRecheck = true;
   return true;
 }
@@ -266,280 +601,386 @@ bool prepareNordPoolCacheForCurrentFormula(PriceState &cacheState)
   {
     return false;
   }
-  if (cacheState.source != "NORDPOOL" && cacheState.source != "no wifi")
+  if (!stateTextEquals(cacheState.source, "NORDPOOL") && !stateTextEquals(cacheState.source, "no wifi"))
   {
     return true;
   }
-  if (nordPoolRecalculatePricesFromRaw(cacheState, gSecrets.vatPercent, gSecrets.fixedCostPerKwh))
+  if (nordPoolRecalculatePricesFromRaw(cacheState, gPriceFormula))
   {
     return true;
   }
 
-  logf("Cached Nord Pool prices cannot be recalculated with current formula; ignoring cache");
+  LOG_WARN(App, "Cached Nord Pool prices cannot be recalculated with current formula; ignoring cache");
   return false;
 }
 
 void updateCurrentIntervalFromClock(bool forceUpdate = false)
 {
-  if (!gState.ok || gState.count == 0)
+  if (!gState->ok || gState->count == 0)
     return;
 
-  // Use the active state resolution (cache/fetched) instead of configured resolution.
-  // This avoids missing interval matches after restart when cached data resolution differs.
-  const uint16_t activeResolution = normalizeResolutionMinutes(gState.resolutionMinutes);
-  const int idx = findCurrentPricePointIndex(gState, activeResolution);
+  const uint32_t previousStartsAt = gView.currentStartsAt;
+  PriceState &state = gView;
+  refreshView();
+  // Use the view's own resolution: a cache from older firmware may still be
+  // coarser than the configured one.
+  const uint16_t activeResolution = normalizeResolutionMinutes(state.resolutionMinutes);
+  const int idx = findCurrentPricePointIndex(state, activeResolution);
   if (idx < 0)
   {
-    logf(
+    LOG_WARN(
+        App,
         "Price slot update skipped: no matching interval (res=%u points=%u)",
         (unsigned)activeResolution,
-        (unsigned)gState.count);
+        (unsigned)state.count);
     return;
   }
-  if (!forceUpdate && idx == gState.currentIndex)
+  if (!forceUpdate && state.points[idx].startsAt == previousStartsAt)
     return;
 
-  gState.currentIndex = idx;
-  gState.currentStartsAt = gState.points[idx].startsAt;
-  gState.currentLevel = gState.points[idx].level;
-  gState.currentPrice = gState.points[idx].price;
-  logf("Price slot update: idx=%d price=%.3f", idx, gState.currentPrice);
-  logCurrentPriceCalculation(gState, gSecrets);
-  displayDrawPrices(gState);
+  LOG_DEBUG(App, "Price slot update: idx=%d price=%.4f", idx, priceFixedToMajor(state.currentPrice));
+  logCurrentPriceCalculation(state, gSecrets);
+  drawDisplayedPage();
 }
 
-void handleClockDrivenUpdates(time_t now)
+void handleClockSynced()
 {
-  time_t currentNow = now;
-  if (!isValidClock(currentNow, kValidEpochMin))
+  const time_t syncedNow = clockNow();
+  if (gClockSyncForOnlineInit)
+  {
+    gClockSyncForOnlineInit = false;
+    primeSchedulesFromNow(syncedNow);
+    // A cache drawn before the sync has no current slot yet.
+    if (isValidClock(syncedNow, kValidEpochMin))
+      updateCurrentIntervalFromClock(true);
+    if (!requestFetch(FetchReason::Startup))
+    {
+      LOG_ERROR(App, "Startup fetch request rejected");
+    }
     return;
+  }
 
-  if (gNextClockResync == 0)
+  if (isValidClock(syncedNow, kValidEpochMin))
   {
-    gNextClockResync = scheduleAfter(currentNow, kClockResyncIntervalSec, kValidEpochMin);
+    displayRefreshClock();
+    deadlineArmAt(gSchedule, ScheduledTask::MinuteTick, scheduleNextMinuteBoundary(syncedNow, kValidEpochMin));
+    deadlineArmAt(
+        gSchedule, ScheduledTask::ClockResync, scheduleAfter(syncedNow, kClockResyncIntervalSec, kValidEpochMin));
+    scheduleSlotChange(syncedNow);
   }
-  if (currentNow >= gNextClockResync)
+  else
   {
-    logf("Periodic clock resync trigger");
-    syncClockForSelectedArea();
-    const time_t syncedNow = time(nullptr);
-    if (isValidClock(syncedNow, kValidEpochMin))
-    {
-      currentNow = syncedNow;
-      displayRefreshClock();
-      gNextMinuteBoundary = scheduleNextMinuteBoundary(currentNow, kValidEpochMin);
-      gNextClockResync = scheduleAfter(currentNow, kClockResyncIntervalSec, kValidEpochMin);
-    }
-    else
-    {
-      gNextClockResync = scheduleAfter(currentNow, kClockResyncRetrySec, kValidEpochMin);
-    }
+    deadlineArmAt(gSchedule, ScheduledTask::ClockResync, scheduleAfter(syncedNow, kClockResyncRetrySec, kValidEpochMin));
   }
+}
 
-  if (gPendingCatchUpRecheck)
+void handleDailyFetchResult()
+{
+  const time_t now = clockNow();
+  const PriceState &fetched = *gSpareState;
+  if (!fetched.ok)
   {
-    gPendingCatchUpRecheck = false;
-    if (shouldCatchUpMissedDailyUpdate(currentNow, gState, kDailyFetchHour, kDailyFetchMinute, kValidEpochMin))
-    {
-      gNextDailyFetch = currentNow;
-      logf("Delayed catch-up fetch scheduled immediately");
-    }
+    applyFetchedState();
+    scheduleDailyRetry(now, "Daily fetch failed");
+    return;
   }
 
-  if (gNextMinuteBoundary == 0)
+  if (wouldReduceCoverage(fetched, *gState))
   {
-    gNextMinuteBoundary = scheduleNextMinuteBoundary(currentNow, kValidEpochMin);
+    LOG_INFO(
+        App,
+        "Daily fetch has fewer prices (%u < %u), keep existing",
+        (unsigned)fetched.count,
+        (unsigned)gState->count);
+    gPublishMissAt = now;
+    scheduleDailyRetry(now, "Daily fetch kept existing prices");
+    return;
   }
-  if (currentNow >= gNextMinuteBoundary)
+
+  if (hasNewPriceInfo(fetched, *gState))
   {
-    displayRefreshClock();
-    updateCurrentIntervalFromClock();
-    gNextMinuteBoundary = scheduleNextMinuteBoundary(currentNow, kValidEpochMin);
+    LOG_INFO(App, "Daily fetch returned updated prices");
+    recordPublication(now);
+    applyFetchedState();
+    scheduleDailyFetch(now);
+    return;
   }
 
-  if (gNextDailyFetch == 0)
-    scheduleDailyFetch(currentNow);
+  gPublishMissAt = now;
+  scheduleDailyRetry(now, "Daily fetch unchanged");
+}
 
-  if (gNextDailyFetch != 0 && currentNow >= gNextDailyFetch)
+void handleFetchResult()
+{
+  switch (gFetchReason)
   {
-    logf("Daily 13:00 fetch trigger");
-    fetchNordPoolPriceInfo(
-        gSecrets.nordpoolApiUrl.c_str(),
-        gSecrets.nordpoolArea.c_str(),
-        gSecrets.nordpoolCurrency.c_str(),
-        gSecrets.nordpoolResolutionMinutes,
-        gSecrets.vatPercent,
-        gSecrets.fixedCostPerKwh,
-        gFetchBuffer);
-    const PriceState &fetched = gFetchBuffer;
-    if (!fetched.ok)
+  case FetchReason::Daily:
+    handleDailyFetchResult();
+    break;
+  case FetchReason::ErrorRetry:
+    applyFetchedState();
+    if (!gState->ok || gState->error[0] != '\0')
     {
-      logf("Daily fetch failed, retry in %ld sec", (long)kRetryDailyIfUnchangedSec);
-      applyFetchedState(fetched);
-      gNextDailyFetch = currentNow + kRetryDailyIfUnchangedSec;
-      logNextFetch(gNextDailyFetch);
-      return;
+      gRetryIntervalMs = std::min(gRetryIntervalMs * 2, kRetryOnErrorMaxMs);
+      LOG_INFO(App, "Backoff: next retry in %us", (unsigned)(gRetryIntervalMs / 1000));
     }
+    break;
+  case FetchReason::Startup:
+  default:
+    applyFetchedState();
+    break;
+  }
+  updateHistoryView();
+  updateCurrentIntervalFromClock();
+  scheduleSlotChange(clockNow());
+  // Re-armed from the new gLastFetchMs/backoff on the next pass if still needed.
+  deadlineDisarm(gSchedule, ScheduledTask::ErrorRetry);
+  storageLogStats();
+}
 
-    if (wouldReduceCoverage(fetched, gState))
-    {
-      logf(
-          "Daily fetch has fewer prices (%u < %u), keep existing and retry in %ld sec",
-          (unsigned)fetched.count,
-          (unsigned)gState.count,
-          (long)kRetryDailyIfUnchangedSec);
-      gNextDailyFetch = currentNow + kRetryDailyIfUnchangedSec;
-      logNextFetch(gNextDailyFetch);
-      return;
-    }
+void handleCompletedNetworkJob()
+{
+  switch (networkWorkerTakeCompleted())
+  {
+  case NetworkJob::SyncClock:
+    handleClockSynced();
+    break;
+  case NetworkJob::FetchPrices:
+    handleFetchResult();
+    break;
+  case NetworkJob::None:
+  default:
+    break;
+  }
+}
+
+void handleDueDeadlines(bool wifiConnected)
+{
+  const time_t now = clockNow();
+  const uint32_t nowMs = clockMillis();
+
+  if (wifiConnected && deadlineDue(gSchedule, ScheduledTask::ErrorRetry, now, nowMs, kValidEpochMin) &&
+      requestFetch(FetchReason::ErrorRetry))
+  {
+    LOG_INFO(App, "Retry fetch due to error state (interval=%us)", (unsigned)(gRetryIntervalMs / 1000));
+  }
+
+  if (deadlineDue(gSchedule, ScheduledTask::PageRotate, now, nowMs, kValidEpochMin))
+    rotateDisplayedPage();
+
+  if (!isValidClock(now, kValidEpochMin))
+    return;
+
+  if (!deadlineArmed(gSchedule, ScheduledTask::ClockResync))
+  {
+    deadlineArmAt(gSchedule, ScheduledTask::ClockResync, scheduleAfter(now, kClockResyncIntervalSec, kValidEpochMin));
+  }
+  if (deadlineDue(gSchedule, ScheduledTask::ClockResync, now, nowMs, kValidEpochMin) && requestClockSync(false))
+  {
+    LOG_DEBUG(App, "Periodic clock resync trigger");
+  }
 
-    if (hasNewPriceInfo(fetched, gState))
+  // A fetch in flight may already bring the missing day; decide once it lands.
+  if (gPendingCatchUpRecheck && !networkWorkerBusy())
+  {
+    gPendingCatchUpRecheck = false;
+    const PublishWindow window = publishWindow(gPublishStats);
+    if (shouldCatchUpMissedDailyUpdate(
+            now, *gState, window.firstMinute / 60, window.firstMinute % 60, kValidEpochMin))
     {
-      logf("Daily fetch returned updated prices");
-      applyFetchedState(fetched);
-      scheduleDailyFetch(currentNow);
-      return;
+      deadlineArmAt(gSchedule, ScheduledTask::DailyFetch, now);
+      LOG_INFO(App, "Delayed catch-up fetch scheduled immediately");
     }
+  }
 
-    logf("Daily fetch unchanged, retry in %ld sec", (long)kRetryDailyIfUnchangedSec);
-    gNextDailyFetch = currentNow + kRetryDailyIfUnchangedSec;
-    logNextFetch(gNextDailyFetch);
+  if (!deadlineArmed(gSchedule, ScheduledTask::MinuteTick) ||
+      deadlineDue(gSchedule, ScheduledTask::MinuteTick, now, nowMs, kValidEpochMin))
+  {
+    displayRefreshClock();
+    deadlineArmAt(gSchedule, ScheduledTask::MinuteTick, scheduleNextMinuteBoundary(now, kValidEpochMin));
+  }
+
+  if (!deadlineArmed(gSchedule, ScheduledTask::SlotChange) ||
+      deadlineDue(gSchedule, ScheduledTask::SlotChange, now, nowMs, kValidEpochMin))
+  {
+    updateCurrentIntervalFromClock();
+    scheduleSlotChange(now);
+  }
+
+  if (!deadlineArmed(gSchedule, ScheduledTask::DailyFetch))
+    scheduleDailyFetch(now);
+
+  if (deadlineDue(gSchedule, ScheduledTask::DailyFetch, now, nowMs, kValidEpochMin) &&
+      requestFetch(FetchReason::Daily))
+  {
+    LOG_DEBUG(App, "Daily fetch trigger");
   }
 }
 
+// Sleeps until the next deadline or until an ISR, WiFi event or finished
+// network job notifies the loop task. Deadlines that are due but waiting on
+// the worker or on WiFi are skipped; their wake-up is that event.
+void waitForNextEvent(bool wifiConnected)
+{
+  uint32_t ignoreMask = 0;
+  if (networkWorkerBusy())
+    ignoreMask |= kNetworkScheduledTasks;
+  if (!wifiConnected)
+    ignoreMask |= scheduledTaskBit(ScheduledTask::ErrorRetry);
+
+  const bool canLightSleep = powerMode() == PowerMode::LightSleep && !networkWorkerBusy() && !gPortalOpen;
+  uint32_t maxWaitMs = canLightSleep ? kMaxLightSleepMs : kMaxIdleWaitMs;
+  if (gPortalOpen)
+    maxWaitMs = kPortalServiceMs;
+  const uint32_t waitMs = deadlineWaitMs(
+      gSchedule,
+      clockNowMs(),
+      clockMillis(),
+      kValidEpochMin,
+      ignoreMask,
+      maxWaitMs);
+  if (!clockIdle(waitMs))
+    powerIdle(waitMs, canLightSleep);
+}
+
 void setup()
 {
   Serial.begin(115200);
   delay(200);
-  logf("Boot");
-  logf(
+  logInit();
+  LOG_INFO(App, "Boot");
+  LOG_INFO(
+      App,
       "Clock resync config: interval=%ld sec retry=%ld sec",
       (long)kClockResyncIntervalSec,
       (long)kClockResyncRetrySec);
 
+  gLoopTask = xTaskGetCurrentTaskHandle();
   if (kConfigResetPin >= 0)
   {
     if (kConfigResetActiveLevel == LOW)
       pinMode(kConfigResetPin, INPUT_PULLUP);
     else
       pinMode(kConfigResetPin, INPUT_PULLDOWN);
+    attachInterrupt(digitalPinToInterrupt(kConfigResetPin), onResetPinChange, CHANGE);
   }
+  powerInit((PowerMode)CONFIG_POWER_MODE, kConfigResetPin, kConfigResetActiveLevel);
+  WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
 
   handleResetRequest();
 
   displayInit();
 
-  bool loadedFromCache = false;
-  bool loadedCurrentCache = false;
-  const bool wifiConnected = wifiConnectWithConfigPortal(gSecrets, kWifiPortalTimeoutSec);
-
-  if (!wifiConnected)
+  // Everything the cached chart needs is on flash, so draw it before WiFi:
+  // connecting can take the whole timeout when the AP is slow or down.
+  loadAppSecrets(gSecrets);
+  reloadPriceFormula();
+  syncPublishStatsArea();
+  selectTimezone(timezoneSpecForNordpoolArea(gSecrets.nordpoolArea));
+  updateHistoryView();
+  bool cacheCoversNow = false;
+  const bool loadedFromCache =
+      priceCacheLoad(kActiveSourceLabel, gCacheBuffer, cacheCoversNow) &&
+      prepareNordPoolCacheForCurrentFormula(gCacheBuffer) &&
+      applyLoadedCacheState(gCacheBuffer, cacheCoversNow ? "current" : "available", cacheCoversNow);
+  lanApiStart();
+  mqttStart();
+
+  if (loadedFromCache)
   {
-    if (priceCacheLoadIfAvailable(kActiveSourceLabel, gCacheBuffer) &&
-        prepareNordPoolCacheForCurrentFormula(gCacheBuffer))
-    {
-      gState = gCacheBuffer;
-      gState.source = "no wifi";
-      displayDrawPrices(gState);
-      updateCurrentIntervalFromClock(true);
-      logf("No WiFi at boot, loaded prices from cache: points=%u", (unsigned)gState.count);
-      gNeedsOnlineInit = true;
-      initWatchdog();
-      return;
-    }
-
-    gState.ok = false;
-    gState.source = "no wifi";
-    gState.error = "no wifi";
-    displayDrawPrices(gState);
+    // The worker connects WiFi; the loop's online init then syncs the clock
+    // and fetches, and the result redraws in place.
+    LOG_INFO(App, "Fast boot from cache in %lu ms, connecting WiFi in the background", (unsigned long)millis());
+    updateCurrentIntervalFromClock(true);
     gNeedsOnlineInit = true;
+    gPortalFallbackPending = true;
+    networkWorkerStart(kWifiConnectTimeoutMs, wakeMainLoop);
+    networkWorkerWake();
     initWatchdog();
     return;
   }
 
-  syncClockAndPrimeSchedules();
-
-  if (priceCacheLoadIfCurrent(kActiveSourceLabel, gCacheBuffer) &&
-      prepareNordPoolCacheForCurrentFormula(gCacheBuffer))
-  {
-    loadedFromCache = applyLoadedCacheState(gCacheBuffer, "current", true);
-    loadedCurrentCache = loadedFromCache;
-  }
-  else if (priceCacheLoadIfAvailable(kActiveSourceLabel, gCacheBuffer) &&
-           prepareNordPoolCacheForCurrentFormula(gCacheBuffer))
-  {
-    loadedFromCache = applyLoadedCacheState(gCacheBuffer, "available", false);
-  }
-
-  if (!loadedFromCache || !loadedCurrentCache)
+  // Nothing to show yet: connect in the foreground so a missing or wrong
+  // WiFi setup opens the config portal.
+  const bool wifiConnected = wifiConnectWithConfigPortal(gSecrets, kWifiPortalTimeoutSec);
+  reloadPriceFormula();
+  syncPublishStatsArea();
+  if (!wifiConnected)
   {
-    if (loadedFromCache && !loadedCurrentCache)
-    {
-      logf("Available cache loaded without current interval coverage; fetching fresh prices now");
-    }
-    fetchAndRender();
+    gState->ok = false;
+    copyStateText(gState->source, "no wifi");
+    copyStateText(gState->error, "no wifi");
+    drawPrices();
+    gNeedsOnlineInit = true;
+    networkWorkerStart(kWifiConnectTimeoutMs, wakeMainLoop);
+    initWatchdog();
+    return;
   }
 
-  const time_t now = time(nullptr);
-  if (loadedFromCache && shouldCatchUpMissedDailyUpdate(now, gState, kDailyFetchHour, kDailyFetchMinute, kValidEpochMin))
+  syncClockAndPrimeSchedules();
+  networkWorkerStart(kWifiConnectTimeoutMs, wakeMainLoop);
+  if (!requestFetch(FetchReason::Startup))
   {
-    gNextDailyFetch = now;
-    logf("Startup catch-up fetch scheduled immediately");
-    gPendingCatchUpRecheck = false;
+    LOG_ERROR(App, "Startup fetch request rejected");
   }
-
-  updateCurrentIntervalFromClock(true);
   initWatchdog();
 }
 
 void loop()
 {
-  esp_task_wdt_reset();
+  // The worker has its own time budget; a job stuck past the watchdog
+  // window stops the feed so the device reboots as it did before.
+  if (networkWorkerBusyMs() < kWatchdogTimeoutMs)
+  {
+    esp_task_wdt_reset();
+  }
   handleResetRequest();
-
-  const bool wifiConnected = (WiFi.status() == WL_CONNECTED) || wifiReconnect(kWifiConnectTimeoutMs);
-  if (!wifiConnected)
+  perfPollSerial();
+  handleCompletedNetworkJob();
+
+  // Reconnecting is the network worker's job; the UI only watches the status.
+  // With an on-demand radio WiFi is down by design and jobs connect first.
+  const bool wifiConnected = powerRadioOnDemand() || WiFi.status() == WL_CONNECTED;
+  // A fetch in flight reads *gState as its `existing` prices on the other
+  // core, so the banner text waits until the worker hands it back.
+  if (!wifiConnected && !networkWorkerBusy())
   {
-    if (gState.ok)
+    if (gState->ok)
     {
-      if (gState.source != "no wifi")
+      if (!stateTextEquals(gState->source, "no wifi"))
       {
-        gState.source = "no wifi";
-        displayDrawPrices(gState);
+        copyStateText(gState->source, "no wifi");
+        drawPrices();
       }
     }
     else
     {
-      const bool needsRedraw = gState.source != "no wifi" || gState.error != "no wifi";
-      gState.source = "no wifi";
-      gState.error = "no wifi";
+      const bool needsRedraw = !stateTextEquals(gState->source, "no wifi") || !stateTextEquals(gState->error, "no wifi");
+      copyStateText(gState->source, "no wifi");
+      copyStateText(gState->error, "no wifi");
       if (needsRedraw)
       {
-        displayDrawPrices(gState);
+        drawPrices();
       }
     }
   }
 
-  if (wifiConnected && gNeedsOnlineInit)
-  {
-    logf("WiFi restored, running online init");
-    gNeedsOnlineInit = false;
-    loadAppSecrets(gSecrets);
-    syncClockAndPrimeSchedules();
-    fetchAndRender();
-  }
+  handleBackgroundPortal();
 
-  const bool hasFetchError = !gState.error.isEmpty();
-  if (wifiConnected && (!gState.ok || hasFetchError) && millis() - gLastFetchMs >= gRetryIntervalMs)
+  if (wifiConnected && gNeedsOnlineInit && !networkWorkerBusy())
   {
-    logf("Retry fetch due to error state (interval=%us)", (unsigned)(gRetryIntervalMs / 1000));
-    fetchAndRender();
-    if (!gState.ok || !gState.error.isEmpty())
-    {
-      gRetryIntervalMs = std::min(gRetryIntervalMs * 2, kRetryOnErrorMaxMs);
-      logf("Backoff: next retry in %us", (unsigned)(gRetryIntervalMs / 1000));
-    }
+    LOG_INFO(App, "WiFi restored, running online init");
+    loadAppSecrets(gSecrets);
+    reloadPriceFormula();
+    syncPublishStatsArea();
+    gNeedsOnlineInit = !requestClockSync(true);
   }
 
-  handleClockDrivenUpdates(time(nullptr));
+  syncErrorRetryDeadline();
+  schedulePageRotation();
+  handleDueDeadlines(wifiConnected);
+  lanApiUpdate(gView);
+  mqttPublishState(gView);
+  waitForNextEvent(wifiConnected);
 }
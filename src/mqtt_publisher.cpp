@@ -0,0 +1,439 @@
+#include "mqtt_publisher.h"
+
+#if CONFIG_MQTT
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logging_utils.h"
+#include "price_fixed.h"
+#include "price_state_utils.h"
+
+namespace {
+constexpr size_t kQueueSlots = 6;
+constexpr size_t kSmallPayloadLen = 96;
+// Worst case per point: "-214748.3647," as price, "99999," as minute
+// offset when slots are not uniform, and one level digit.
+constexpr size_t kSeriesPointLen = 13 + 6 + 1;
+constexpr size_t kSeriesPayloadLen = 64 + kMaxPoints * kSeriesPointLen;
+constexpr size_t kTopicLen = 48;
+constexpr size_t kPacketLen = kSeriesPayloadLen + kTopicLen + 8;
+constexpr uint16_t kKeepAliveSec = 60;
+constexpr uint32_t kPingAfterIdleMs = (kKeepAliveSec * 1000UL) / 2;
+constexpr uint32_t kPingTimeoutMs = 10000;
+constexpr uint32_t kConnectTimeoutMs = 5000;
+constexpr uint32_t kRetryMinMs = 5000;
+constexpr uint32_t kRetryMaxMs = 5UL * 60UL * 1000UL;
+constexpr uint32_t kWorkerStackBytes = 4096;
+constexpr UBaseType_t kWorkerPriority = 1;
+constexpr BaseType_t kWorkerCore = 0;
+
+enum class Topic : uint8_t {
+  Status = 0,
+  Current,
+  Series,
+};
+
+struct SmallMessage {
+  Topic topic = Topic::Current;
+  uint16_t len = 0;
+  char payload[kSmallPayloadLen];
+};
+
+// Shared between producers and the worker, guarded by gLock. Small messages
+// go through a ring that drops the oldest when full; the series has one
+// slot where a newer series replaces one not yet sent.
+SmallMessage gQueue[kQueueSlots];
+size_t gQueueHead = 0;
+size_t gQueueCount = 0;
+uint32_t gQueueDropped = 0;
+char gSeriesPending[kSeriesPayloadLen];
+size_t gSeriesPendingLen = 0;
+SemaphoreHandle_t gLock = nullptr;
+TaskHandle_t gWorkerTask = nullptr;
+// Set by the worker after each (re)connect so retained topics are rebuilt
+// from the next state the loop hands in.
+std::atomic<bool> gRepublish{false};
+
+// What was last queued; touched by the loop task only.
+struct PublishedKey {
+  bool hasCurrent = false;
+  uint32_t currentStartsAt = 0;
+  int32_t currentPrice = 0;
+  PriceLevel currentLevel = PriceLevel::Unknown;
+  bool hasSeries = false;
+  uint32_t fingerprint = 0;
+  bool seriesWaiting = false;  // built but not yet handed over
+};
+PublishedKey gKey;
+char gSeriesStaging[kSeriesPayloadLen];
+size_t gSeriesStagingLen = 0;
+
+// Worker-side connection state.
+WiFiClient gClient;
+bool gConnected = false;
+uint32_t gLastSendMs = 0;
+uint32_t gPingSentMs = 0;
+uint32_t gNextConnectMs = 0;
+uint32_t gRetryMs = kRetryMinMs;
+uint8_t gPacket[kPacketLen];
+
+const char *topicSuffix(Topic topic) {
+  switch (topic) {
+    case Topic::Status: return "status";
+    case Topic::Series: return "series";
+    case Topic::Current:
+    default: return "current";
+  }
+}
+
+size_t appendf(char *out, size_t capacity, size_t len, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+size_t appendf(char *out, size_t capacity, size_t len, const char *fmt, ...) {
+  if (len >= capacity) return capacity;
+  va_list args;
+  va_start(args, fmt);
+  const int written = vsnprintf(out + len, capacity - len, fmt, args);
+  va_end(args);
+  if (written < 0 || (size_t)written >= capacity - len) return capacity;
+  return len + (size_t)written;
+}
+
+bool enqueueSmall(Topic topic, const char *payload, size_t len) {
+  if (xSemaphoreTake(gLock, 0) != pdTRUE) return false;
+  SmallMessage &slot = gQueue[gQueueHead];
+  slot.topic = topic;
+  slot.len = (uint16_t)len;
+  memcpy(slot.payload, payload, len);
+  gQueueHead = (gQueueHead + 1) % kQueueSlots;
+  if (gQueueCount < kQueueSlots) {
+    ++gQueueCount;
+  } else {
+    ++gQueueDropped;
+  }
+  xSemaphoreGive(gLock);
+  xTaskNotifyGive(gWorkerTask);
+  return true;
+}
+
+bool handOverSeries() {
+  if (xSemaphoreTake(gLock, 0) != pdTRUE) return false;
+  memcpy(gSeriesPending, gSeriesStaging, gSeriesStagingLen);
+  gSeriesPendingLen = gSeriesStagingLen;
+  xSemaphoreGive(gLock);
+  xTaskNotifyGive(gWorkerTask);
+  return true;
+}
+
+// {"res":15,"start":..,"prices":[..],"levels":"1233.."} for uniform slots;
+// otherwise "dt":[..] adds each slot's start in minutes after "start".
+size_t buildSeries(const PriceState &state, char *out, size_t capacity) {
+  const uint32_t start = state.slotsUniform ? state.slotBaseStartsAt : state.points[0].startsAt;
+  size_t len = appendf(
+      out, capacity, 0, "{\"res\":%u,\"start\":%lu", (unsigned)state.resolutionMinutes, (unsigned long)start);
+  if (!state.slotsUniform) {
+    len = appendf(out, capacity, len, ",\"dt\":[");
+    for (size_t i = 0; i < state.count; ++i) {
+      const uint32_t offsetMin = (state.points[i].startsAt - start) / 60;
+      len = appendf(out, capacity, len, "%s%lu", i == 0 ? "" : ",", (unsigned long)offsetMin);
+    }
+    len = appendf(out, capacity, len, "]");
+  }
+  len = appendf(out, capacity, len, ",\"prices\":[");
+  char price[16];
+  for (size_t i = 0; i < state.count; ++i) {
+    formatPriceFixed(state.points[i].price, 4, price, sizeof(price));
+    len = appendf(out, capacity, len, "%s%s", i == 0 ? "" : ",", price);
+  }
+  len = appendf(out, capacity, len, "],\"levels\":\"");
+  for (size_t i = 0; i < state.count; ++i) {
+    len = appendf(out, capacity, len, "%u", (unsigned)state.points[i].level);
+  }
+  len = appendf(out, capacity, len, "\"}");
+  return len < capacity ? len : 0;
+}
+
+// --- MQTT 3.1.1 framing (QoS 0 only) ---
+
+size_t putRemainingLength(uint8_t *out, size_t value) {
+  size_t n = 0;
+  do {
+    uint8_t byte = value % 128;
+    value /= 128;
+    if (value > 0) byte |= 0x80;
+    out[n++] = byte;
+  } while (value > 0);
+  return n;
+}
+
+size_t putString(uint8_t *out, const char *text, size_t len) {
+  out[0] = (uint8_t)(len >> 8);
+  out[1] = (uint8_t)(len & 0xFF);
+  memcpy(out + 2, text, len);
+  return len + 2;
+}
+
+// Fixed header plus body already placed at gPacket + 5; returns the packet start.
+const uint8_t *finishPacket(uint8_t type, size_t bodyLen, size_t &packetLen) {
+  uint8_t header[5];
+  header[0] = type;
+  const size_t lenBytes = putRemainingLength(header + 1, bodyLen);
+  uint8_t *start = gPacket + 5 - (1 + lenBytes);
+  memcpy(start, header, 1 + lenBytes);
+  packetLen = 1 + lenBytes + bodyLen;
+  return start;
+}
+
+bool sendPacket(const uint8_t *packet, size_t len) {
+  if (gClient.write(packet, len) != len) return false;
+  gLastSendMs = millis();
+  return true;
+}
+
+bool sendPublish(Topic topic, const char *payload, size_t payloadLen) {
+  char topicName[kTopicLen];
+  const int topicLen = snprintf(topicName, sizeof(topicName), "%s/%s", CONFIG_MQTT_TOPIC_PREFIX, topicSuffix(topic));
+  if (topicLen <= 0 || (size_t)topicLen >= sizeof(topicName)) return false;
+  if (5 + 2 + (size_t)topicLen + payloadLen > sizeof(gPacket)) return false;
+
+  uint8_t *body = gPacket + 5;
+  size_t bodyLen = putString(body, topicName, (size_t)topicLen);
+  memcpy(body + bodyLen, payload, payloadLen);
+  bodyLen += payloadLen;
+  size_t packetLen = 0;
+  const uint8_t *packet = finishPacket(0x31, bodyLen, packetLen);  // PUBLISH, QoS 0, retain
+  return sendPacket(packet, packetLen);
+}
+
+// Broker-side failures back off exponentially. A failure while our own
+// WiFi link is down says nothing about the broker, so it reconnects as soon
+// as WiFi is back.
+void dropConnection(const char *reason) {
+  if (gConnected) LOG_INFO(Net, "MQTT disconnected: %s", reason);
+  gClient.stop();
+  gConnected = false;
+  if (WiFi.status() != WL_CONNECTED) {
+    gNextConnectMs = millis();
+    return;
+  }
+  gNextConnectMs = millis() + gRetryMs;
+  gRetryMs = gRetryMs * 2 > kRetryMaxMs ? kRetryMaxMs : gRetryMs * 2;
+}
+
+bool connectBroker() {
+  if (!gClient.connect(CONFIG_MQTT_HOST, CONFIG_MQTT_PORT)) {
+    dropConnection("connect failed");
+    return false;
+  }
+
+  char willTopic[kTopicLen];
+  const int willTopicLen = snprintf(willTopic, sizeof(willTopic), "%s/%s", CONFIG_MQTT_TOPIC_PREFIX, topicSuffix(Topic::Status));
+  const size_t userLen = strlen(CONFIG_MQTT_USER);
+  const size_t passwordLen = strlen(CONFIG_MQTT_PASSWORD);
+  // Clean session, retained "offline" will on <prefix>/status.
+  uint8_t flags = 0x02 | 0x04 | 0x20;
+  if (userLen > 0) flags |= 0x80;
+  if (userLen > 0 && passwordLen > 0) flags |= 0x40;
+
+  uint8_t *body = gPacket + 5;
+  size_t bodyLen = putString(body, "MQTT", 4);
+  body[bodyLen++] = 4;  // protocol level 3.1.1
+  body[bodyLen++] = flags;
+  body[bodyLen++] = (uint8_t)(kKeepAliveSec >> 8);
+  body[bodyLen++] = (uint8_t)(kKeepAliveSec & 0xFF);
+  bodyLen += putString(body + bodyLen, CONFIG_MQTT_CLIENT_ID, strlen(CONFIG_MQTT_CLIENT_ID));
+  bodyLen += putString(body + bodyLen, willTopic, (size_t)willTopicLen);
+  bodyLen += putString(body + bodyLen, "offline", 7);
+  if (flags & 0x80) bodyLen += putString(body + bodyLen, CONFIG_MQTT_USER, userLen);
+  if (flags & 0x40) bodyLen += putString(body + bodyLen, CONFIG_MQTT_PASSWORD, passwordLen);
+  size_t packetLen = 0;
+  const uint8_t *packet = finishPacket(0x10, bodyLen, packetLen);
+  if (!sendPacket(packet, packetLen)) {
+    dropConnection("CONNECT write failed");
+    return false;
+  }
+
+  uint8_t connack[4];
+  size_t got = 0;
+  const uint32_t startMs = millis();
+  while (got < sizeof(connack) && millis() - startMs < kConnectTimeoutMs) {
+    const int c = gClient.read();
+    if (c < 0) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+      continue;
+    }
+    connack[got++] = (uint8_t)c;
+  }
+  if (got < sizeof(connack) || connack[0] != 0x20 || connack[3] != 0) {
+    LOG_WARN(Net, "MQTT CONNACK failed: got=%u rc=%d", (unsigned)got, got == sizeof(connack) ? (int)connack[3] : -1);
+    dropConnection("rejected");
+    return false;
+  }
+
+  gConnected = true;
+  gRetryMs = kRetryMinMs;
+  gPingSentMs = 0;
+  LOG_INFO(Net, "MQTT connected to %s:%u", CONFIG_MQTT_HOST, (unsigned)CONFIG_MQTT_PORT);
+  return sendPublish(Topic::Status, "online", 6);
+}
+
+// Consumes PINGRESP and anything else the broker sends; we subscribe to nothing.
+void drainIncoming() {
+  uint8_t scratch[32];
+  while (gClient.available() > 0) {
+    const int got = gClient.read(scratch, sizeof(scratch));
+    if (got <= 0) break;
+    for (int i = 0; i + 1 < got; ++i) {
+      if (scratch[i] == 0xD0 && scratch[i + 1] == 0x00) gPingSentMs = 0;
+    }
+  }
+}
+
+void keepAlive() {
+  const uint32_t now = millis();
+  if (gPingSentMs != 0 && now - gPingSentMs > kPingTimeoutMs) {
+    dropConnection("ping timeout");
+    return;
+  }
+  if (gPingSentMs == 0 && now - gLastSendMs >= kPingAfterIdleMs) {
+    static const uint8_t kPingReq[2] = {0xC0, 0x00};
+    if (!sendPacket(kPingReq, sizeof(kPingReq))) {
+      dropConnection("ping write failed");
+      return;
+    }
+    gPingSentMs = now;
+  }
+}
+
+// Sends queued messages oldest first; a failed send keeps the rest queued.
+void flushQueue() {
+  static SmallMessage message;
+  static char series[kSeriesPayloadLen];
+  for (;;) {
+    bool haveSmall = false;
+    size_t seriesLen = 0;
+    uint32_t dropped = 0;
+    xSemaphoreTake(gLock, portMAX_DELAY);
+    if (gQueueCount > 0) {
+      message = gQueue[(gQueueHead + kQueueSlots - gQueueCount) % kQueueSlots];
+      --gQueueCount;
+      haveSmall = true;
+    } else if (gSeriesPendingLen > 0) {
+      seriesLen = gSeriesPendingLen;
+      memcpy(series, gSeriesPending, seriesLen);
+      gSeriesPendingLen = 0;
+    }
+    dropped = gQueueDropped;
+    gQueueDropped = 0;
+    xSemaphoreGive(gLock);
+
+    if (dropped > 0) LOG_WARN(Net, "MQTT queue full, dropped %lu messages", (unsigned long)dropped);
+    if (!haveSmall && seriesLen == 0) return;
+    const bool sent = haveSmall ? sendPublish(message.topic, message.payload, message.len)
+                                : sendPublish(Topic::Series, series, seriesLen);
+    if (!sent) {
+      // Retained topics only need the newest value; losing this one is fine
+      // as long as the next change or reconnect republishes.
+      dropConnection("publish failed");
+      return;
+    }
+  }
+}
+
+void workerMain(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    if (WiFi.status() != WL_CONNECTED) {
+      if (gConnected) dropConnection("wifi down");
+      continue;
+    }
+    if (!gConnected) {
+      if ((int32_t)(millis() - gNextConnectMs) < 0 || !connectBroker()) continue;
+      gRepublish.store(true);
+    }
+    if (!gClient.connected()) {
+      dropConnection("socket closed");
+      continue;
+    }
+    drainIncoming();
+    flushQueue();
+    if (gConnected) keepAlive();
+  }
+}
+}  // namespace
+
+bool mqttStart() {
+  if (gWorkerTask != nullptr) return true;
+  if (strlen(CONFIG_MQTT_HOST) == 0) {
+    LOG_ERROR(Net, "MQTT enabled but CONFIG_MQTT_HOST is empty");
+    return false;
+  }
+  gLock = xSemaphoreCreateMutex();
+  if (gLock == nullptr) return false;
+  const BaseType_t created = xTaskCreatePinnedToCore(
+      workerMain, "mqtt_pub", kWorkerStackBytes, nullptr, kWorkerPriority, &gWorkerTask, kWorkerCore);
+  if (created != pdPASS) {
+    gWorkerTask = nullptr;
+    LOG_ERROR(Net, "MQTT publisher start failed");
+    return false;
+  }
+  return true;
+}
+
+void mqttPublishState(const PriceState &state) {
+  if (gWorkerTask == nullptr || !state.ok || state.count == 0) return;
+  if (gRepublish.exchange(false)) {
+    gKey.hasCurrent = false;
+    gKey.hasSeries = false;
+  }
+
+  if (!gKey.hasSeries || gKey.fingerprint != state.fingerprint) {
+    gSeriesStagingLen = buildSeries(state, gSeriesStaging, sizeof(gSeriesStaging));
+    if (gSeriesStagingLen == 0) {
+      LOG_WARN(Net, "MQTT series too large: points=%u", (unsigned)state.count);
+    } else {
+      gKey.seriesWaiting = true;
+    }
+    gKey.fingerprint = state.fingerprint;
+    gKey.hasSeries = true;
+  }
+  if (gKey.seriesWaiting && handOverSeries()) gKey.seriesWaiting = false;
+
+  if (state.currentIndex < 0) return;
+  if (gKey.hasCurrent && gKey.currentStartsAt == state.currentStartsAt && gKey.currentPrice == state.currentPrice &&
+      gKey.currentLevel == state.currentLevel) {
+    return;
+  }
+  char price[16];
+  formatPriceFixed(state.currentPrice, 4, price, sizeof(price));
+  char payload[kSmallPayloadLen];
+  const int len = snprintf(
+      payload,
+      sizeof(payload),
+      "{\"t\":%lu,\"p\":%s,\"l\":\"%s\"}",
+      (unsigned long)state.currentStartsAt,
+      price,
+      priceLevelName(state.currentLevel));
+  if (len <= 0 || (size_t)len >= sizeof(payload)) return;
+  if (!enqueueSmall(Topic::Current, payload, (size_t)len)) return;
+  gKey.hasCurrent = true;
+  gKey.currentStartsAt = state.currentStartsAt;
+  gKey.currentPrice = state.currentPrice;
+  gKey.currentLevel = state.currentLevel;
+}
+
+#else
+
+bool mqttStart() {
+  return false;
+}
+
+void mqttPublishState(const PriceState &) {}
+
+#endif  // CONFIG_MQTT
@@ -0,0 +1,170 @@
+#include "network_worker.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "logging_utils.h"
+#include "nordpool_client.h"
+#include "power_manager.h"
+#include "time_utils.h"
+#include "wifi_utils.h"
+
+namespace {
+// The WiFi/LwIP stack runs on core 0; the Arduino loop owns core 1.
+constexpr BaseType_t kNetworkCore = 0;
+constexpr uint32_t kWorkerStackBytes = 16384;  // TLS handshake + streaming parser
+constexpr UBaseType_t kWorkerPriority = 1;
+// Reconnect cadence while the station is down; once connected the worker
+// sleeps until a job or a WiFi event wakes it.
+constexpr uint32_t kIdleWifiCheckMs = 1000;
+// With an on-demand radio, how long WiFi stays up after a job in case
+// another follows (clock sync is usually followed by a fetch).
+constexpr uint32_t kRadioLingerMs = 10000;
+
+// Single-producer/single-consumer handoff. The UI task writes the request
+// only in Idle and reads results only in Done; the worker touches the
+// request only in Queued/Running. Release/acquire on gPhase orders the
+// request and PriceState contents between the two cores.
+enum JobPhase : uint8_t {
+  kPhaseIdle = 0,
+  kPhaseQueued,
+  kPhaseRunning,
+  kPhaseDone,
+};
+
+std::atomic<uint8_t> gPhase{kPhaseIdle};
+std::atomic<uint32_t> gJobStartMs{0};
+NetworkJobRequest gRequest;
+TaskHandle_t gWorkerTask = nullptr;
+uint32_t gWifiConnectTimeoutMs = 0;
+NetworkJobDoneCallback gOnJobDone = nullptr;
+
+void radioUp() {
+  if (!powerRadioOnDemand()) return;
+  powerNoteRadio(true);
+  if (WiFi.status() != WL_CONNECTED) wifiReconnect(gWifiConnectTimeoutMs);
+}
+
+void radioDown() {
+  LOG_INFO(Power, "WiFi radio off until next network job");
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  powerNoteRadio(false);
+}
+
+TickType_t idleWaitTicks() {
+  if (powerRadioOnDemand()) return powerRadioOn() ? pdMS_TO_TICKS(kRadioLingerMs) : portMAX_DELAY;
+  return WiFi.status() == WL_CONNECTED ? portMAX_DELAY : pdMS_TO_TICKS(kIdleWifiCheckMs);
+}
+
+void runFetchPrices(const NetworkJobRequest &request) {
+  PriceState &out = *request.out;
+  if (WiFi.status() != WL_CONNECTED && !wifiReconnect(gWifiConnectTimeoutMs)) {
+    out = PriceState();
+    copyStateText(out.source, "no wifi");
+    copyStateText(out.error, "no wifi");
+    return;
+  }
+
+  fetchNordPoolPriceInfo(
+      request.apiUrl,
+      request.area,
+      request.extraAreas,
+      request.currency,
+      request.formula,
+      request.existing,
+      out);
+}
+
+void runJob(const NetworkJobRequest &request) {
+  const uint32_t startMs = millis();
+  radioUp();
+  switch (request.job) {
+    case NetworkJob::SyncClock:
+      syncClock(request.timezoneSpec);
+      break;
+    case NetworkJob::FetchPrices:
+      runFetchPrices(request);
+      break;
+    case NetworkJob::None:
+    default:
+      break;
+  }
+  LOG_DEBUG(Net, "Network job %u done in %lums", (unsigned)request.job, (unsigned long)(millis() - startMs));
+}
+
+void workerMain(void *) {
+  for (;;) {
+    const bool notified = ulTaskNotifyTake(pdTRUE, idleWaitTicks()) != 0;
+
+    uint8_t expected = kPhaseQueued;
+    if (gPhase.compare_exchange_strong(expected, kPhaseRunning, std::memory_order_acquire)) {
+      gJobStartMs.store(millis(), std::memory_order_relaxed);
+      runJob(gRequest);
+      gJobStartMs.store(0, std::memory_order_relaxed);
+      gPhase.store(kPhaseDone, std::memory_order_release);
+      if (gOnJobDone != nullptr) gOnJobDone();
+      continue;
+    }
+
+    if (gPhase.load(std::memory_order_relaxed) != kPhaseIdle) continue;
+    if (powerRadioOnDemand()) {
+      if (!notified && powerRadioOn()) radioDown();
+    } else if (WiFi.status() != WL_CONNECTED) {
+      wifiReconnect(gWifiConnectTimeoutMs);
+    }
+  }
+}
+}  // namespace
+
+bool networkWorkerStart(uint32_t wifiConnectTimeoutMs, NetworkJobDoneCallback onJobDone) {
+  if (gWorkerTask != nullptr) return true;
+  gWifiConnectTimeoutMs = wifiConnectTimeoutMs;
+  gOnJobDone = onJobDone;
+  // Boot may have connected already; the idle loop then drops it after the linger.
+  if (powerRadioOnDemand() && WiFi.status() == WL_CONNECTED) powerNoteRadio(true);
+  const BaseType_t created = xTaskCreatePinnedToCore(
+      workerMain, "net_worker", kWorkerStackBytes, nullptr, kWorkerPriority, &gWorkerTask, kNetworkCore);
+  if (created != pdPASS) {
+    gWorkerTask = nullptr;
+    LOG_ERROR(Net, "Network worker start failed");
+    return false;
+  }
+  LOG_INFO(Net, "Network worker started on core %d", (int)kNetworkCore);
+  return true;
+}
+
+void networkWorkerWake() {
+  if (gWorkerTask != nullptr) xTaskNotifyGive(gWorkerTask);
+}
+
+bool networkWorkerSubmit(const NetworkJobRequest &request) {
+  if (gWorkerTask == nullptr || request.job == NetworkJob::None) return false;
+  if (request.job == NetworkJob::FetchPrices && request.out == nullptr) return false;
+  if (gPhase.load(std::memory_order_acquire) != kPhaseIdle) return false;
+
+  gRequest = request;
+  gPhase.store(kPhaseQueued, std::memory_order_release);
+  xTaskNotifyGive(gWorkerTask);
+  return true;
+}
+
+NetworkJob networkWorkerTakeCompleted() {
+  if (gPhase.load(std::memory_order_acquire) != kPhaseDone) return NetworkJob::None;
+  const NetworkJob job = gRequest.job;
+  gPhase.store(kPhaseIdle, std::memory_order_release);
+  return job;
+}
+
+bool networkWorkerBusy() {
+  return gPhase.load(std::memory_order_acquire) != kPhaseIdle;
+}
+
+uint32_t networkWorkerBusyMs() {
+  const uint32_t startMs = gJobStartMs.load(std::memory_order_relaxed);
+  if (startMs == 0) return 0;
+  return millis() - startMs;
+}
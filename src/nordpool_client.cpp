@@ -1,7 +1,7 @@
-#include <ArduinoJson.h>
 #include <HTTPClient.h>
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
 #include <math.h>
 #include <stdint.h>
 #include <string.h>
@@ -10,126 +10,426 @@
 #include "logging_utils.h"
 #include "nordpool_ma_store.h"
 #include "nordpool_client.h"
+#include "nordpool_parser.h"
+#include "perf_spans.h"
+#include "price_fixed.h"
+#include "price_history.h"
+#include "price_state_utils.h"
 #include "time_utils.h"
 
 namespace {
 constexpr uint32_t kHttpTimeoutMs = 10000;
-constexpr float kDefaultMovingAveragePerKwh = 1.0f;
-constexpr float kDefaultVatPercent = 25.0f;
-constexpr float kDefaultFixedCostPerKwh = 0.0f;
-constexpr float kCentsMultiplier = 100.0f;
-
-float applyCustomPriceFormula(float rawPricePerKwh, float vatPercent, float fixedCostMinorPerKwh) {
-  // Apply configured formula in minor units per kWh:
-  // ((energy_major * 100) * (1 + VAT/100) + fixed_cost_minor) / 100.
-  const float vatMultiplier = 1.0f + (vatPercent / 100.0f);
-  const float energyPriceMinorPerKwh = rawPricePerKwh * kCentsMultiplier;
-  const float adjustedPriceMinorPerKwh = (energyPriceMinorPerKwh * vatMultiplier) + fixedCostMinorPerKwh;
-  return adjustedPriceMinorPerKwh / kCentsMultiplier;
-}
-
-float normalizeVatPercent(float value) {
-  if (!isfinite(value)) return kDefaultVatPercent;
-  if (value < 0.0f || value > 100.0f) return kDefaultVatPercent;
-  return value;
-}
-
-float normalizeFixedCostPerKwh(float value) {
-  if (!isfinite(value)) return kDefaultFixedCostPerKwh;
-  if (value < -10000.0f || value > 10000.0f) return kDefaultFixedCostPerKwh;
-  return value;
-}
+constexpr size_t kStreamChunkBytes = 512;
+constexpr uint32_t kKeepAliveIdleMs = 30000;
+constexpr int32_t kDefaultMovingAverage = kPriceFixedPerMajor;  // 1.00 per kWh
+
+#ifndef CONFIG_PRICE_LEVELS_FROM_HISTORY
+#define CONFIG_PRICE_LEVELS_FROM_HISTORY 0
+#endif
+constexpr bool kPriceLevelsFromHistory = CONFIG_PRICE_LEVELS_FROM_HISTORY != 0;
+// Percentile levels need at least a week of history; until then the
+// moving-average ratio is used.
+constexpr uint16_t kLevelHistoryDays = 30;
+constexpr uint16_t kLevelHistoryMinDays = 7;
+static_assert(kMaxAreas <= kNordPoolParserMaxAreas, "parser cannot filter that many areas");
 
 uint16_t movingAverageWindowForResolution(uint16_t resolutionMinutes) {
   const uint16_t normalizedResolution = normalizeResolutionMinutes(resolutionMinutes);
   return (uint16_t)((kMovingAverageWindowHours * 60) / normalizedResolution);
 }
 
-bool isIntervalKey(const String &value) {
-  return value.length() == 13 || value.length() == 16;
+// Level boundaries in final (formula-applied) prices, taken from the
+// long-term history's p10/p30/p70/p90 once enough days are recorded.
+struct LevelThresholds {
+  bool valid = false;
+  int32_t veryCheap = 0;
+  int32_t cheap = 0;
+  int32_t expensive = 0;
+  int32_t veryExpensive = 0;
+};
+
+// Raw-price p10/p30/p70/p90 from the last moving-average update. Views are
+// built on the loop task while the network worker may be recording
+// history, so they take these instead of querying price_history.
+struct RawThresholds {
+  bool valid = false;
+  int32_t values[4] = {0};
+};
+
+portMUX_TYPE gThresholdsMux = portMUX_INITIALIZER_UNLOCKED;
+RawThresholds gRawThresholds;
+
+void refreshRawThresholds() {
+  RawThresholds raw;
+  static const uint8_t kPercents[4] = {10, 30, 70, 90};
+  if (kPriceLevelsFromHistory &&
+      priceHistoryPercentiles(kLevelHistoryDays, kLevelHistoryMinDays, kPercents, 4, raw.values)) {
+    raw.valid = true;
+  }
+  portENTER_CRITICAL(&gThresholdsMux);
+  gRawThresholds = raw;
+  portEXIT_CRITICAL(&gThresholdsMux);
 }
 
-String classifyLevelFromAverage(float pricePerKwh, float movingAvgPerKwh) {
-  if (movingAvgPerKwh <= 0.0001f) return "UNKNOWN";
+bool loadLevelThresholds(const PriceFormula &formula, LevelThresholds &out) {
+  out = LevelThresholds();
+  portENTER_CRITICAL(&gThresholdsMux);
+  const RawThresholds raw = gRawThresholds;
+  portEXIT_CRITICAL(&gThresholdsMux);
+  if (!raw.valid) return false;
+
+  // The formula is increasing in the raw price, so percentiles map through it.
+  out.veryCheap = applyPriceFormula(formula, raw.values[0]);
+  out.cheap = applyPriceFormula(formula, raw.values[1]);
+  out.expensive = applyPriceFormula(formula, raw.values[2]);
+  out.veryExpensive = applyPriceFormula(formula, raw.values[3]);
+  out.valid = out.veryCheap < out.veryExpensive;
+  return out.valid;
+}
 
-  const float ratio = pricePerKwh / movingAvgPerKwh;
-  if (ratio <= 0.60f) return "VERY_CHEAP";
-  if (ratio <= 0.90f) return "CHEAP";
-  if (ratio < 1.15f) return "NORMAL";
-  if (ratio < 1.40f) return "EXPENSIVE";
-  return "VERY_EXPENSIVE";
+PriceLevel classifyLevelFromAverage(int32_t price, int32_t movingAvg, const LevelThresholds *thresholds) {
+  if (thresholds != nullptr && thresholds->valid) {
+    if (price <= thresholds->veryCheap) return PriceLevel::VeryCheap;
+    if (price <= thresholds->cheap) return PriceLevel::Cheap;
+    if (price < thresholds->expensive) return PriceLevel::Normal;
+    if (price < thresholds->veryExpensive) return PriceLevel::Expensive;
+    return PriceLevel::VeryExpensive;
+  }
+  if (movingAvg <= 0) return PriceLevel::Unknown;
+
+  // price / movingAvg against 0.60, 0.90, 1.15 and 1.40, cross-multiplied.
+  const int64_t scaledPrice = (int64_t)price * 100;
+  const int64_t avg = movingAvg;
+  if (scaledPrice <= avg * 60) return PriceLevel::VeryCheap;
+  if (scaledPrice <= avg * 90) return PriceLevel::Cheap;
+  if (scaledPrice < avg * 115) return PriceLevel::Normal;
+  if (scaledPrice < avg * 140) return PriceLevel::Expensive;
+  return PriceLevel::VeryExpensive;
 }
 
-void applyLevelsFromMovingAverage(PriceState &state, float movingAvgPerKwh) {
+void applyLevelsFromMovingAverage(PriceState &state, int32_t movingAvg, const LevelThresholds *thresholds) {
   for (size_t i = 0; i < state.count; ++i) {
-    state.points[i].level = classifyLevelFromAverage(state.points[i].price, movingAvgPerKwh);
+    state.points[i].level = classifyLevelFromAverage(state.points[i].price, movingAvg, thresholds);
   }
 }
 
-bool updateHistoryFromPoints(PriceState &state, MovingAverageStore &store) {
-  bool changed = false;
-  String lastPersisted = String(store.lastSlotKey);
+// Adds slots newer than the store's last sample and returns how many were
+// added; the new samples are copied to `added` for persisting.
+size_t updateHistoryFromPoints(PriceState &state, MovingAverageStore &store, MovingAverageSample *added) {
+  size_t addedCount = 0;
   for (size_t i = 0; i < state.count; ++i) {
-    const String pointKey = intervalKeyFromIso(state.points[i].startsAt, state.resolutionMinutes);
-    if (!isIntervalKey(pointKey)) continue;
-    if (isIntervalKey(lastPersisted) && pointKey <= lastPersisted) continue;  // already processed
+    if (state.points[i].startsAt == 0) continue;
+    const uint32_t slotStart =
+        (uint32_t)intervalStartForTime((time_t)state.points[i].startsAt, state.resolutionMinutes);
+    if (store.lastSlotStart != 0 && slotStart <= store.lastSlotStart) continue;  // already processed
 
     if (!state.points[i].hasRawPrice) continue;
 
     // Include all available fetched points (today + tomorrow) in the rolling history.
     // Store raw market price so the configured formula can be applied later.
-    addMovingAverageSample(store, state.points[i].rawPricePerKwh);
-    strncpy(store.lastSlotKey, pointKey.c_str(), sizeof(store.lastSlotKey) - 1);
-    store.lastSlotKey[sizeof(store.lastSlotKey) - 1] = '\0';
-    lastPersisted = pointKey;
-    changed = true;
+    addMovingAverageSample(store, slotStart, state.points[i].rawPrice);
+    added[addedCount].slotStart = slotStart;
+    added[addedCount].value = state.points[i].rawPrice;
+    ++addedCount;
   }
-  return changed;
+  return addedCount;
 }
 
-bool addPoints(JsonArray arr, const char *area, float vatPercent, float fixedCostMinorPerKwh, PriceState &state) {
-  if (arr.isNull()) return false;
+struct PointSink {
+  PriceState *state = nullptr;
+  PriceFormula formula;
+};
+
+void addPoint(void *ctx, const char *deliveryStart, uint8_t areaIndex, int32_t rawPrice) {
+  PointSink &sink = *(PointSink *)ctx;
+  PriceState &state = *sink.state;
+  const time_t startsAt = utcIsoToEpoch(deliveryStart);
+  if (startsAt <= 0) return;
+
+  if (areaIndex > 0) {
+    // Reported right after the primary area's price for the same item, so
+    // the slot is the point just added; without a primary price it's dropped.
+    if (areaIndex > state.extraAreaCount || state.count == 0) return;
+    if (state.points[state.count - 1].startsAt != (uint32_t)startsAt) return;
+    state.extraAreas[areaIndex - 1].rawPrices[state.count - 1] = rawPrice;
+    return;
+  }
+  if (state.count >= kMaxPoints) return;
+
+  // The parser already converted currency/MWh to fixed-point per kWh.
+  PricePoint &p = state.points[state.count++];
+  p.startsAt = (uint32_t)startsAt;
+  p.price = applyPriceFormula(sink.formula, rawPrice);
+  p.rawPrice = rawPrice;
+  p.hasRawPrice = true;
+  p.level = PriceLevel::Unknown;
+  for (uint8_t i = 0; i < state.extraAreaCount; ++i) {
+    state.extraAreas[i].rawPrices[state.count - 1] = kNoAreaPrice;
+  }
+}
+
+// Fills out's extra area names from a comma-separated list, dropping
+// blanks, duplicates and the primary area.
+void assignExtraAreas(PriceState &out, const char *extraAreas) {
+  out.extraAreaCount = 0;
+  const char *cursor = extraAreas != nullptr ? extraAreas : "";
+  while (*cursor != '\0' && out.extraAreaCount < kMaxExtraAreas) {
+    cursor += strspn(cursor, ", ");
+    const size_t len = strcspn(cursor, ", ");
+    if (len == 0) break;
+
+    char name[kStateAreaLen];
+    const bool fits = len < sizeof(name);
+    if (fits) {
+      memcpy(name, cursor, len);
+      name[len] = '\0';
+    }
+    cursor += len;
+    if (!fits || stateTextEquals(out.area, name)) continue;
+
+    bool duplicate = false;
+    for (uint8_t i = 0; i < out.extraAreaCount; ++i) {
+      duplicate = duplicate || stateTextEquals(out.extraAreas[i].area, name);
+    }
+    if (!duplicate) copyStateText(out.extraAreas[out.extraAreaCount++].area, name);
+  }
+}
+
+bool sameAreaList(const PriceState &a, const PriceState &b) {
+  if (!stateTextEquals(a.area, b.area) || a.extraAreaCount != b.extraAreaCount) return false;
+  for (uint8_t i = 0; i < a.extraAreaCount; ++i) {
+    if (!stateTextEquals(a.extraAreas[i].area, b.extraAreas[i].area)) return false;
+  }
+  return true;
+}
+
+// One TLS connection shared by the today/tomorrow requests and kept open
+// for kKeepAliveIdleMs. Scheduled fetches minutes apart each pay a full
+// handshake: WiFiClientSecure runs mbedTLS setup and handshake in one call
+// (start_ssl_client) and never exposes the session, so there is no point
+// to save a ticket or session ID and offer it on the next connect.
+// Resumption would need a TLS client of our own over mbedTLS.
+struct FetchSession {
+  WiFiClientSecure client;
+  HTTPClient http;
+  bool configured = false;
+  uint32_t lastUseMs = 0;
+  uint32_t connects = 0;
+  uint32_t reuses = 0;
+};
+
+FetchSession &fetchSession() {
+  static FetchSession session;
+  if (!session.configured) {
+    session.configured = true;
+    session.client.setInsecure();
+    session.http.setConnectTimeout(kHttpTimeoutMs);
+    session.http.setTimeout(kHttpTimeoutMs);
+    session.http.useHTTP10(false);
+    session.http.setReuse(true);
+    static const char *kCollectedHeaders[] = {"Transfer-Encoding"};
+    session.http.collectHeaders(kCollectedHeaders, 1);
+  }
+  return session;
+}
 
-  bool added = false;
-  for (JsonObject item : arr) {
-    if (state.count >= kMaxPoints) return added;
+void closeFetchSession(FetchSession &session) {
+  session.http.end();
+  session.client.stop();
+}
 
-    JsonObject entryPerArea = item["entryPerArea"];
-    if (entryPerArea.isNull()) continue;
+// Opens the TLS connection before the request so its cost is timed apart
+// from the request itself; HTTPClient then reuses the connected client.
+bool connectFetchSession(FetchSession &session, const char *url) {
+  const char *host = strstr(url, "://");
+  host = host != nullptr ? host + 3 : url;
+  const size_t hostLen = strcspn(host, ":/?");
+  char hostName[64];
+  if (hostLen == 0 || hostLen >= sizeof(hostName)) return false;
+  memcpy(hostName, host, hostLen);
+  hostName[hostLen] = '\0';
+  const uint16_t port = host[hostLen] == ':' ? (uint16_t)atoi(host + hostLen + 1) : 443;
+
+  const PerfScope span(PerfSpan::FetchConnect);
+  return session.client.connect(hostName, port) == 1;
+}
 
-    const JsonVariant selected = entryPerArea[area];
-    if (selected.isNull()) continue;
+enum class BodyFraming : uint8_t {
+  ContentLength,
+  Chunked,
+  UntilClose,
+};
+
+// Incremental decoder for HTTP/1.1 chunked transfer coding (RFC 9112 7.1).
+struct ChunkedDecoder {
+  enum class Phase : uint8_t { Size, Extension, SizeLf, Data, DataCr, DataLf, Trailer, Done, Error };
+  Phase phase = Phase::Size;
+  size_t remaining = 0;
+  uint8_t sizeDigits = 0;
+  size_t trailerLineLen = 0;
+};
+
+// Chunk sizes up to 0xFFFFFFFF, so the size never wraps a 32-bit size_t.
+constexpr uint8_t kMaxChunkSizeDigits = 8;
+
+int hexValue(uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
 
-    // Nord Pool index prices are in currency/MWh. Convert to currency/kWh.
-    const float nordPoolPricePerMwh = selected | 0.0f;
-    const float energyPricePerKwh = nordPoolPricePerMwh / 1000.0f;
-    const float adjustedPrice = applyCustomPriceFormula(energyPricePerKwh, vatPercent, fixedCostMinorPerKwh);
+// Decodes `len` raw bytes in place and returns the number of payload bytes
+// left at the start of `data`.
+size_t decodeChunked(ChunkedDecoder &decoder, uint8_t *data, size_t len) {
+  using Phase = ChunkedDecoder::Phase;
+  size_t out = 0;
+  for (size_t i = 0; i < len && decoder.phase != Phase::Done && decoder.phase != Phase::Error; ++i) {
+    const uint8_t c = data[i];
+    switch (decoder.phase) {
+      case Phase::Size: {
+        const int digit = hexValue(c);
+        if (digit >= 0) {
+          if (decoder.sizeDigits >= kMaxChunkSizeDigits) {
+            decoder.phase = Phase::Error;
+            break;
+          }
+          decoder.remaining = (decoder.remaining << 4) | (size_t)digit;
+          ++decoder.sizeDigits;
+        } else if (decoder.sizeDigits == 0) {
+          // An empty size line is malformed, not a last chunk.
+          decoder.phase = Phase::Error;
+        } else if (c == ';') {
+          decoder.phase = Phase::Extension;
+        } else if (c == '\r') {
+          decoder.phase = Phase::SizeLf;
+        } else {
+          decoder.phase = Phase::Error;
+        }
+        break;
+      }
+      case Phase::Extension:
+        if (c == '\r') decoder.phase = Phase::SizeLf;
+        break;
+      case Phase::SizeLf:
+        if (c != '\n') {
+          decoder.phase = Phase::Error;
+        } else if (decoder.remaining == 0) {
+          decoder.phase = Phase::Trailer;
+          decoder.trailerLineLen = 0;
+        } else {
+          decoder.phase = Phase::Data;
+        }
+        break;
+      case Phase::Data: {
+        size_t take = len - i;
+        if (take > decoder.remaining) take = decoder.remaining;
+        memmove(&data[out], &data[i], take);
+        out += take;
+        decoder.remaining -= take;
+        i += take - 1;
+        if (decoder.remaining == 0) decoder.phase = Phase::DataCr;
+        break;
+      }
+      case Phase::DataCr:
+        decoder.phase = (c == '\r') ? Phase::DataLf : Phase::Error;
+        break;
+      case Phase::DataLf:
+        decoder.phase = (c == '\n') ? Phase::Size : Phase::Error;
+        decoder.sizeDigits = 0;
+        break;
+      case Phase::Trailer:
+        if (c == '\n') {
+          if (decoder.trailerLineLen == 0) decoder.phase = Phase::Done;
+          decoder.trailerLineLen = 0;
+        } else if (c != '\r') {
+          ++decoder.trailerLineLen;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return out;
+}
 
-    PricePoint &p = state.points[state.count++];
-    p.startsAt = utcIsoToLocalIsoSlot(String((const char *)(item["deliveryStart"] | "")));
-    p.price = adjustedPrice;
-    p.rawPricePerKwh = energyPricePerKwh;
-    p.hasRawPrice = true;
-    p.level = "UNKNOWN";
-    added = true;
+// Streams the response body through the parser in fixed-size chunks. The
+// whole body is consumed, even after the JSON root closes, so the connection
+// is left at a clean message boundary for the next request. Time spent in
+// the parser is added to parseUs.
+bool parseResponseStream(HTTPClient &http, NordPoolStreamParser &parser, uint32_t &parseUs) {
+  WiFiClient &stream = http.getStream();
+  const int contentLength = http.getSize();
+  BodyFraming framing = BodyFraming::UntilClose;
+  if (http.header("Transfer-Encoding").indexOf("chunked") >= 0) {
+    framing = BodyFraming::Chunked;
+  } else if (contentLength >= 0) {
+    framing = BodyFraming::ContentLength;
   }
 
-  return added;
+  ChunkedDecoder decoder;
+  uint8_t buffer[kStreamChunkBytes];
+  size_t rawBytes = 0;
+  uint32_t lastDataMs = millis();
+
+  while (true) {
+    if (framing == BodyFraming::ContentLength && rawBytes >= (size_t)contentLength) return true;
+    if (framing == BodyFraming::Chunked && decoder.phase == ChunkedDecoder::Phase::Done) return true;
+    if (framing == BodyFraming::Chunked && decoder.phase == ChunkedDecoder::Phase::Error) return false;
+    // Without framing the connection can't be reused anyway; stop at the JSON end.
+    if (framing == BodyFraming::UntilClose && parser.status != NordPoolParseStatus::InProgress) return false;
+
+    const int available = stream.available();
+    if (available <= 0) {
+      if (!stream.connected()) return false;
+      if (millis() - lastDataMs >= kHttpTimeoutMs) return false;
+      delay(1);
+      continue;
+    }
+
+    size_t toRead = (size_t)available < sizeof(buffer) ? (size_t)available : sizeof(buffer);
+    if (framing == BodyFraming::ContentLength && toRead > (size_t)contentLength - rawBytes) {
+      toRead = (size_t)contentLength - rawBytes;
+    }
+    const int readBytes = stream.read(buffer, toRead);
+    if (readBytes <= 0) continue;
+    lastDataMs = millis();
+    rawBytes += (size_t)readBytes;
+
+    size_t payloadBytes = (size_t)readBytes;
+    if (framing == BodyFraming::Chunked) {
+      payloadBytes = decodeChunked(decoder, buffer, payloadBytes);
+    }
+    if (parser.status == NordPoolParseStatus::InProgress) {
+      const uint32_t feedStartUs = micros();
+      nordPoolParserFeed(parser, buffer, payloadBytes);
+      parseUs += micros() - feedStartUs;
+    }
+  }
 }
 
 bool fetchDate(
-    HTTPClient &http,
-    WiFiClientSecure &client,
+    FetchSession &session,
     const char *apiBaseUrl,
     const char *date,
-    const char *area,
     const char *currency,
     uint16_t resolutionMinutes,
-    float vatPercent,
-    float fixedCostMinorPerKwh,
+    const PriceFormula &formula,
     PriceState &out
 ) {
   const uint16_t normalizedResolution = normalizeResolutionMinutes(resolutionMinutes);
+  // Every area goes into one request; the response carries all of them in
+  // each multiIndexEntries item.
+  const char *areaNames[kMaxAreas];
+  char indexNames[kMaxAreas * kStateAreaLen];
+  areaNames[0] = out.area;
+  size_t indexLen = (size_t)snprintf(indexNames, sizeof(indexNames), "%s", out.area);
+  for (uint8_t i = 0; i < out.extraAreaCount; ++i) {
+    areaNames[i + 1] = out.extraAreas[i].area;
+    indexLen += (size_t)snprintf(
+        indexNames + indexLen, sizeof(indexNames) - indexLen, ",%s", out.extraAreas[i].area);
+  }
+
   char url[256];
   snprintf(
       url,
@@ -137,60 +437,151 @@ bool fetchDate(
       "%s?date=%s&market=DayAhead&indexNames=%s&currency=%s&resolutionInMinutes=%u",
       apiBaseUrl,
       date,
-      area,
+      indexNames,
       currency,
       (unsigned)normalizedResolution);
 
-  http.useHTTP10(true);
-  http.setReuse(false);
-  if (!http.begin(client, url)) {
-    out.error = "HTTP begin failed";
-    return false;
+  HTTPClient &http = session.http;
+  // Servers drop idle keep-alive sockets; start over instead of writing into
+  // a half-closed connection.
+  if (session.client.connected() && millis() - session.lastUseMs > kKeepAliveIdleMs) {
+    session.client.stop();
   }
-  http.addHeader("Accept-Encoding", "identity");
 
-  const int status = http.GET();
-  logf("Nord Pool GET %s status=%d", date, status);
+  int status = 0;
+  bool reused = false;
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    reused = session.client.connected();
+    // On failure GET() connects by itself and reports the error.
+    if (!reused) (void)connectFetchSession(session, url);
+    if (!http.begin(session.client, url)) {
+      copyStateText(out.error, "HTTP begin failed");
+      return false;
+    }
+    http.addHeader("Accept-Encoding", "identity");
+    {
+      const PerfScope span(PerfSpan::FetchFirstByte);
+      status = http.GET();
+    }
+    if (status > 0 || !reused) break;
+
+    // The server closed the kept-alive connection; retry once on a fresh one.
+    LOG_WARN(Net, "Nord Pool GET %s on reused connection failed (%d), reconnecting", date, status);
+    closeFetchSession(session);
+  }
+  session.lastUseMs = millis();
+  if (reused) {
+    ++session.reuses;
+  } else {
+    ++session.connects;
+  }
+  LOG_DEBUG(
+      Net,
+      "Nord Pool GET %s status=%d conn=%s (connects=%u reuses=%u)",
+      date,
+      status,
+      reused ? "reused" : "new",
+      (unsigned)session.connects,
+      (unsigned)session.reuses);
   if (status == 204) {
     http.end();
     return true;
   }
   if (status != 200) {
-    out.error = status <= 0 ? "HTTP GET failed" : ("HTTP " + String(status));
-    http.end();
+    if (status <= 0) {
+      copyStateText(out.error, "HTTP GET failed");
+      closeFetchSession(session);
+    } else {
+      snprintf(out.error, sizeof(out.error), "HTTP %d", status);
+      http.end();
+    }
     return false;
   }
 
-  JsonDocument filter;
-  filter["title"] = true;
-  filter["currency"] = true;
-  JsonArray entriesFilter = filter["multiIndexEntries"].to<JsonArray>();
-  JsonObject entryFilter = entriesFilter.add<JsonObject>();
-  entryFilter["deliveryStart"] = true;
-  entryFilter["entryPerArea"][area] = true;
-  JsonDocument doc;
-  const DeserializationError err =
-      deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
-  http.end();
-  if (err) {
-    out.error = (err == DeserializationError::EmptyInput) ? "Empty response body" : "JSON parse failed";
-    logf("Nord Pool JSON parse error: %s", err.c_str());
+  PointSink sink;
+  sink.state = &out;
+  sink.formula = formula;
+  NordPoolStreamParser parser;
+  nordPoolParserBegin(parser, areaNames, (size_t)out.extraAreaCount + 1, addPoint, &sink);
+
+  const uint32_t parseStartMs = millis();
+  const uint32_t bodyStartUs = micros();
+  uint32_t parserUs = 0;
+  const bool bodyComplete = parseResponseStream(http, parser, parserUs);
+  const NordPoolParseStatus parseStatus = parser.status;
+  const uint32_t parseMs = millis() - parseStartMs;
+  const uint32_t bodyUs = micros() - bodyStartUs;
+  perfRecord(PerfSpan::FetchParse, parserUs);
+  perfRecord(PerfSpan::FetchBodyRead, bodyUs > parserUs ? bodyUs - parserUs : 0);
+  if (bodyComplete) {
+    http.end();
+  } else {
+    closeFetchSession(session);
+  }
+  session.lastUseMs = millis();
+  LOG_DEBUG(
+      Net,
+      "Nord Pool parse %s: bytes=%u entries=%u in %lu ms (%lu B/s)",
+      date,
+      (unsigned)parser.bytesFed,
+      (unsigned)parser.entries,
+      (unsigned long)parseMs,
+      (unsigned long)(parseMs > 0 ? ((uint64_t)parser.bytesFed * 1000) / parseMs : parser.bytesFed));
+
+  if (parseStatus != NordPoolParseStatus::Done) {
+    copyStateText(out.error, parser.bytesFed == 0 ? "Empty response body" : "JSON parse failed");
+    LOG_WARN(Net, "Nord Pool JSON parse error: status=%u", (unsigned)parseStatus);
     return false;
   }
 
-  if (!doc["title"].isNull() && String((const char *)(doc["title"] | "")) == "Unauthorized") {
-    out.error = "Nord Pool API unauthorized";
+  if (parser.unauthorized) {
+    copyStateText(out.error, "Nord Pool API unauthorized");
     return false;
   }
 
-  if (!doc["currency"].isNull()) {
-    out.currency = String((const char *)(doc["currency"] | currency));
+  if (parser.currency[0] != '\0') {
+    copyStateText(out.currency, parser.currency);
   }
-
-  addPoints(doc["multiIndexEntries"], area, vatPercent, fixedCostMinorPerKwh, out);
   return true;
 }
 
+bool canReuseExistingPoints(const PriceState *existing, const PriceState &out, const char *currency) {
+  if (existing == nullptr || !existing->ok || existing->count == 0) return false;
+  if (!stateTextEquals(existing->source, "NORDPOOL") && !stateTextEquals(existing->source, "no wifi")) return false;
+  if (!sameAreaList(*existing, out) || !stateTextEquals(existing->currency, currency)) return false;
+  return normalizeResolutionMinutes(existing->resolutionMinutes) == out.resolutionMinutes;
+}
+
+// Appends existing points in [rangeStart, rangeEnd), re-applying the current
+// formula. `existing` has the same area list as `out`.
+void copyPointsInRange(
+    const PriceState &existing,
+    time_t rangeStart,
+    time_t rangeEnd,
+    const PriceFormula &formula,
+    PriceState &out) {
+  for (size_t i = 0; i < existing.count && out.count < kMaxPoints; ++i) {
+    const PricePoint &point = existing.points[i];
+    if ((time_t)point.startsAt < rangeStart || (time_t)point.startsAt >= rangeEnd || !point.hasRawPrice) continue;
+
+    PricePoint &copy = out.points[out.count];
+    copy = point;
+    copy.price = applyPriceFormula(formula, point.rawPrice);
+    copy.level = PriceLevel::Unknown;
+    for (uint8_t a = 0; a < out.extraAreaCount; ++a) {
+      out.extraAreas[a].rawPrices[out.count] = existing.extraAreas[a].rawPrices[i];
+    }
+    ++out.count;
+  }
+}
+
+void clearCurrent(PriceState &out) {
+  out.currentIndex = -1;
+  out.currentStartsAt = 0;
+  out.currentPrice = 0;
+  out.currentLevel = PriceLevel::Unknown;
+}
+
 void assignCurrentFromClock(PriceState &out) {
   out.currentIndex = findCurrentPricePointIndex(out, out.resolutionMinutes);
   if (out.currentIndex < 0) return;
@@ -205,49 +596,131 @@ void assignCurrentLevel(PriceState &out) {
   out.currentLevel = out.points[out.currentIndex].level;
 }
 
-uint16_t applyMovingAverageToState(PriceState &state, float vatPercent, float fixedCostPerKwh) {
+// Current slot from the clock, falling back to the first point. Before the
+// clock is valid there is no current slot at all.
+void assignCurrentOrFirst(PriceState &out) {
+  if (out.count == 0) return;
+  assignCurrentFromClock(out);
+  if (out.currentIndex < 0 && !isValidClock(clockNow(), kValidEpochMin)) {
+    clearCurrent(out);
+    return;
+  }
+  if (out.currentIndex < 0) {
+    out.currentIndex = 0;
+    out.currentStartsAt = out.points[0].startsAt;
+    out.currentPrice = out.points[0].price;
+  }
+  assignCurrentLevel(out);
+}
+
+int32_t roundedMean(int64_t sum, size_t count) {
+  const int64_t half = (int64_t)count / 2;
+  return (int32_t)((sum >= 0 ? sum + half : sum - half) / (int64_t)count);
+}
+
+// Replaces the points with an extra area's prices; slots it has no price
+// for are left out. Compacts in place.
+void selectAreaPoints(PriceState &state, const AreaSeries &series, const PriceFormula &formula) {
+  size_t kept = 0;
+  for (size_t i = 0; i < state.count; ++i) {
+    const int32_t rawPrice = series.rawPrices[i];
+    if (rawPrice == kNoAreaPrice) continue;
+
+    PricePoint &point = state.points[kept++];
+    point.startsAt = state.points[i].startsAt;
+    point.rawPrice = rawPrice;
+    point.price = applyPriceFormula(formula, rawPrice);
+    point.hasRawPrice = true;
+    point.level = PriceLevel::Unknown;
+  }
+  state.count = kept;
+  copyStateText(state.area, series.area);
+}
+
+// Replaces the points with the mean of each `resolutionMinutes` slot, in
+// place. Points are in time order, so each slot is one run of points and
+// is written no later than its first point.
+void aggregatePoints(PriceState &state, uint16_t resolutionMinutes) {
+  const size_t fineCount = state.count;
+  state.resolutionMinutes = resolutionMinutes;
+  state.count = 0;
+  size_t i = 0;
+  while (i < fineCount) {
+    const time_t slotStart = intervalStartForTime((time_t)state.points[i].startsAt, resolutionMinutes);
+    int64_t priceSum = 0;
+    int64_t rawSum = 0;
+    size_t n = 0;
+    bool allRaw = true;
+    for (; i < fineCount && intervalStartForTime((time_t)state.points[i].startsAt, resolutionMinutes) == slotStart;
+         ++i) {
+      const PricePoint &point = state.points[i];
+      priceSum += point.price;
+      rawSum += point.rawPrice;
+      allRaw = allRaw && point.hasRawPrice;
+      ++n;
+    }
+
+    PricePoint &slot = state.points[state.count++];
+    slot.startsAt = (uint32_t)slotStart;
+    slot.price = roundedMean(priceSum, n);
+    slot.rawPrice = allRaw ? roundedMean(rawSum, n) : 0;
+    slot.hasRawPrice = allRaw;
+    slot.level = PriceLevel::Unknown;
+  }
+}
+
+uint16_t applyMovingAverageToState(PriceState &state, const PriceFormula &formula) {
   if (state.count == 0) return 0;
+  const PerfScope span(PerfSpan::MovingAverage);
 
   state.resolutionMinutes = normalizeResolutionMinutes(state.resolutionMinutes);
-  const uint16_t targetWindow = movingAverageWindowForResolution(state.resolutionMinutes);
-
-  MovingAverageStore store;
+  const uint16_t targetWindow = movingAverageWindowForResolution(kNordPoolFetchResolutionMinutes);
+  // Only the fetch resolution feeds the store. A coarser series (a cache
+  // from older firmware) just reads the average, so it never resets it.
+  const bool feedsStore = state.resolutionMinutes == kNordPoolFetchResolutionMinutes;
+
+  static MovingAverageStore store;
+  static MovingAverageSample addedSamples[kMaxPoints];
+  bool needsSnapshot = false;
   if (!loadMovingAverageStore(store)) {
     resetMovingAverageStore(store);
+    needsSnapshot = true;
   }
   store.resolutionMinutes = normalizeResolutionMinutes(store.resolutionMinutes);
-  if (store.resolutionMinutes != state.resolutionMinutes || store.windowSamples != targetWindow) {
+  if (feedsStore && (store.resolutionMinutes != state.resolutionMinutes || store.windowSamples != targetWindow)) {
     resetMovingAverageStore(store);
     store.resolutionMinutes = state.resolutionMinutes;
     store.windowSamples = targetWindow;
+    needsSnapshot = true;
   }
 
-  const bool historyChanged = updateHistoryFromPoints(state, store);
-  if (historyChanged && !saveMovingAverageStore(store)) {
-    logf("Nord Pool moving average save failed");
+  const size_t addedCount = feedsStore ? updateHistoryFromPoints(state, store, addedSamples) : 0;
+  if (needsSnapshot && addedCount > 0) {
+    if (!saveMovingAverageStore(store)) {
+      LOG_WARN(Storage, "Nord Pool moving average save failed");
+    }
+  } else if (addedCount > 0 && !appendMovingAverageSamples(store, addedSamples, addedCount)) {
+    LOG_WARN(Storage, "Nord Pool moving average append failed");
   }
 
-  float movingAvgRawPerKwh =
-      store.count == 0 ? kDefaultMovingAveragePerKwh : movingAverageValue(store);
-  if (movingAvgRawPerKwh <= 0.0001f) movingAvgRawPerKwh = kDefaultMovingAveragePerKwh;
+  int32_t movingAvgRaw = store.count == 0 ? kDefaultMovingAverage : movingAverageValue(store);
+  if (movingAvgRaw <= 0) movingAvgRaw = kDefaultMovingAverage;
 
-  float movingAvgPerKwh = applyCustomPriceFormula(movingAvgRawPerKwh, vatPercent, fixedCostPerKwh);
-  if (movingAvgPerKwh <= 0.0001f) {
-    movingAvgPerKwh = applyCustomPriceFormula(kDefaultMovingAveragePerKwh, vatPercent, fixedCostPerKwh);
-  }
-  if (movingAvgPerKwh <= 0.0001f) movingAvgPerKwh = kDefaultMovingAveragePerKwh;
+  int32_t movingAvg = applyPriceFormula(formula, movingAvgRaw);
+  if (movingAvg <= 0) movingAvg = applyPriceFormula(formula, kDefaultMovingAverage);
+  if (movingAvg <= 0) movingAvg = kDefaultMovingAverage;
+
+  (void)priceHistoryRecord(state);
+  refreshRawThresholds();
+  LevelThresholds thresholds;
+  const bool fromHistory = loadLevelThresholds(formula, thresholds);
 
   state.hasRunningAverage = true;
-  state.runningAverage = movingAvgPerKwh;
-  applyLevelsFromMovingAverage(state, movingAvgPerKwh);
+  state.runningAverage = movingAvg;
+  applyLevelsFromMovingAverage(state, movingAvg, fromHistory ? &thresholds : nullptr);
+  state.fingerprint = priceStateFingerprint(state);
 
-  assignCurrentFromClock(state);
-  if (state.currentIndex < 0) {
-    state.currentIndex = 0;
-    state.currentStartsAt = state.points[0].startsAt;
-    state.currentPrice = state.points[0].price;
-  }
-  assignCurrentLevel(state);
+  assignCurrentOrFirst(state);
   return store.count;
 }
 }  // namespace
@@ -255,162 +728,189 @@ uint16_t applyMovingAverageToState(PriceState &state, float vatPercent, float fi
 void fetchNordPoolPriceInfo(
     const char *apiBaseUrl,
     const char *area,
+    const char *extraAreas,
     const char *currency,
-    uint16_t resolutionMinutes,
-    float vatPercent,
-    float fixedCostPerKwh,
+    const PriceFormula &formula,
+    const PriceState *existing,
     PriceState &out) {
+  if (existing == &out) existing = nullptr;
   out.ok = false;
-  out.error = "";
-  out.source = "NORDPOOL";
+  copyStateText(out.error, "");
+  copyStateText(out.source, "NORDPOOL");
+  copyStateText(out.area, area);
+  assignExtraAreas(out, extraAreas);
   out.hasRunningAverage = false;
-  out.runningAverage = 0.0f;
-  out.currency = "SEK";
-  out.resolutionMinutes = normalizeResolutionMinutes(resolutionMinutes);
-  out.currentStartsAt = "";
-  out.currentLevel = "UNKNOWN";
-  out.currentPrice = 0.0f;
+  out.runningAverage = 0;
+  copyStateText(out.currency, "SEK");
+  out.resolutionMinutes = kNordPoolFetchResolutionMinutes;
+  out.slotBaseStartsAt = 0;
+  out.slotsUniform = false;
+  out.currentStartsAt = 0;
+  out.currentLevel = PriceLevel::Unknown;
+  out.currentPrice = 0;
   out.currentIndex = -1;
+  out.fingerprint = 0;
   out.count = 0;
-  logf("Nord Pool fetch start: resolution=%u free_heap=%u", (unsigned)out.resolutionMinutes, ESP.getFreeHeap());
+  LOG_INFO(
+      Net,
+      "Nord Pool fetch start: resolution=%u areas=%u free_heap=%u",
+      (unsigned)out.resolutionMinutes,
+      (unsigned)out.extraAreaCount + 1,
+      ESP.getFreeHeap());
 
-  const float normalizedVatPercent = normalizeVatPercent(vatPercent);
-  const float normalizedFixedCostPerKwh = normalizeFixedCostPerKwh(fixedCostPerKwh);
-  logf(
-      "Nord Pool formula: vat=%.2f%% fixed_minor_kwh=%.2f",
-      normalizedVatPercent,
-      normalizedFixedCostPerKwh);
+  LOG_DEBUG(
+      Net,
+      "Nord Pool formula: vat_multiplier=%ld offset=%ld (1/%ld)",
+      (long)formula.vatMultiplier,
+      (long)formula.offset,
+      (long)kPriceFixedPerMajor);
 
   if (WiFi.status() != WL_CONNECTED) {
-    out.error = "WiFi not connected";
+    copyStateText(out.error, "WiFi not connected");
     return;
   }
 
-  const time_t now = time(nullptr);
+  const time_t now = clockNow();
   if (now < kValidEpochMin) {
-    out.error = "Clock not synced";
+    copyStateText(out.error, "Clock not synced");
     return;
   }
 
+  const time_t todayStart = localDayStart(now, 0);
+  const time_t tomorrowStart = localDayStart(now, 1);
+  const time_t dayAfterStart = localDayStart(now, 2);
   char today[16];
   char tomorrow[16];
-  if (!formatDateYmd(now, today, sizeof(today))) {
-    out.error = "Date format failed";
+  if (todayStart <= 0 || tomorrowStart <= 0 || dayAfterStart <= 0 ||
+      !formatDateYmd(todayStart, today, sizeof(today)) ||
+      !formatDateYmd(tomorrowStart, tomorrow, sizeof(tomorrow))) {
+    copyStateText(out.error, "Date format failed");
     return;
   }
 
-  struct tm tmTomorrow;
-  if (!localtime_r(&now, &tmTomorrow)) {
-    out.error = "Date format failed";
-    return;
-  }
-  tmTomorrow.tm_mday += 1;
-  tmTomorrow.tm_hour = 0;
-  tmTomorrow.tm_min = 0;
-  tmTomorrow.tm_sec = 0;
-  const time_t tomorrowTs = mktime(&tmTomorrow);
-  if (tomorrowTs == (time_t)-1 || !formatDateYmd(tomorrowTs, tomorrow, sizeof(tomorrow))) {
-    out.error = "Date format failed";
-    return;
-  }
+  // Published day-ahead prices never change, so only days the existing state
+  // doesn't fully cover are requested. An unpublished day costs one 204.
+  const bool canReuse = canReuseExistingPoints(existing, out, currency);
+  const bool reuseToday = canReuse && stateCoversRange(*existing, todayStart, tomorrowStart);
+  const bool reuseTomorrow = canReuse && stateCoversRange(*existing, tomorrowStart, dayAfterStart);
 
-  WiFiClientSecure client;
-  client.setInsecure();
-
-  HTTPClient http;
-  http.setConnectTimeout(kHttpTimeoutMs);
-  http.setTimeout(kHttpTimeoutMs);
+  FetchSession &session = fetchSession();
 
-  if (!fetchDate(
-          http,
-          client,
+  if (reuseToday) {
+    copyPointsInRange(*existing, todayStart, tomorrowStart, formula, out);
+    copyStateText(out.currency, existing->currency);
+    LOG_DEBUG(Net, "Nord Pool %s already covered: reused points=%u", today, (unsigned)out.count);
+  } else if (!fetchDate(
+          session,
           apiBaseUrl,
           today,
-          area,
           currency,
           out.resolutionMinutes,
-          normalizedVatPercent,
-          normalizedFixedCostPerKwh,
+          formula,
           out)) {
     return;
   }
 
-  // Tomorrow can be unavailable earlier in the day; keep today's prices if present.
-  if (!fetchDate(
-          http,
-          client,
+  if (reuseTomorrow) {
+    const size_t before = out.count;
+    copyPointsInRange(*existing, tomorrowStart, dayAfterStart, formula, out);
+    LOG_DEBUG(Net, "Nord Pool %s already covered: reused points=%u", tomorrow, (unsigned)(out.count - before));
+  } else if (!fetchDate(
+          session,
           apiBaseUrl,
           tomorrow,
-          area,
           currency,
           out.resolutionMinutes,
-          normalizedVatPercent,
-          normalizedFixedCostPerKwh,
+          formula,
           out)) {
-    logf("Nord Pool tomorrow fetch failed: %s", out.error.c_str());
+    // Tomorrow can be unavailable earlier in the day; keep today's prices if present.
+    LOG_WARN(Net, "Nord Pool tomorrow fetch failed: %s", out.error);
     if (out.count == 0) {
       return;
     }
-    out.error = "";
+    copyStateText(out.error, "");
   }
 
   if (out.count == 0) {
-    out.error = "No prices";
+    copyStateText(out.error, "No prices");
     return;
   }
+  updatePriceStateSlotIndex(out);
 
-  const uint16_t sampleCount = applyMovingAverageToState(out, normalizedVatPercent, normalizedFixedCostPerKwh);
+  const uint16_t sampleCount = applyMovingAverageToState(out, formula);
 
   out.ok = true;
-  logf(
-      "Nord Pool OK: points=%u res=%u current=%.3f %s level=%s ma=%.3f samples=%u",
+  LOG_INFO(
+      Net,
+      "Nord Pool OK: points=%u res=%u current=%.4f %s level=%s ma=%.4f samples=%u",
       (unsigned)out.count,
       (unsigned)out.resolutionMinutes,
-      out.currentPrice,
-      out.currency.c_str(),
-      out.currentLevel.c_str(),
-      out.runningAverage,
+      priceFixedToMajor(out.currentPrice),
+      out.currency,
+      priceLevelName(out.currentLevel),
+      priceFixedToMajor(out.runningAverage),
       (unsigned)sampleCount
   );
 }
 
-void nordPoolPreupdateMovingAverageFromPriceInfo(PriceState &state, float vatPercent, float fixedCostPerKwh) {
-  if (state.source != "NORDPOOL" && state.source != "no wifi") return;
+void nordPoolPreupdateMovingAverageFromPriceInfo(PriceState &state, const PriceFormula &formula) {
+  if (!stateTextEquals(state.source, "NORDPOOL") && !stateTextEquals(state.source, "no wifi")) return;
   if (!state.ok || state.count == 0) return;
 
-  const float normalizedVatPercent = normalizeVatPercent(vatPercent);
-  const float normalizedFixedCostPerKwh = normalizeFixedCostPerKwh(fixedCostPerKwh);
-  (void)applyMovingAverageToState(state, normalizedVatPercent, normalizedFixedCostPerKwh);
+  (void)applyMovingAverageToState(state, formula);
 }
 
-bool nordPoolRecalculatePricesFromRaw(PriceState &state, float vatPercent, float fixedCostPerKwh) {
+bool nordPoolRecalculatePricesFromRaw(PriceState &state, const PriceFormula &formula) {
   if (state.count == 0) return false;
 
-  const float normalizedVatPercent = normalizeVatPercent(vatPercent);
-  const float normalizedFixedCostPerKwh = normalizeFixedCostPerKwh(fixedCostPerKwh);
-
   for (size_t i = 0; i < state.count; ++i) {
     if (!state.points[i].hasRawPrice) {
-      logf("Nord Pool cache recalc skipped: missing raw price at idx=%u", (unsigned)i);
+      LOG_WARN(Net, "Nord Pool cache recalc skipped: missing raw price at idx=%u", (unsigned)i);
       return false;
     }
   }
 
   for (size_t i = 0; i < state.count; ++i) {
     PricePoint &point = state.points[i];
-    point.price = applyCustomPriceFormula(point.rawPricePerKwh, normalizedVatPercent, normalizedFixedCostPerKwh);
+    point.price = applyPriceFormula(formula, point.rawPrice);
   }
 
   if (state.ok) {
-    (void)applyMovingAverageToState(state, normalizedVatPercent, normalizedFixedCostPerKwh);
+    (void)applyMovingAverageToState(state, formula);
   } else {
-    assignCurrentFromClock(state);
-    if (state.currentIndex < 0) {
-      state.currentIndex = 0;
-      state.currentStartsAt = state.points[0].startsAt;
-      state.currentPrice = state.points[0].price;
-    }
-    assignCurrentLevel(state);
+    state.fingerprint = priceStateFingerprint(state);
+    assignCurrentOrFirst(state);
   }
   return true;
 }
+
+void nordPoolBuildView(
+    const PriceState &prices,
+    uint8_t areaIndex,
+    uint16_t resolutionMinutes,
+    const PriceFormula &formula,
+    PriceState &view) {
+  view = prices;
+  bool rebuilt = false;
+  if (areaIndex > 0 && areaIndex <= prices.extraAreaCount) {
+    selectAreaPoints(view, prices.extraAreas[areaIndex - 1], formula);
+    rebuilt = true;
+  }
+  const uint16_t fineResolution = normalizeResolutionMinutes(prices.resolutionMinutes);
+  const uint16_t viewResolution = normalizeResolutionMinutes(resolutionMinutes);
+  if (viewResolution > fineResolution && viewResolution % fineResolution == 0) {
+    aggregatePoints(view, viewResolution);
+    rebuilt = true;
+  }
+
+  if (rebuilt) {
+    if (prices.hasRunningAverage) {
+      LevelThresholds thresholds;
+      const bool fromHistory = loadLevelThresholds(formula, thresholds);
+      applyLevelsFromMovingAverage(view, prices.runningAverage, fromHistory ? &thresholds : nullptr);
+    }
+    updatePriceStateSlotIndex(view);
+    view.fingerprint = priceStateFingerprint(view);
+  }
+  assignCurrentOrFirst(view);
+}
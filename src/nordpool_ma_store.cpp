@@ -1,25 +1,66 @@
 #include "nordpool_ma_store.h"
 
-#include <FS.h>
-#include <SPIFFS.h>
-
+#include "flash_storage.h"
 #include "logging_utils.h"
 
 namespace {
 constexpr char kMovingAveragePath[] = "/nordpool_ma.bin";
+constexpr char kMovingAverageLogPath[] = "/nordpool_ma.log";
+constexpr uint32_t kMovingAverageLogMagic = 0x4E504D4C;  // "NPML"
+constexpr uint16_t kMovingAverageLogVersion = 2;
+constexpr size_t kMovingAverageLogMaxRecords = kMaxMovingAverageWindowSamples;
+
+// The log only applies on top of the snapshot it was started from:
+// baseSlotStart must match the snapshot's lastSlotStart.
+struct MovingAverageLogHeader {
+  uint32_t magic = kMovingAverageLogMagic;
+  uint16_t version = kMovingAverageLogVersion;
+  uint16_t resolutionMinutes = 0;
+  uint16_t windowSamples = 0;
+  uint16_t reserved = 0;
+  uint32_t baseSlotStart = 0;
+};
+
+void recomputeMovingAverageSum(MovingAverageStore &store) {
+  store.sum = 0;
+  for (size_t i = 0; i < store.count; ++i) {
+    store.sum += store.values[i];
+  }
+}
 
-bool ensureSpiffsMounted() {
-  static bool attempted = false;
-  static bool mounted = false;
-  if (!attempted) {
-    attempted = true;
-    mounted = SPIFFS.begin(true);
-    logf("SPIFFS mount: %s", mounted ? "ok" : "failed");
-    if (mounted) {
-      logf("SPIFFS info: used=%u total=%u", (unsigned)SPIFFS.usedBytes(), (unsigned)SPIFFS.totalBytes());
-    }
+MovingAverageLogHeader logHeaderForStore(const MovingAverageStore &store) {
+  MovingAverageLogHeader header;
+  header.resolutionMinutes = store.resolutionMinutes;
+  header.windowSamples = store.windowSamples;
+  header.baseSlotStart = store.lastSlotStart;
+  return header;
+}
+
+void replayMovingAverageLog(MovingAverageStore &store) {
+  File file = storageOpen(kMovingAverageLogPath, FILE_READ);
+  if (!file) return;
+
+  MovingAverageLogHeader header;
+  const MovingAverageLogHeader expected = logHeaderForStore(store);
+  if (storageRead(file, &header, sizeof(header)) != sizeof(header) || header.magic != expected.magic ||
+      header.version != expected.version || header.resolutionMinutes != expected.resolutionMinutes ||
+      header.windowSamples != expected.windowSamples || header.baseSlotStart != expected.baseSlotStart) {
+    file.close();
+    LOG_WARN(Storage, "Nord Pool moving average log ignored: stale or invalid header");
+    return;
+  }
+
+  size_t replayed = 0;
+  MovingAverageSample sample;
+  while (storageRead(file, &sample, sizeof(sample)) == sizeof(sample)) {
+    if (sample.slotStart <= store.lastSlotStart) continue;
+    addMovingAverageSample(store, sample.slotStart, sample.value);
+    ++replayed;
+  }
+  file.close();
+  if (replayed > 0) {
+    LOG_INFO(Storage, "Nord Pool moving average log replayed: samples=%u", (unsigned)replayed);
   }
-  return mounted;
 }
 }  // namespace
 
@@ -28,9 +69,9 @@ void resetMovingAverageStore(MovingAverageStore &store) {
 }
 
 bool loadMovingAverageStore(MovingAverageStore &store) {
-  if (!ensureSpiffsMounted()) return false;
+  if (!storageMount()) return false;
 
-  File file = SPIFFS.open(kMovingAveragePath, FILE_READ);
+  File file = storageOpen(kMovingAveragePath, FILE_READ);
   if (!file) return false;
 
   if ((size_t)file.size() != sizeof(MovingAverageStore)) {
@@ -38,55 +79,89 @@ bool loadMovingAverageStore(MovingAverageStore &store) {
     return false;
   }
 
-  const size_t readBytes = file.read((uint8_t *)&store, sizeof(MovingAverageStore));
+  const size_t readBytes = storageRead(file, &store, sizeof(MovingAverageStore));
   file.close();
   if (readBytes != sizeof(MovingAverageStore)) return false;
   if (store.magic != kMovingAverageStoreMagic || store.version != kMovingAverageStoreVersion) return false;
   if (store.windowSamples == 0 || store.windowSamples > kMaxMovingAverageWindowSamples) return false;
   if (store.head >= store.windowSamples) return false;
   if (store.count > store.windowSamples) return false;
+
+  recomputeMovingAverageSum(store);
+  replayMovingAverageLog(store);
   return true;
 }
 
 bool saveMovingAverageStore(const MovingAverageStore &store) {
-  if (!ensureSpiffsMounted()) return false;
+  if (!storageMount()) return false;
+
+  StorageChunk snapshot;
+  snapshot.data = &store;
+  snapshot.len = sizeof(MovingAverageStore);
+  if (!storageWriteAtomic(kMovingAveragePath, &snapshot, 1)) return false;
+
+  // Start a fresh log bound to this snapshot. A stale log left behind by a
+  // failed write is rejected on load because its baseSlotStart won't match.
+  const MovingAverageLogHeader header = logHeaderForStore(store);
+  StorageChunk logHeader;
+  logHeader.data = &header;
+  logHeader.len = sizeof(header);
+  return storageWriteAtomic(kMovingAverageLogPath, &logHeader, 1);
+}
 
-  File file = SPIFFS.open(kMovingAveragePath, FILE_WRITE);
-  if (!file) return false;
+bool appendMovingAverageSamples(const MovingAverageStore &store, const MovingAverageSample *samples, size_t count) {
+  if (count == 0) return true;
+  if (!storageMount()) return false;
 
-  const size_t written = file.write((const uint8_t *)&store, sizeof(MovingAverageStore));
-  file.flush();
-  file.close();
-  return written == sizeof(MovingAverageStore);
+  size_t logRecords = kMovingAverageLogMaxRecords;
+  if (storageExists(kMovingAverageLogPath)) {
+    const size_t logBytes = storageFileSize(kMovingAverageLogPath);
+    if (logBytes >= sizeof(MovingAverageLogHeader)) {
+      logRecords = (logBytes - sizeof(MovingAverageLogHeader)) / sizeof(MovingAverageSample);
+    }
+  }
+
+  if (logRecords + count > kMovingAverageLogMaxRecords) {
+    LOG_DEBUG(Storage, "Nord Pool moving average log compaction: records=%u", (unsigned)(logRecords + count));
+    return saveMovingAverageStore(store);
+  }
+
+  return storageAppend(kMovingAverageLogPath, samples, count * sizeof(MovingAverageSample));
 }
 
 bool clearMovingAverageStore() {
-  if (!ensureSpiffsMounted()) return false;
-  if (!SPIFFS.exists(kMovingAveragePath)) return true;
-  if (!SPIFFS.remove(kMovingAveragePath)) {
-    logf("Nord Pool moving average clear failed");
+  if (!storageMount()) return false;
+  if (!storageRemove(kMovingAverageLogPath)) {
+    LOG_WARN(Storage, "Nord Pool moving average log clear failed");
+    return false;
+  }
+  if (!storageExists(kMovingAveragePath)) return true;
+  if (!storageRemove(kMovingAveragePath)) {
+    LOG_WARN(Storage, "Nord Pool moving average clear failed");
     return false;
   }
-  logf("Nord Pool moving average cleared");
+  LOG_INFO(Storage, "Nord Pool moving average cleared");
   return true;
 }
 
-void addMovingAverageSample(MovingAverageStore &store, float value) {
+void addMovingAverageSample(MovingAverageStore &store, uint32_t slotStart, int32_t value) {
   if (store.windowSamples == 0 || store.windowSamples > kMaxMovingAverageWindowSamples) {
     store.windowSamples = kMovingAverageWindowHours;
   }
 
+  if (store.count >= store.windowSamples) {
+    store.sum -= store.values[store.head];
+  }
   store.values[store.head] = value;
+  store.sum += value;
   store.head = (store.head + 1) % store.windowSamples;
   if (store.count < store.windowSamples) ++store.count;
+  store.lastSlotStart = slotStart;
 }
 
-float movingAverageValue(const MovingAverageStore &store) {
-  if (store.count == 0) return 0.0f;
-
-  float sum = 0.0f;
-  for (size_t i = 0; i < store.count; ++i) {
-    sum += store.values[i];
-  }
-  return sum / (float)store.count;
+int32_t movingAverageValue(const MovingAverageStore &store) {
+  if (store.count == 0) return 0;
+  const int64_t half = store.count / 2;
+  const int64_t sum = store.sum >= 0 ? store.sum + half : store.sum - half;
+  return (int32_t)(sum / store.count);
 }
@@ -0,0 +1,252 @@
+#include "nordpool_parser.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+constexpr char kEntriesKey[] = "multiIndexEntries";
+constexpr char kDeliveryStartKey[] = "deliveryStart";
+constexpr char kEntryPerAreaKey[] = "entryPerArea";
+
+bool isWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isScalarChar(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E' ||
+         (c >= 'a' && c <= 'z');
+}
+
+void appendToken(NordPoolStreamParser &parser, char c) {
+  // Longer tokens are truncated; none of the values we extract come close.
+  if ((size_t)parser.tokenLen + 1 < kNordPoolParserTokenLen) {
+    parser.token[parser.tokenLen++] = c;
+    parser.token[parser.tokenLen] = '\0';
+  }
+}
+
+// Parses a decimal currency/MWh value straight into tenths of a unit per MWh,
+// which is the fixed-point price per kWh. Digits past the first decimal are
+// rounded half away from zero; exponent forms fall back to strtod.
+bool parsePricePerMwhFixed(const char *text, int32_t &out) {
+  const char *c = text;
+  const bool negative = *c == '-';
+  if (*c == '-' || *c == '+') ++c;
+  int64_t tenths = 0;
+  bool digits = false;
+  while (*c >= '0' && *c <= '9') {
+    tenths = tenths * 10 + (*c++ - '0');
+    if (tenths > INT32_MAX) return false;
+    digits = true;
+  }
+  tenths *= 10;
+  if (*c == '.') {
+    ++c;
+    if (*c >= '0' && *c <= '9') {
+      tenths += *c++ - '0';
+      digits = true;
+    }
+    if (*c >= '5' && *c <= '9') ++tenths;
+    while (*c >= '0' && *c <= '9') ++c;
+  }
+  if (!digits) return false;
+  if (*c == 'e' || *c == 'E') {
+    char *end = nullptr;
+    const double value = strtod(text, &end) * 10.0;
+    if (end == text || !(fabs(value) < 2147483647.0)) return false;
+    out = (int32_t)llround(value);
+    return true;
+  }
+  if (*c != '\0' || tenths > INT32_MAX) return false;
+  out = (int32_t)(negative ? -tenths : tenths);
+  return true;
+}
+
+void resetToken(NordPoolStreamParser &parser) {
+  parser.tokenLen = 0;
+  parser.token[0] = '\0';
+}
+
+const char *parentKey(const NordPoolStreamParser &parser, uint8_t level) {
+  return level == 0 ? "" : parser.keys[level - 1];
+}
+
+bool inEntryObject(const NordPoolStreamParser &parser) {
+  return parser.entriesDepthSet && parser.depth == parser.entriesDepth + 1 &&
+         parser.containers[parser.depth - 1] == '{';
+}
+
+bool inAreaObject(const NordPoolStreamParser &parser) {
+  return parser.entriesDepthSet && parser.depth == parser.entriesDepth + 2 &&
+         parser.containers[parser.depth - 1] == '{' &&
+         strcmp(parentKey(parser, parser.depth - 1), kEntryPerAreaKey) == 0;
+}
+
+void handleStringValue(NordPoolStreamParser &parser) {
+  const char *key = parser.keys[parser.depth - 1];
+  if (parser.depth == 1) {
+    if (strcmp(key, "title") == 0 && strcmp(parser.token, "Unauthorized") == 0) {
+      parser.unauthorized = true;
+    } else if (strcmp(key, "currency") == 0) {
+      strncpy(parser.currency, parser.token, sizeof(parser.currency) - 1);
+      parser.currency[sizeof(parser.currency) - 1] = '\0';
+    }
+    return;
+  }
+  if (inEntryObject(parser) && strcmp(key, kDeliveryStartKey) == 0) {
+    memcpy(parser.deliveryStart, parser.token, sizeof(parser.deliveryStart));
+  }
+}
+
+void handleScalarValue(NordPoolStreamParser &parser) {
+  if (!inAreaObject(parser)) return;
+  const char *key = parser.keys[parser.depth - 1];
+  for (uint8_t i = 0; i < parser.areaCount; ++i) {
+    if (parser.areas[i] == nullptr || strcmp(key, parser.areas[i]) != 0) continue;
+
+    int32_t value = 0;
+    if (!parsePricePerMwhFixed(parser.token, value)) return;  // null or non-numeric
+    parser.prices[i] = value;
+    parser.priceMask |= (uint8_t)(1u << i);
+    return;
+  }
+}
+
+void finishString(NordPoolStreamParser &parser) {
+  parser.inString = false;
+  if (parser.depth == 0) return;
+
+  const uint8_t top = parser.depth - 1;
+  if (parser.containers[top] == '{' && parser.expectKey[top]) {
+    memcpy(parser.keys[top], parser.token, sizeof(parser.keys[top]));
+    parser.expectKey[top] = false;
+    return;
+  }
+  handleStringValue(parser);
+}
+
+void finishScalar(NordPoolStreamParser &parser) {
+  parser.inScalar = false;
+  if (parser.depth == 0) return;
+  handleScalarValue(parser);
+}
+
+bool openContainer(NordPoolStreamParser &parser, char kind) {
+  if (parser.depth >= kNordPoolParserMaxDepth) return false;
+
+  const uint8_t level = parser.depth;
+  parser.containers[level] = kind;
+  parser.expectKey[level] = (kind == '{');
+  parser.keys[level][0] = '\0';
+  ++parser.depth;
+
+  if (kind == '[' && level == 1 && strcmp(parentKey(parser, level), kEntriesKey) == 0) {
+    parser.entriesDepthSet = true;
+    parser.entriesDepth = parser.depth;
+  }
+  if (inEntryObject(parser)) {
+    parser.deliveryStart[0] = '\0';
+    parser.priceMask = 0;
+  }
+  return true;
+}
+
+bool closeContainer(NordPoolStreamParser &parser, char kind) {
+  if (parser.depth == 0 || parser.containers[parser.depth - 1] != kind) return false;
+
+  if (inEntryObject(parser) && parser.deliveryStart[0] != '\0' && parser.priceMask != 0) {
+    ++parser.entries;
+    for (uint8_t i = 0; i < parser.areaCount && parser.onEntry != nullptr; ++i) {
+      if ((parser.priceMask & (1u << i)) != 0) {
+        parser.onEntry(parser.ctx, parser.deliveryStart, i, parser.prices[i]);
+      }
+    }
+  }
+  if (kind == '[' && parser.entriesDepthSet && parser.depth == parser.entriesDepth) {
+    parser.entriesDepthSet = false;
+  }
+
+  --parser.depth;
+  if (parser.depth == 0) parser.status = NordPoolParseStatus::Done;
+  return true;
+}
+
+bool consumeChar(NordPoolStreamParser &parser, char c) {
+  if (parser.inString) {
+    if (parser.inEscape) {
+      parser.inEscape = false;
+      appendToken(parser, c);
+    } else if (c == '\\') {
+      parser.inEscape = true;
+    } else if (c == '"') {
+      finishString(parser);
+    } else {
+      appendToken(parser, c);
+    }
+    return true;
+  }
+
+  if (parser.inScalar) {
+    if (isScalarChar(c)) {
+      appendToken(parser, c);
+      return true;
+    }
+    finishScalar(parser);
+  }
+
+  if (isWhitespace(c)) return true;
+
+  switch (c) {
+    case '{':
+    case '[':
+      return openContainer(parser, c);
+    case '}':
+      return closeContainer(parser, '{');
+    case ']':
+      return closeContainer(parser, '[');
+    case ':':
+      return parser.depth > 0;
+    case ',':
+      if (parser.depth == 0) return false;
+      if (parser.containers[parser.depth - 1] == '{') parser.expectKey[parser.depth - 1] = true;
+      return true;
+    case '"':
+      if (parser.depth == 0) return false;
+      parser.inString = true;
+      resetToken(parser);
+      return true;
+    default:
+      if (parser.depth == 0 || !isScalarChar(c)) return false;
+      parser.inScalar = true;
+      resetToken(parser);
+      appendToken(parser, c);
+      return true;
+  }
+}
+}  // namespace
+
+void nordPoolParserBegin(
+    NordPoolStreamParser &parser,
+    const char *const *areas,
+    size_t areaCount,
+    NordPoolEntryCallback onEntry,
+    void *ctx) {
+  parser = NordPoolStreamParser();
+  for (size_t i = 0; i < areaCount && i < kNordPoolParserMaxAreas; ++i) {
+    parser.areas[i] = areas[i];
+  }
+  parser.areaCount = (uint8_t)(areaCount < kNordPoolParserMaxAreas ? areaCount : kNordPoolParserMaxAreas);
+  parser.onEntry = onEntry;
+  parser.ctx = ctx;
+}
+
+NordPoolParseStatus nordPoolParserFeed(NordPoolStreamParser &parser, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len && parser.status == NordPoolParseStatus::InProgress; ++i) {
+    ++parser.bytesFed;
+    if (!consumeChar(parser, (char)data[i])) {
+      parser.status = NordPoolParseStatus::Error;
+    }
+  }
+  return parser.status;
+}
@@ -0,0 +1,148 @@
+#include "nordpool_publish_stats.h"
+
+#include <string.h>
+
+#include "flash_storage.h"
+#include "local_time.h"
+#include "logging_utils.h"
+#include "time_utils.h"
+
+namespace {
+constexpr char kPublishStatsPath[] = "/nordpool_pub.bin";
+constexpr uint16_t kMinutesPerDay = 24 * 60;
+// Polls further apart than this bracket the publication too loosely.
+constexpr time_t kMaxObservationGapSec = 30 * 60;
+// Margins around the learned p10..p90 range.
+constexpr uint16_t kWindowLeadMinutes = 10;
+constexpr uint16_t kWindowTailMinutes = 10;
+
+bool minuteOfDay(time_t ts, uint16_t &minute, int &yday) {
+  struct tm local;
+  if (!localTimeFromUtc(ts, local)) return false;
+  minute = (uint16_t)(local.tm_hour * 60 + local.tm_min);
+  yday = local.tm_yday;
+  return true;
+}
+
+void addSample(PublishStats &stats, uint16_t minute) {
+  stats.minutes[stats.head] = minute;
+  stats.head = (uint8_t)((stats.head + 1) % kPublishStatsMaxSamples);
+  if (stats.count < kPublishStatsMaxSamples) ++stats.count;
+  LOG_INFO(
+      App,
+      "Nord Pool publication seen: area=%s at %02u:%02u samples=%u",
+      stats.area,
+      (unsigned)(minute / 60),
+      (unsigned)(minute % 60),
+      (unsigned)stats.count);
+}
+}  // namespace
+
+void resetPublishStats(PublishStats &stats, const char *area) {
+  stats = PublishStats();
+  copyStateText(stats.area, area);
+}
+
+bool loadPublishStats(PublishStats &stats) {
+  if (!storageMount()) return false;
+
+  File file = storageOpen(kPublishStatsPath, FILE_READ);
+  if (!file) return false;
+
+  if ((size_t)file.size() != sizeof(PublishStats)) {
+    file.close();
+    return false;
+  }
+
+  const size_t readBytes = storageRead(file, &stats, sizeof(PublishStats));
+  file.close();
+  if (readBytes != sizeof(PublishStats)) return false;
+  if (stats.magic != kPublishStatsMagic || stats.version != kPublishStatsVersion) return false;
+  if (stats.count > kPublishStatsMaxSamples || stats.head >= kPublishStatsMaxSamples) return false;
+  stats.area[kStateAreaLen - 1] = '\0';
+  return true;
+}
+
+bool savePublishStats(const PublishStats &stats) {
+  if (!storageMount()) return false;
+
+  StorageChunk snapshot;
+  snapshot.data = &stats;
+  snapshot.len = sizeof(PublishStats);
+  return storageWriteAtomic(kPublishStatsPath, &snapshot, 1);
+}
+
+bool clearPublishStats() {
+  if (!storageMount()) return false;
+  if (!storageExists(kPublishStatsPath)) return true;
+  if (!storageRemove(kPublishStatsPath)) {
+    LOG_WARN(Storage, "Nord Pool publication stats clear failed");
+    return false;
+  }
+  LOG_INFO(Storage, "Nord Pool publication stats cleared");
+  return true;
+}
+
+bool notePublishObserved(PublishStats &stats, time_t missedAt, time_t seenAt) {
+  if (!isValidClock(missedAt, kValidEpochMin) || seenAt <= missedAt) return false;
+  if (seenAt - missedAt > kMaxObservationGapSec) return false;
+
+  uint16_t missedMinute = 0;
+  uint16_t seenMinute = 0;
+  int missedDay = -1;
+  int seenDay = -1;
+  if (!minuteOfDay(missedAt, missedMinute, missedDay) || !minuteOfDay(seenAt, seenMinute, seenDay)) return false;
+  if (missedDay != seenDay) return false;
+
+  addSample(stats, (uint16_t)((missedMinute + seenMinute) / 2));
+  return true;
+}
+
+bool notePublishedBeforeWindow(PublishStats &stats, time_t seenAt, const PublishWindow &window) {
+  uint16_t minute = 0;
+  int yday = -1;
+  if (!isValidClock(seenAt, kValidEpochMin) || !minuteOfDay(seenAt, minute, yday)) return false;
+  // The first poll lands within the jitter of the window start.
+  constexpr uint16_t kFirstPollSlackMinutes = kPublishPollJitterSec / 60 + 1;
+  if (minute < window.firstMinute || minute > window.firstMinute + kFirstPollSlackMinutes) return false;
+  addSample(stats, window.firstMinute);
+  return true;
+}
+
+PublishWindow publishWindow(const PublishStats &stats) {
+  PublishWindow window;
+  if (stats.count < kPublishStatsMinSamples) return window;
+
+  uint16_t sorted[kPublishStatsMaxSamples];
+  const size_t count = stats.count;
+  memcpy(sorted, stats.minutes, count * sizeof(sorted[0]));
+  for (size_t i = 1; i < count; ++i) {
+    const uint16_t value = sorted[i];
+    size_t j = i;
+    for (; j > 0 && sorted[j - 1] > value; --j) sorted[j] = sorted[j - 1];
+    sorted[j] = value;
+  }
+
+  const uint16_t low = sorted[((count - 1) * 10) / 100];
+  const uint16_t high = sorted[((count - 1) * 90 + 99) / 100];
+  window.firstMinute = low > kWindowLeadMinutes ? (uint16_t)(low - kWindowLeadMinutes) : 0;
+  window.lastMinute = (uint16_t)(high + kWindowTailMinutes);
+  if (window.lastMinute >= kMinutesPerDay) window.lastMinute = kMinutesPerDay - 1;
+  window.learned = true;
+  return window;
+}
+
+time_t publishFirstPollAfter(time_t now, const PublishWindow &window) {
+  return scheduleNextDailyFetch(now, window.firstMinute / 60, window.firstMinute % 60);
+}
+
+time_t publishRetryDelaySec(time_t now, const PublishWindow &window) {
+  uint16_t minute = 0;
+  int yday = -1;
+  if (!minuteOfDay(now, minute, yday)) return kPublishSparsePollSec;
+  if (minute < window.firstMinute) {
+    const time_t untilWindow = (time_t)(window.firstMinute - minute) * 60;
+    return untilWindow < kPublishSparsePollSec ? untilWindow : kPublishSparsePollSec;
+  }
+  return minute <= window.lastMinute ? kPublishTightPollSec : kPublishSparsePollSec;
+}
@@ -0,0 +1,88 @@
+#include "perf_spans.h"
+
+#if CONFIG_PERF_SPANS
+
+#include <esp_heap_caps.h>
+
+#include "logging_utils.h"
+
+namespace {
+struct SpanStats {
+  uint32_t durationsUs[kPerfWindow] = {0};
+  uint32_t total = 0;  // spans recorded since boot; window holds the newest
+  uint32_t minFreeHeap = UINT32_MAX;
+  uint32_t minLargestBlock = UINT32_MAX;
+};
+
+// Spans are written by the loop and the network task, but each span only
+// by one of them; a summary printed mid-update may be off by one sample.
+SpanStats gSpans[(size_t)PerfSpan::Count];
+
+const char *spanName(PerfSpan span) {
+  switch (span) {
+    case PerfSpan::FetchConnect: return "fetch.connect";
+    case PerfSpan::FetchFirstByte: return "fetch.ttfb";
+    case PerfSpan::FetchBodyRead: return "fetch.body";
+    case PerfSpan::FetchParse: return "fetch.parse";
+    case PerfSpan::MovingAverage: return "fetch.ma";
+    case PerfSpan::CacheSave: return "cache.save";
+    case PerfSpan::DisplayFrame: return "display.frame";
+    case PerfSpan::PriceText: return "display.price";
+    case PerfSpan::Count:
+    default: return "?";
+  }
+}
+}  // namespace
+
+void perfRecord(PerfSpan span, uint32_t durationUs) {
+  if (span >= PerfSpan::Count) return;
+  SpanStats &stats = gSpans[(size_t)span];
+  stats.durationsUs[stats.total % kPerfWindow] = durationUs;
+  ++stats.total;
+
+  const uint32_t freeHeap = ESP.getFreeHeap();
+  const uint32_t largestBlock = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (freeHeap < stats.minFreeHeap) stats.minFreeHeap = freeHeap;
+  if (largestBlock < stats.minLargestBlock) stats.minLargestBlock = largestBlock;
+}
+
+void perfLogSummary() {
+  LOG_INFO(App, "Perf spans (last %u each): name n min/avg/max us, heap low-water free/largest", (unsigned)kPerfWindow);
+  for (size_t i = 0; i < (size_t)PerfSpan::Count; ++i) {
+    const SpanStats &stats = gSpans[i];
+    if (stats.total == 0) continue;
+
+    const size_t samples = stats.total < kPerfWindow ? stats.total : kPerfWindow;
+    uint32_t minUs = UINT32_MAX;
+    uint32_t maxUs = 0;
+    uint64_t sumUs = 0;
+    for (size_t s = 0; s < samples; ++s) {
+      const uint32_t us = stats.durationsUs[s];
+      if (us < minUs) minUs = us;
+      if (us > maxUs) maxUs = us;
+      sumUs += us;
+    }
+    LOG_INFO(
+        App,
+        "  %-13s n=%lu %lu/%lu/%lu heap=%lu/%lu",
+        spanName((PerfSpan)i),
+        (unsigned long)stats.total,
+        (unsigned long)minUs,
+        (unsigned long)(sumUs / samples),
+        (unsigned long)maxUs,
+        (unsigned long)stats.minFreeHeap,
+        (unsigned long)stats.minLargestBlock);
+  }
+  LOG_INFO(App, "  heap now free=%u min_ever=%u", ESP.getFreeHeap(), ESP.getMinFreeHeap());
+}
+
+void perfPollSerial() {
+  bool requested = false;
+  while (Serial.available() > 0) {
+    const int c = Serial.read();
+    if (c == 'p' || c == 'P') requested = true;
+  }
+  if (requested) perfLogSummary();
+}
+
+#endif  // CONFIG_PERF_SPANS
@@ -0,0 +1,167 @@
+#include "power_manager.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "logging_utils.h"
+
+namespace {
+constexpr int64_t kStatsWindowUs = 60LL * 60LL * 1000000LL;
+// Shorter waits are not worth the light-sleep entry/exit cost.
+constexpr uint32_t kMinLightSleepMs = 20;
+
+struct PowerStats {
+  int64_t windowStartUs = 0;
+  int64_t sleptUs = 0;
+  int64_t radioOnUs = 0;
+  int64_t radioOnSinceUs = 0;
+  uint32_t lightSleeps = 0;
+  uint32_t timerWakes = 0;
+  uint32_t gpioWakes = 0;
+  uint32_t idleWakes = 0;
+};
+
+PowerMode gMode = PowerMode::Performance;
+int gWakePin = -1;
+int gWakeActiveLevel = LOW;
+bool gRadioOn = false;
+PowerStats gStats;
+// powerNoteRadio runs on the network worker, the rest on the loop task.
+portMUX_TYPE gStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+const char *powerModeName(PowerMode mode) {
+  switch (mode) {
+    case PowerMode::ModemSleep: return "modem-sleep";
+    case PowerMode::LightSleep: return "light-sleep";
+    case PowerMode::Performance:
+    default: return "performance";
+  }
+}
+
+void logHourlyStatsIfDue(int64_t nowUs) {
+  PowerStats stats;
+  portENTER_CRITICAL(&gStatsMux);
+  if (nowUs - gStats.windowStartUs < kStatsWindowUs) {
+    portEXIT_CRITICAL(&gStatsMux);
+    return;
+  }
+  if (gRadioOn) {
+    gStats.radioOnUs += nowUs - gStats.radioOnSinceUs;
+    gStats.radioOnSinceUs = nowUs;
+  }
+  stats = gStats;
+  gStats = PowerStats();
+  gStats.windowStartUs = nowUs;
+  gStats.radioOnSinceUs = nowUs;
+  portEXIT_CRITICAL(&gStatsMux);
+
+  const int64_t windowUs = nowUs - stats.windowStartUs;
+  const int64_t awakeUs = windowUs - stats.sleptUs;
+  LOG_INFO(
+      Power,
+      "Power (%s, last %lus): awake=%lus (%.1f%%) radio=%lus light_sleeps=%lu wakes timer=%lu gpio=%lu task=%lu",
+      powerModeName(gMode),
+      (unsigned long)(windowUs / 1000000),
+      (unsigned long)(awakeUs / 1000000),
+      windowUs > 0 ? (100.0 * (double)awakeUs / (double)windowUs) : 0.0,
+      (unsigned long)(stats.radioOnUs / 1000000),
+      (unsigned long)stats.lightSleeps,
+      (unsigned long)stats.timerWakes,
+      (unsigned long)stats.gpioWakes,
+      (unsigned long)stats.idleWakes);
+}
+
+void lightSleepFor(uint32_t waitMs) {
+  // The wake pin also carries the reset button's edge interrupt; switch it
+  // to a level wake-up only for the duration of the sleep.
+  if (gWakePin >= 0) {
+    gpio_wakeup_enable(
+        (gpio_num_t)gWakePin, gWakeActiveLevel == LOW ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+  }
+  esp_sleep_enable_timer_wakeup((uint64_t)waitMs * 1000ULL);
+  logFlush();
+
+  const int64_t beforeUs = esp_timer_get_time();
+  esp_light_sleep_start();
+  const int64_t sleptUs = esp_timer_get_time() - beforeUs;
+  const esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+
+  if (gWakePin >= 0) {
+    gpio_wakeup_disable((gpio_num_t)gWakePin);
+    gpio_set_intr_type((gpio_num_t)gWakePin, GPIO_INTR_ANYEDGE);
+  }
+  // Drop notifications that arrived with the wake so the next wait blocks.
+  ulTaskNotifyTake(pdTRUE, 0);
+
+  portENTER_CRITICAL(&gStatsMux);
+  gStats.sleptUs += sleptUs;
+  gStats.lightSleeps++;
+  if (cause == ESP_SLEEP_WAKEUP_GPIO) {
+    gStats.gpioWakes++;
+  } else {
+    gStats.timerWakes++;
+  }
+  portEXIT_CRITICAL(&gStatsMux);
+}
+}  // namespace
+
+void powerInit(PowerMode mode, int wakePin, int wakeActiveLevel) {
+  gMode = mode;
+  gWakePin = wakePin;
+  gWakeActiveLevel = wakeActiveLevel;
+  gStats = PowerStats();
+  gStats.windowStartUs = esp_timer_get_time();
+  // Tracked precisely only for the on-demand radio; otherwise WiFi is meant to be up.
+  gRadioOn = mode != PowerMode::LightSleep;
+  gStats.radioOnSinceUs = gStats.windowStartUs;
+
+  if (mode == PowerMode::ModemSleep) {
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+  }
+  LOG_INFO(Power, "Power mode: %s", powerModeName(mode));
+}
+
+PowerMode powerMode() {
+  return gMode;
+}
+
+bool powerRadioOnDemand() {
+  return gMode == PowerMode::LightSleep;
+}
+
+bool powerRadioOn() {
+  return gRadioOn;
+}
+
+void powerNoteRadio(bool on) {
+  const int64_t nowUs = esp_timer_get_time();
+  portENTER_CRITICAL(&gStatsMux);
+  if (on && !gRadioOn) {
+    gStats.radioOnSinceUs = nowUs;
+  } else if (!on && gRadioOn) {
+    gStats.radioOnUs += nowUs - gStats.radioOnSinceUs;
+  }
+  gRadioOn = on;
+  portEXIT_CRITICAL(&gStatsMux);
+}
+
+void powerIdle(uint32_t waitMs, bool allowLightSleep) {
+  if (waitMs == 0) return;
+
+  if (gMode == PowerMode::LightSleep && allowLightSleep && !gRadioOn && waitMs >= kMinLightSleepMs) {
+    lightSleepFor(waitMs);
+  } else if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs)) != 0) {
+    // Woken early by an interrupt, WiFi event or finished network job. The
+    // chip stays powered during a plain wait, so it counts as awake time.
+    portENTER_CRITICAL(&gStatsMux);
+    gStats.idleWakes++;
+    portEXIT_CRITICAL(&gStatsMux);
+  }
+  logHourlyStatsIfDue(esp_timer_get_time());
+}
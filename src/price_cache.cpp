@@ -1,25 +1,97 @@
-#include <ArduinoJson.h>
-#include <FS.h>
-#include <SPIFFS.h>
 #include <string.h>
 
+#include "flash_storage.h"
 #include "logging_utils.h"
+#include "perf_spans.h"
 #include "price_cache.h"
+#include "price_state_utils.h"
 #include "time_utils.h"
 
 namespace {
-constexpr char kCachePath[] = "/price_cache.json";
-constexpr int kCacheVersion = 2;
-
-bool ensureSpiffsMounted() {
-  static bool attempted = false;
-  static bool mounted = false;
-  if (!attempted) {
-    attempted = true;
-    mounted = SPIFFS.begin(true);
-    logf("Price cache SPIFFS mount: %s", mounted ? "ok" : "failed");
+constexpr char kCachePath[] = "/price_cache.bin";
+constexpr char kLegacyJsonCachePath[] = "/price_cache.json";
+constexpr uint32_t kCacheMagic = 0x4E505043;  // "NPPC"
+constexpr uint16_t kCacheVersion = 8;
+
+// Fixed on-flash layout: header, `count` raw PricePoint records, then per
+// extra area its name and `count` int32 raw prices.
+struct PriceCacheHeader {
+  uint32_t magic = kCacheMagic;
+  uint16_t version = kCacheVersion;
+  uint16_t pointSize = sizeof(PricePoint);
+  uint16_t count = 0;
+  uint16_t resolutionMinutes = 60;
+  uint8_t hasRunningAverage = 0;
+  uint8_t extraAreaCount = 0;
+  uint8_t reserved[2] = {0};
+  int32_t runningAverage = 0;
+  uint32_t fingerprint = 0;  // PriceState::fingerprint of the stored points
+  char source[kStateSourceLen] = {0};
+  char area[kStateAreaLen] = {0};
+  char currency[kStateCurrencyLen] = {0};
+  uint32_t crc = 0;  // CRC-32 over header (with crc = 0) and point records
+};
+
+// Header of the file currently on flash, so a save of the same price set
+// can be skipped without reading the points back.
+PriceCacheHeader gFlashHeader;
+bool gFlashHeaderKnown = false;
+
+bool readFlashHeader(PriceCacheHeader &header) {
+  File file = storageOpen(kCachePath, FILE_READ);
+  if (!file) return false;
+  const bool read = file.size() >= sizeof(header) && storageRead(file, &header, sizeof(header)) == sizeof(header);
+  file.close();
+  return read && header.magic == kCacheMagic && header.version == kCacheVersion &&
+         header.pointSize == sizeof(PricePoint);
+}
+
+void rememberFlashHeader(const PriceCacheHeader &header) {
+  gFlashHeader = header;
+  gFlashHeaderKnown = true;
+}
+
+bool flashHoldsSamePrices(const PriceCacheHeader &header) {
+  if (!gFlashHeaderKnown) {
+    PriceCacheHeader onFlash;
+    if (!readFlashHeader(onFlash)) return false;
+    rememberFlashHeader(onFlash);
+  }
+  return gFlashHeader.fingerprint == header.fingerprint && gFlashHeader.count == header.count &&
+         strncmp(gFlashHeader.source, header.source, sizeof(header.source)) == 0;
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+size_t extraAreaPriceBytes(const PriceCacheHeader &header) {
+  return (size_t)header.count * sizeof(int32_t);
+}
+
+size_t cacheFileSize(const PriceCacheHeader &header) {
+  return sizeof(header) + (size_t)header.count * sizeof(PricePoint) +
+         (size_t)header.extraAreaCount * (kStateAreaLen + extraAreaPriceBytes(header));
+}
+
+uint32_t cacheChecksum(const PriceCacheHeader &header, const PriceState &state) {
+  PriceCacheHeader unsignedHeader = header;
+  unsignedHeader.crc = 0;
+  uint32_t crc = crc32Update(0, (const uint8_t *)&unsignedHeader, sizeof(unsignedHeader));
+  crc = crc32Update(crc, (const uint8_t *)state.points, (size_t)header.count * sizeof(PricePoint));
+  for (uint8_t i = 0; i < header.extraAreaCount; ++i) {
+    const AreaSeries &series = state.extraAreas[i];
+    crc = crc32Update(crc, (const uint8_t *)series.area, kStateAreaLen);
+    crc = crc32Update(crc, (const uint8_t *)series.rawPrices, extraAreaPriceBytes(header));
   }
-  return mounted;
+  return crc;
 }
 
 void applyCurrentFromIndex(PriceState &state, int idx) {
@@ -30,128 +102,148 @@ void applyCurrentFromIndex(PriceState &state, int idx) {
   state.currentLevel = state.points[idx].level;
   state.currentPrice = state.points[idx].price;
 }
+}  // namespace
+
+bool priceCacheSave(const PriceState &state) {
+  if (!state.ok || state.count == 0) return false;
+  if (!storageMount()) return false;
+  const PerfScope span(PerfSpan::CacheSave);
+
+  PriceCacheHeader header;
+  header.count = (uint16_t)state.count;
+  header.resolutionMinutes = state.resolutionMinutes;
+  header.hasRunningAverage = state.hasRunningAverage ? 1 : 0;
+  header.extraAreaCount = state.extraAreaCount;
+  header.runningAverage = state.runningAverage;
+  header.fingerprint = state.fingerprint != 0 ? state.fingerprint : priceStateFingerprint(state);
+  copyStateText(header.source, state.source);
+  copyStateText(header.area, state.area);
+  copyStateText(header.currency, state.currency);
+  if (flashHoldsSamePrices(header)) {
+    LOG_DEBUG(Storage, "Price cache unchanged, write skipped");
+    return true;
+  }
+  header.crc = cacheChecksum(header, state);
+
+  // Written to a temp file and swapped in, so a reset mid-save keeps the
+  // previous cache instead of forcing a cold fetch on the next boot.
+  StorageChunk chunks[2 + 2 * kMaxExtraAreas];
+  size_t chunkCount = 0;
+  chunks[chunkCount].data = &header;
+  chunks[chunkCount++].len = sizeof(header);
+  chunks[chunkCount].data = state.points;
+  chunks[chunkCount++].len = state.count * sizeof(PricePoint);
+  for (uint8_t i = 0; i < state.extraAreaCount; ++i) {
+    chunks[chunkCount].data = state.extraAreas[i].area;
+    chunks[chunkCount++].len = kStateAreaLen;
+    chunks[chunkCount].data = state.extraAreas[i].rawPrices;
+    chunks[chunkCount++].len = extraAreaPriceBytes(header);
+  }
+  if (!storageWriteAtomic(kCachePath, chunks, chunkCount)) {
+    gFlashHeaderKnown = false;
+    LOG_WARN(Storage, "Price cache save failed: write");
+    return false;
+  }
+  rememberFlashHeader(header);
+
+  storageRemove(kLegacyJsonCachePath);
+  return true;
+}
 
-bool priceCacheLoadInternal(const char *expectedSource, bool requireCurrentInterval, PriceState &out) {
+bool priceCacheLoad(const char *expectedSource, PriceState &out, bool &coversCurrentInterval) {
   out = PriceState();
-  if (!ensureSpiffsMounted()) return false;
+  coversCurrentInterval = false;
+  if (!storageMount()) return false;
 
-  File file = SPIFFS.open(kCachePath, FILE_READ);
+  const uint32_t startMs = millis();
+  File file = storageOpen(kCachePath, FILE_READ);
   if (!file) return false;
 
-  JsonDocument doc;
-  const DeserializationError err = deserializeJson(doc, file);
-  file.close();
-  if (err) {
-    logf("Price cache parse failed: %s", err.c_str());
+  PriceCacheHeader header;
+  const size_t fileSize = (size_t)file.size();
+  if (fileSize < sizeof(header) || storageRead(file, &header, sizeof(header)) != sizeof(header)) {
+    file.close();
     return false;
   }
 
-  const int version = doc["version"] | 0;
-  if (version != kCacheVersion) {
-    logf("Price cache version mismatch: found=%d expected=%d", version, kCacheVersion);
+  if (header.magic != kCacheMagic || header.version != kCacheVersion || header.pointSize != sizeof(PricePoint)) {
+    file.close();
+    LOG_WARN(
+        Storage,
+        "Price cache format mismatch: version=%u expected=%u",
+        (unsigned)header.version,
+        (unsigned)kCacheVersion);
     return false;
   }
 
-  out.source = String((const char *)(doc["source"] | ""));
-  if (expectedSource != nullptr && strlen(expectedSource) > 0 && out.source != String(expectedSource)) {
+  const size_t pointBytes = (size_t)header.count * sizeof(PricePoint);
+  if (header.count == 0 || header.count > kMaxPoints || header.extraAreaCount > kMaxExtraAreas ||
+      fileSize != cacheFileSize(header)) {
+    file.close();
+    LOG_WARN(Storage, "Price cache size mismatch: points=%u bytes=%u", (unsigned)header.count, (unsigned)fileSize);
     return false;
   }
 
-  out.currency = String((const char *)(doc["currency"] | "SEK"));
-  out.resolutionMinutes = doc["resolutionMinutes"] | 60;
-  out.hasRunningAverage = doc["hasRunningAverage"] | false;
-  out.runningAverage = doc["runningAverage"] | 0.0f;
-
-  JsonArray points = doc["points"].as<JsonArray>();
-  if (points.isNull()) return false;
-
-  for (JsonObject item : points) {
-    if (out.count >= kMaxPoints) break;
-
-    const String startsAt = String((const char *)(item["startsAt"] | ""));
-    if (startsAt.length() == 0) continue;
+  // Records are read straight into the state; no per-point decoding.
+  bool readOk = storageRead(file, out.points, pointBytes) == pointBytes;
+  for (uint8_t i = 0; i < header.extraAreaCount && readOk; ++i) {
+    AreaSeries &series = out.extraAreas[i];
+    readOk = storageRead(file, series.area, kStateAreaLen) == kStateAreaLen &&
+             storageRead(file, series.rawPrices, extraAreaPriceBytes(header)) == extraAreaPriceBytes(header);
+    series.area[kStateAreaLen - 1] = '\0';
+  }
+  file.close();
+  if (!readOk || cacheChecksum(header, out) != header.crc) {
+    LOG_WARN(Storage, "Price cache checksum mismatch");
+    out = PriceState();
+    return false;
+  }
+  rememberFlashHeader(header);
 
-    PricePoint &p = out.points[out.count++];
-    p.startsAt = startsAt;
-    p.level = String((const char *)(item["level"] | "UNKNOWN"));
-    p.price = item["price"] | 0.0f;
-    if (!item["rawPrice"].isNull()) {
-      p.rawPricePerKwh = item["rawPrice"] | 0.0f;
-      p.hasRawPrice = true;
-    }
+  header.source[sizeof(header.source) - 1] = '\0';
+  header.area[sizeof(header.area) - 1] = '\0';
+  header.currency[sizeof(header.currency) - 1] = '\0';
+  if (expectedSource != nullptr && strlen(expectedSource) > 0 && strcmp(header.source, expectedSource) != 0) {
+    out = PriceState();
+    return false;
   }
 
-  if (out.count == 0) return false;
+  copyStateText(out.source, header.source);
+  copyStateText(out.area, header.area);
+  copyStateText(out.currency, header.currency[0] != '\0' ? header.currency : "SEK");
+  out.resolutionMinutes = header.resolutionMinutes;
+  out.hasRunningAverage = header.hasRunningAverage != 0;
+  out.runningAverage = header.runningAverage;
+  out.count = header.count;
+  out.extraAreaCount = header.extraAreaCount;
+  out.fingerprint = header.fingerprint;
+  updatePriceStateSlotIndex(out);
 
   int idx = findCurrentPricePointIndex(out, out.resolutionMinutes);
-  if (idx < 0) {
-    if (requireCurrentInterval) {
-      // Cache exists but does not cover current interval.
-      return false;
-    }
-    idx = 0;
-  }
+  coversCurrentInterval = idx >= 0;
+  // Fall back to the first point, but only once the clock can tell.
+  if (idx < 0 && isValidClock(clockNow(), kValidEpochMin)) idx = 0;
 
   applyCurrentFromIndex(out, idx);
   out.ok = true;
+  LOG_INFO(
+      Storage,
+      "Price cache loaded: points=%u current=%s in %lu ms",
+      (unsigned)out.count,
+      coversCurrentInterval ? "yes" : "no",
+      (unsigned long)(millis() - startMs));
   return true;
 }
-}  // namespace
-
-bool priceCacheSave(const PriceState &state) {
-  if (!state.ok || state.count == 0) return false;
-  if (!ensureSpiffsMounted()) return false;
-
-  JsonDocument doc;
-  doc["version"] = kCacheVersion;
-  doc["source"] = state.source;
-  doc["currency"] = state.currency;
-  doc["resolutionMinutes"] = state.resolutionMinutes;
-  doc["hasRunningAverage"] = state.hasRunningAverage;
-  doc["runningAverage"] = state.runningAverage;
-
-  JsonArray points = doc["points"].to<JsonArray>();
-  for (size_t i = 0; i < state.count; ++i) {
-    JsonObject item = points.add<JsonObject>();
-    item["startsAt"] = state.points[i].startsAt;
-    item["level"] = state.points[i].level;
-    item["price"] = state.points[i].price;
-    if (state.points[i].hasRawPrice) {
-      item["rawPrice"] = state.points[i].rawPricePerKwh;
-    }
-  }
-
-  File file = SPIFFS.open(kCachePath, FILE_WRITE);
-  if (!file) {
-    logf("Price cache save failed: open");
-    return false;
-  }
-
-  if (serializeJson(doc, file) == 0) {
-    file.close();
-    logf("Price cache save failed: serialize");
-    return false;
-  }
-  file.flush();
-  file.close();
-  return true;
-}
-
-bool priceCacheLoadIfCurrent(const char *expectedSource, PriceState &out) {
-  return priceCacheLoadInternal(expectedSource, true, out);
-}
-
-bool priceCacheLoadIfAvailable(const char *expectedSource, PriceState &out) {
-  return priceCacheLoadInternal(expectedSource, false, out);
-}
 
 bool priceCacheClear() {
-  if (!ensureSpiffsMounted()) return false;
-  if (!SPIFFS.exists(kCachePath)) return true;
-  if (!SPIFFS.remove(kCachePath)) {
-    logf("Price cache clear failed");
+  if (!storageMount()) return false;
+  storageRemove(kLegacyJsonCachePath);
+  gFlashHeaderKnown = false;
+  if (!storageExists(kCachePath)) return true;
+  if (!storageRemove(kCachePath)) {
+    LOG_WARN(Storage, "Price cache clear failed");
     return false;
   }
-  logf("Price cache cleared");
+  LOG_INFO(Storage, "Price cache cleared");
   return true;
 }
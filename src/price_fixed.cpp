@@ -0,0 +1,65 @@
+#include "price_fixed.h"
+
+#include <math.h>
+#include <stdio.h>
+
+namespace {
+constexpr float kDefaultVatPercent = 25.0f;
+constexpr float kDefaultFixedCostMinorPerKwh = 0.0f;
+constexpr int32_t kDecimalDivisors[5] = {10000, 1000, 100, 10, 1};
+
+float normalizeVatPercent(float value) {
+  if (!isfinite(value)) return kDefaultVatPercent;
+  if (value < 0.0f || value > 100.0f) return kDefaultVatPercent;
+  return value;
+}
+
+float normalizeFixedCostMinorPerKwh(float value) {
+  if (!isfinite(value)) return kDefaultFixedCostMinorPerKwh;
+  if (value < -10000.0f || value > 10000.0f) return kDefaultFixedCostMinorPerKwh;
+  return value;
+}
+}  // namespace
+
+PriceFormula makePriceFormula(float vatPercent, float fixedCostMinorPerKwh) {
+  PriceFormula formula;
+  // ((energy_minor) * (1 + VAT/100) + fixed_cost_minor), kept in price units.
+  formula.vatMultiplier = (int32_t)lroundf((100.0f + normalizeVatPercent(vatPercent)) * 100.0f);
+  formula.offset = (int32_t)lroundf(normalizeFixedCostMinorPerKwh(fixedCostMinorPerKwh) * (float)kPriceFixedPerMinor);
+  return formula;
+}
+
+int32_t priceFixedFromMajor(float major) {
+  if (!isfinite(major)) return 0;
+  const float scaled = major * (float)kPriceFixedPerMajor;
+  if (scaled >= 2147483647.0f) return INT32_MAX;
+  if (scaled <= -2147483648.0f) return INT32_MIN;
+  return (int32_t)lroundf(scaled);
+}
+
+size_t formatPriceFixed(int32_t price, uint8_t decimals, char *out, size_t outSize) {
+  if (outSize == 0) return 0;
+  if (decimals > 4) decimals = 4;
+
+  const int64_t divisor = kDecimalDivisors[decimals];
+  const bool negative = price < 0;
+  const int64_t magnitude = negative ? -(int64_t)price : (int64_t)price;
+  const int64_t units = (magnitude + divisor / 2) / divisor;  // in 10^-decimals
+  const int64_t scale = kPriceFixedPerMajor / divisor;
+  const unsigned long whole = (unsigned long)(units / scale);
+  const unsigned long fraction = (unsigned long)(units % scale);
+  // A value that rounds to zero prints without a sign.
+  const char *sign = negative && units != 0 ? "-" : "";
+
+  int len = 0;
+  if (decimals == 0) {
+    len = snprintf(out, outSize, "%s%lu", sign, whole);
+  } else {
+    len = snprintf(out, outSize, "%s%lu.%0*lu", sign, whole, (int)decimals, fraction);
+  }
+  if (len < 0) {
+    out[0] = '\0';
+    return 0;
+  }
+  return (size_t)len < outSize ? (size_t)len : outSize - 1;
+}
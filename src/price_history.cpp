@@ -0,0 +1,353 @@
+#include "price_history.h"
+
+#include <string.h>
+
+#include "flash_storage.h"
+#include "logging_utils.h"
+#include "time_utils.h"
+
+namespace {
+constexpr char kHistoryIndexPath[] = "/price_hist.idx";
+constexpr char kHistoryDataPath[] = "/price_hist.dat";
+constexpr uint32_t kHistoryMagic = 0x4E504849;  // "NPHI"
+constexpr uint16_t kHistoryVersion = 2;  // 1 stored float prices
+// The data file grows until this many days beyond the limit are recorded,
+// then one compaction drops the oldest days.
+constexpr uint16_t kHistoryCompactSlackDays = 7;
+constexpr uint16_t kHistoryIndexCapacity = kPriceHistoryDays + kHistoryCompactSlackDays;
+// 24 h of 15-minute slots plus a DST fall-back hour.
+constexpr size_t kMaxDaySamples = 100;
+// Cumulative fractions run 0..kFractionOne; each decile step is a tenth.
+constexpr int64_t kFractionOne = 10000;
+constexpr int64_t kDecileStep = kFractionOne / 10;
+constexpr uint32_t kMaxDaySec = 25 * 3600;  // DST fall-back day
+
+struct HistoryIndexHeader {
+  uint32_t magic = kHistoryMagic;
+  uint16_t version = kHistoryVersion;
+  uint16_t dayCount = 0;
+  uint32_t lastSlotStart = 0;  // newest slot already in the data file
+  uint32_t dataBytes = 0;      // data file size the index was written against
+};
+
+struct HistorySample {
+  uint32_t slotStart = 0;
+  int32_t value = 0;  // raw market price, fixed-point per kWh
+};
+
+HistoryIndexHeader gHeader;
+PriceHistoryDay gDays[kHistoryIndexCapacity];  // oldest first
+bool gLoaded = false;
+
+size_t dataFileSize() {
+  return storageFileSize(kHistoryDataPath);
+}
+
+void resetIndex() {
+  gHeader = HistoryIndexHeader();
+  gLoaded = true;
+}
+
+bool loadIndex() {
+  if (gLoaded) return true;
+  if (!storageMount()) return false;
+
+  resetIndex();
+  File file = storageOpen(kHistoryIndexPath, FILE_READ);
+  if (!file) return true;
+
+  HistoryIndexHeader header;
+  const bool headerRead = storageRead(file, &header, sizeof(header)) == sizeof(header);
+  if (headerRead && header.magic == kHistoryMagic && header.version != kHistoryVersion) {
+    // An older sample format: neither file can be read any more.
+    file.close();
+    LOG_WARN(Storage, "Price history format %u is outdated, discarding it", (unsigned)header.version);
+    storageRemove(kHistoryIndexPath);
+    storageRemove(kHistoryDataPath);
+    return true;
+  }
+  const bool headerOk = headerRead && header.magic == kHistoryMagic && header.dayCount <= kHistoryIndexCapacity;
+  const size_t dayBytes = headerOk ? header.dayCount * sizeof(PriceHistoryDay) : 0;
+  const bool daysOk = headerOk && storageRead(file, gDays, dayBytes) == dayBytes;
+  file.close();
+
+  // Samples the index doesn't know about are harmless; missing ones are not.
+  // A reset between a compaction and the index save also lands here, since
+  // the compacted file is smaller than the old index expects.
+  if (!daysOk || dataFileSize() < header.dataBytes) {
+    LOG_WARN(Storage, "Price history index invalid, starting over");
+    resetIndex();
+    return true;
+  }
+  gHeader = header;
+  LOG_INFO(Storage, "Price history loaded: days=%u", (unsigned)gHeader.dayCount);
+  return true;
+}
+
+bool saveIndex() {
+  StorageChunk chunks[2];
+  chunks[0].data = &gHeader;
+  chunks[0].len = sizeof(gHeader);
+  chunks[1].data = gDays;
+  chunks[1].len = gHeader.dayCount * sizeof(PriceHistoryDay);
+  return storageWriteAtomic(kHistoryIndexPath, chunks, 2);
+}
+
+void sortValues(int32_t *values, size_t count) {
+  for (size_t i = 1; i < count; ++i) {
+    const int32_t value = values[i];
+    size_t j = i;
+    while (j > 0 && values[j - 1] > value) {
+      values[j] = values[j - 1];
+      --j;
+    }
+    values[j] = value;
+  }
+}
+
+void summarizeDay(PriceHistoryDay &day, const HistorySample *samples, size_t count) {
+  static int32_t sorted[kMaxDaySamples];
+  day.count = (uint16_t)count;
+  day.sum = 0;
+  for (size_t i = 0; i < count; ++i) {
+    sorted[i] = samples[i].value;
+    day.sum += samples[i].value;
+  }
+  sortValues(sorted, count);
+  day.min = sorted[0];
+  day.max = sorted[count - 1];
+  for (size_t d = 0; d < kPriceHistoryDecileCount; ++d) {
+    // Position (d + 1) / 10 * (count - 1), kept in tenths.
+    const size_t pos = (d + 1) * (count - 1);
+    const size_t lo = pos / 10;
+    const size_t hi = lo + 1 < count ? lo + 1 : lo;
+    day.deciles[d] = sorted[lo] + (int32_t)(((int64_t)(sorted[hi] - sorted[lo]) * (int64_t)(pos % 10)) / 10);
+  }
+}
+
+bool readDaySamples(const PriceHistoryDay &day, HistorySample *samples) {
+  File file = storageOpen(kHistoryDataPath, FILE_READ);
+  if (!file) return false;
+  const size_t bytes = day.count * sizeof(HistorySample);
+  const bool read = file.seek(day.dataOffset) && storageRead(file, samples, bytes) == bytes;
+  file.close();
+  return read;
+}
+
+bool appendSamples(const HistorySample *samples, size_t count) {
+  return storageAppend(kHistoryDataPath, samples, count * sizeof(HistorySample));
+}
+
+// Keeps the newest kPriceHistoryDays days, copying their samples into a
+// fresh data file that replaces the old one.
+bool compactHistory() {
+  static HistorySample samples[kMaxDaySamples];
+  static uint32_t offsets[kPriceHistoryDays];
+  const uint16_t dropDays = gHeader.dayCount - kPriceHistoryDays;
+  char compactPath[32];
+  storageTempPath(kHistoryDataPath, compactPath, sizeof(compactPath));
+  File out = storageOpen(compactPath, FILE_WRITE);
+  if (!out) return false;
+
+  uint32_t offset = 0;
+  bool ok = true;
+  for (uint16_t i = dropDays; i < gHeader.dayCount && ok; ++i) {
+    const PriceHistoryDay &day = gDays[i];
+    const size_t bytes = day.count * sizeof(HistorySample);
+    ok = readDaySamples(day, samples) && storageWrite(out, samples, bytes) == bytes;
+    offsets[i - dropDays] = offset;
+    offset += bytes;
+  }
+  out.flush();
+  out.close();
+  if (!ok) return false;
+
+  if (!storageCommit(compactPath, kHistoryDataPath)) {
+    resetIndex();
+    return false;
+  }
+  memmove(gDays, gDays + dropDays, kPriceHistoryDays * sizeof(PriceHistoryDay));
+  for (uint16_t i = 0; i < kPriceHistoryDays; ++i) gDays[i].dataOffset = offsets[i];
+  gHeader.dayCount = kPriceHistoryDays;
+  gHeader.dataBytes = offset;
+  LOG_INFO(Storage, "Price history compacted: dropped=%u days bytes=%u", (unsigned)dropDays, (unsigned)offset);
+  return true;
+}
+
+// Writes one day's samples and its index record. A day that already has
+// samples is re-appended whole so its samples stay contiguous; the old copy
+// is dropped at the next compaction.
+bool recordDay(uint32_t dayStart, uint16_t resolutionMinutes, const HistorySample *samples, size_t count) {
+  static HistorySample merged[kMaxDaySamples];
+  PriceHistoryDay *day = nullptr;
+  if (gHeader.dayCount > 0 && gDays[gHeader.dayCount - 1].dayStart == dayStart) {
+    day = &gDays[gHeader.dayCount - 1];
+  }
+
+  size_t mergedCount = 0;
+  if (day != nullptr) {
+    if (!readDaySamples(*day, merged)) return false;
+    mergedCount = day->count;
+  }
+  if (mergedCount + count > kMaxDaySamples) count = kMaxDaySamples - mergedCount;
+  if (count == 0) return true;
+  memcpy(merged + mergedCount, samples, count * sizeof(HistorySample));
+  mergedCount += count;
+
+  if (day == nullptr && gHeader.dayCount >= kHistoryIndexCapacity && !compactHistory()) return false;
+  const size_t offset = dataFileSize();
+  if (!appendSamples(merged, mergedCount)) return false;
+
+  if (day == nullptr) {
+    day = &gDays[gHeader.dayCount++];
+    *day = PriceHistoryDay();
+    day->dayStart = dayStart;
+  }
+  day->dataOffset = (uint32_t)offset;
+  day->resolutionMinutes = resolutionMinutes;
+  summarizeDay(*day, merged, mergedCount);
+  gHeader.lastSlotStart = merged[mergedCount - 1].slotStart;
+  gHeader.dataBytes = (uint32_t)(offset + mergedCount * sizeof(HistorySample));
+  return true;
+}
+
+// Piecewise-linear CDF through (0, min), (0.1, p10) .. (0.9, p90), (1, max),
+// in 0..kFractionOne.
+int64_t dayFractionBelow(const PriceHistoryDay &day, int32_t value) {
+  if (value <= day.min) return 0;
+  if (value >= day.max) return kFractionOne;
+  int32_t prevValue = day.min;
+  int64_t prevFraction = 0;
+  for (size_t d = 0; d <= kPriceHistoryDecileCount; ++d) {
+    const int32_t nextValue = d < kPriceHistoryDecileCount ? day.deciles[d] : day.max;
+    if (value < nextValue) {
+      const int64_t span = (int64_t)nextValue - prevValue;
+      if (span <= 0) return prevFraction;
+      return prevFraction + (kDecileStep * ((int64_t)value - prevValue)) / span;
+    }
+    prevValue = nextValue;
+    prevFraction += kDecileStep;
+  }
+  return kFractionOne;
+}
+
+uint16_t firstQueryDay(uint16_t days) {
+  return gHeader.dayCount > days ? gHeader.dayCount - days : 0;
+}
+}  // namespace
+
+bool priceHistoryRecord(const PriceState &state) {
+  if (!state.ok || state.count == 0) return false;
+  if (!loadIndex()) return false;
+
+  static HistorySample pending[kMaxDaySamples];
+  size_t pendingCount = 0;
+  uint32_t pendingDay = 0;
+  size_t added = 0;
+  bool ok = true;
+  for (size_t i = 0; i < state.count && ok; ++i) {
+    const PricePoint &point = state.points[i];
+    if (!point.hasRawPrice || point.startsAt == 0 || point.startsAt <= gHeader.lastSlotStart) continue;
+    const uint32_t dayStart = (uint32_t)localDayStart((time_t)point.startsAt, 0);
+    if (dayStart == 0) continue;
+
+    if (pendingCount > 0 && (dayStart != pendingDay || pendingCount == kMaxDaySamples)) {
+      ok = recordDay(pendingDay, state.resolutionMinutes, pending, pendingCount);
+      pendingCount = 0;
+    }
+    pendingDay = dayStart;
+    pending[pendingCount].slotStart = point.startsAt;
+    pending[pendingCount].value = point.rawPrice;
+    ++pendingCount;
+    ++added;
+  }
+  if (ok && pendingCount > 0) ok = recordDay(pendingDay, state.resolutionMinutes, pending, pendingCount);
+  if (added == 0) return true;
+
+  ok = saveIndex() && ok;
+  if (!ok) {
+    LOG_WARN(Storage, "Price history write failed");
+    return false;
+  }
+  LOG_DEBUG(Storage, "Price history recorded: samples=%u days=%u", (unsigned)added, (unsigned)gHeader.dayCount);
+  return true;
+}
+
+bool priceHistoryStats(uint16_t days, PriceHistoryStats &out) {
+  out = PriceHistoryStats();
+  if (!loadIndex() || gHeader.dayCount == 0) return false;
+
+  int64_t sum = 0;
+  for (uint16_t i = firstQueryDay(days); i < gHeader.dayCount; ++i) {
+    const PriceHistoryDay &day = gDays[i];
+    if (out.samples == 0 || day.min < out.min) out.min = day.min;
+    if (out.samples == 0 || day.max > out.max) out.max = day.max;
+    sum += day.sum;
+    out.samples += day.count;
+    ++out.days;
+  }
+  if (out.samples == 0) return false;
+  const int64_t half = out.samples / 2;
+  out.average = (int32_t)((sum >= 0 ? sum + half : sum - half) / (int64_t)out.samples);
+  return true;
+}
+
+bool priceHistoryPercentiles(uint16_t days, uint16_t minDays, const uint8_t *percents, size_t count, int32_t *out) {
+  PriceHistoryStats stats;
+  if (!priceHistoryStats(days, stats) || stats.days < minDays) return false;
+
+  const uint16_t first = firstQueryDay(days);
+  for (size_t f = 0; f < count; ++f) {
+    // Bisect for the lowest price whose combined CDF, the count-weighted
+    // sum of the per-day CDFs, reaches the percentile.
+    const int64_t target = (int64_t)percents[f] * (kFractionOne / 100) * stats.samples;
+    int32_t lo = stats.min;
+    int32_t hi = stats.max;
+    while (lo < hi) {
+      const int32_t mid = lo + (int32_t)(((int64_t)hi - lo) / 2);
+      int64_t below = 0;
+      for (uint16_t i = first; i < gHeader.dayCount; ++i) {
+        below += dayFractionBelow(gDays[i], mid) * gDays[i].count;
+      }
+      if (below < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    out[f] = lo;
+  }
+  return true;
+}
+
+uint32_t priceHistoryLastSlotStart() {
+  if (!loadIndex() || gHeader.dayCount == 0) return 0;
+  return gHeader.lastSlotStart;
+}
+
+bool priceHistoryForEachSample(uint32_t fromSlotStart, PriceHistorySampleFn fn, void *ctx) {
+  if (!loadIndex()) return false;
+
+  static HistorySample samples[kMaxDaySamples];
+  for (uint16_t i = 0; i < gHeader.dayCount; ++i) {
+    const PriceHistoryDay &day = gDays[i];
+    if (day.dayStart + kMaxDaySec <= fromSlotStart) continue;
+    if (!readDaySamples(day, samples)) return false;
+    for (uint16_t s = 0; s < day.count; ++s) {
+      if (samples[s].slotStart >= fromSlotStart) fn(ctx, samples[s].slotStart, samples[s].value);
+    }
+  }
+  return true;
+}
+
+bool priceHistoryClear() {
+  if (!storageMount()) return false;
+  resetIndex();
+  const bool ok = storageRemove(kHistoryIndexPath) && storageRemove(kHistoryDataPath);
+  if (!ok) {
+    LOG_WARN(Storage, "Price history clear failed");
+    return false;
+  }
+  LOG_INFO(Storage, "Price history cleared");
+  return true;
+}
@@ -1,22 +1,40 @@
 #include "price_state_utils.h"
 
-#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "local_time.h"
 
 namespace {
-bool isSamePoint(const PricePoint &lhs, const PricePoint &rhs) {
-  return lhs.startsAt == rhs.startsAt && lhs.level == rhs.level && fabsf(lhs.price - rhs.price) < 0.0005f;
+constexpr uint32_t kFnvOffset = 2166136261u;
+constexpr uint32_t kFnvPrime = 16777619u;
+
+uint32_t fnvUpdate(uint32_t hash, const void *data, size_t len) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ bytes[i]) * kFnvPrime;
+  }
+  return hash;
+}
+
+template <typename T>
+uint32_t fnvValue(uint32_t hash, const T &value) {
+  return fnvUpdate(hash, &value, sizeof(value));
 }
 
 size_t dayCount(const PriceState &state) {
   if (!state.ok || state.count == 0) return 0;
 
   size_t uniqueDays = 0;
-  String lastDay = "";
+  int lastYear = -1;
+  int lastYday = -1;
   for (size_t i = 0; i < state.count; ++i) {
-    if (state.points[i].startsAt.length() < 10) continue;
-    const String day = state.points[i].startsAt.substring(0, 10);
-    if (day != lastDay) {
-      lastDay = day;
+    const time_t startsAt = (time_t)state.points[i].startsAt;
+    struct tm localTm;
+    if (startsAt == 0 || !localTimeFromUtc(startsAt, localTm)) continue;
+    if (localTm.tm_year != lastYear || localTm.tm_yday != lastYday) {
+      lastYear = localTm.tm_year;
+      lastYday = localTm.tm_yday;
       ++uniqueDays;
     }
   }
@@ -24,19 +42,65 @@ size_t dayCount(const PriceState &state) {
 }
 }  // namespace
 
+const char *priceLevelName(PriceLevel level) {
+  switch (level) {
+    case PriceLevel::VeryCheap: return "VERY_CHEAP";
+    case PriceLevel::Cheap: return "CHEAP";
+    case PriceLevel::Normal: return "NORMAL";
+    case PriceLevel::Expensive: return "EXPENSIVE";
+    case PriceLevel::VeryExpensive: return "VERY_EXPENSIVE";
+    case PriceLevel::Unknown:
+    default: return "UNKNOWN";
+  }
+}
+
+uint32_t priceStateFingerprint(const PriceState &state) {
+  if (state.count == 0) return 0;
+
+  uint32_t hash = kFnvOffset;
+  hash = fnvUpdate(hash, state.area, strnlen(state.area, sizeof(state.area)));
+  hash = fnvUpdate(hash, state.currency, strnlen(state.currency, sizeof(state.currency)));
+  hash = fnvValue(hash, state.resolutionMinutes);
+  hash = fnvValue(hash, (uint8_t)(state.hasRunningAverage ? 1 : 0));
+  if (state.hasRunningAverage) hash = fnvValue(hash, state.runningAverage);
+  hash = fnvValue(hash, (uint32_t)state.count);
+  // Field by field: PricePoint has padding bytes that copies don't preserve.
+  for (size_t i = 0; i < state.count; ++i) {
+    const PricePoint &point = state.points[i];
+    hash = fnvValue(hash, point.startsAt);
+    hash = fnvValue(hash, point.price);
+    hash = fnvValue(hash, (uint8_t)point.level);
+    if (point.hasRawPrice) hash = fnvValue(hash, point.rawPrice);
+  }
+  for (uint8_t a = 0; a < state.extraAreaCount; ++a) {
+    const AreaSeries &series = state.extraAreas[a];
+    hash = fnvUpdate(hash, series.area, strnlen(series.area, sizeof(series.area)));
+    for (size_t i = 0; i < state.count; ++i) {
+      hash = fnvValue(hash, series.rawPrices[i]);
+    }
+  }
+  // 0 is reserved for "no prices".
+  return hash != 0 ? hash : 1;
+}
+
 bool hasNewPriceInfo(const PriceState &fetched, const PriceState &current) {
   if (!fetched.ok || fetched.count == 0) return false;
   if (!current.ok || current.count == 0) return true;
-  if (fetched.count != current.count) return true;
-
-  for (size_t i = 0; i < fetched.count; ++i) {
-    if (!isSamePoint(fetched.points[i], current.points[i])) return true;
-  }
-  return false;
+  return fetched.fingerprint != current.fingerprint;
 }
 
 bool wouldReduceCoverage(const PriceState &fetched, const PriceState &current) {
   if (!fetched.ok || !current.ok || current.count == 0) return false;
+  // Starting inside current and reaching past its end, the fetch only
+  // dropped days that have passed, however many slots those had.
+  if (fetched.count > 0) {
+    const uint32_t fetchedStart = fetched.points[0].startsAt;
+    const uint32_t currentEnd = current.points[current.count - 1].startsAt;
+    if (fetchedStart >= current.points[0].startsAt && fetchedStart <= currentEnd &&
+        fetched.points[fetched.count - 1].startsAt > currentEnd) {
+      return false;
+    }
+  }
   if (fetched.count < current.count) return true;
   return dayCount(fetched) < dayCount(current);
 }
@@ -10,3 +10,65 @@ time_t scheduleAfter(time_t now, time_t delaySec, time_t validEpochMin) {
   return now + delaySec;
 }
 
+void deadlineArmAt(DeadlineQueue &queue, ScheduledTask task, time_t wallAt) {
+  ScheduleEntry &entry = queue.entries[(size_t)task];
+  entry.armed = wallAt != 0;
+  entry.monotonic = false;
+  entry.wallAt = wallAt;
+  entry.monoAtMs = 0;
+}
+
+void deadlineArmAfterMs(DeadlineQueue &queue, ScheduledTask task, uint32_t nowMs, uint32_t delayMs) {
+  ScheduleEntry &entry = queue.entries[(size_t)task];
+  entry.armed = true;
+  entry.monotonic = true;
+  entry.wallAt = 0;
+  entry.monoAtMs = nowMs + delayMs;
+}
+
+void deadlineDisarm(DeadlineQueue &queue, ScheduledTask task) {
+  queue.entries[(size_t)task] = ScheduleEntry();
+}
+
+bool deadlineArmed(const DeadlineQueue &queue, ScheduledTask task) {
+  return queue.entries[(size_t)task].armed;
+}
+
+time_t deadlineWallAt(const DeadlineQueue &queue, ScheduledTask task) {
+  const ScheduleEntry &entry = queue.entries[(size_t)task];
+  return (entry.armed && !entry.monotonic) ? entry.wallAt : 0;
+}
+
+bool deadlineDue(const DeadlineQueue &queue, ScheduledTask task, time_t now, uint32_t nowMs, time_t validEpochMin) {
+  const ScheduleEntry &entry = queue.entries[(size_t)task];
+  if (!entry.armed) return false;
+  // Signed difference keeps millis() wraparound harmless.
+  if (entry.monotonic) return (int32_t)(nowMs - entry.monoAtMs) >= 0;
+  return now > validEpochMin && now >= entry.wallAt;
+}
+
+uint32_t deadlineWaitMs(
+    const DeadlineQueue &queue,
+    int64_t wallNowMs,
+    uint32_t nowMs,
+    time_t validEpochMin,
+    uint32_t ignoreMask,
+    uint32_t maxWaitMs) {
+  const bool clockValid = wallNowMs > (int64_t)validEpochMin * 1000;
+  int64_t waitMs = maxWaitMs;
+  for (size_t i = 0; i < (size_t)ScheduledTask::Count; ++i) {
+    const ScheduleEntry &entry = queue.entries[i];
+    if (!entry.armed || (ignoreMask & (1u << i)) != 0) continue;
+
+    int64_t untilMs = 0;
+    if (entry.monotonic) {
+      untilMs = (int32_t)(entry.monoAtMs - nowMs);
+    } else if (clockValid) {
+      untilMs = ((int64_t)entry.wallAt * 1000) - wallNowMs;
+    } else {
+      continue;
+    }
+    if (untilMs < waitMs) waitMs = untilMs;
+  }
+  return waitMs > 0 ? (uint32_t)waitMs : 0;
+}
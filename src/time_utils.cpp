@@ -1,14 +1,16 @@
 #include "time_utils.h"
 
 #include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "app_types.h"
+#include "local_time.h"
 #include "logging_utils.h"
 
 namespace {
-constexpr char kTimezoneCetCest[] = "CET-1CEST,M3.5.0/2,M10.5.0/3";
-constexpr char kTimezoneEetEest[] = "EET-2EEST,M3.5.0/3,M10.5.0/4";
+ClockSource gClockSource;
 
 bool parseTwoDigits(const char *chars, int &out) {
   if (!isdigit((unsigned char)chars[0]) || !isdigit((unsigned char)chars[1])) {
@@ -27,10 +29,9 @@ bool parseFourDigits(const char *chars, int &out) {
   return true;
 }
 
-bool parseUtcIso(const String &iso, struct tm &tmUtc) {
-  if (iso.length() < 19) return false;
+bool parseUtcIso(const char *s, struct tm &tmUtc) {
+  if (s == nullptr || strlen(s) < 19) return false;
 
-  const char *s = iso.c_str();
   if (s[4] != '-' || s[7] != '-' || s[10] != 'T' || s[13] != ':' || s[16] != ':') {
     return false;
   }
@@ -56,15 +57,6 @@ bool parseUtcIso(const String &iso, struct tm &tmUtc) {
   return true;
 }
 
-int64_t daysFromCivil(int year, unsigned month, unsigned day) {
-  year -= (month <= 2);
-  const int era = (year >= 0 ? year : year - 399) / 400;
-  const unsigned yoe = (unsigned)(year - era * 400);                              // [0, 399]
-  const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1; // [0, 365]
-  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                     // [0, 146096]
-  return era * 146097 + (int64_t)doe - 719468;
-}
-
 time_t utcToEpochSeconds(const struct tm &tmUtc) {
   const int year = tmUtc.tm_year + 1900;
   const unsigned month = (unsigned)tmUtc.tm_mon + 1;
@@ -79,23 +71,49 @@ String dateKeyFromTime(time_t when, time_t validEpochMin) {
   if (!isValidClock(when, validEpochMin)) return "";
 
   struct tm localTm;
-  if (!localtime_r(&when, &localTm)) return "";
+  if (!localTimeFromUtc(when, localTm)) return "";
   char key[11];
   strftime(key, sizeof(key), "%Y-%m-%d", &localTm);
   return String(key);
 }
 
-bool stateContainsDate(const PriceState &state, const String &dateKey) {
-  if (!state.ok || state.count == 0 || dateKey.length() != 10) return false;
+bool stateContainsRange(const PriceState &state, time_t rangeStart, time_t rangeEnd) {
+  if (!state.ok || state.count == 0 || rangeEnd <= rangeStart) return false;
 
   for (size_t i = 0; i < state.count; ++i) {
-    if (state.points[i].startsAt.length() < 10) continue;
-    if (state.points[i].startsAt.substring(0, 10) == dateKey) return true;
+    const time_t startsAt = (time_t)state.points[i].startsAt;
+    if (startsAt >= rangeStart && startsAt < rangeEnd) return true;
   }
   return false;
 }
 }  // namespace
 
+void clockSetSource(const ClockSource *source) {
+  gClockSource = source != nullptr ? *source : ClockSource();
+}
+
+int64_t clockNowMs() {
+  if (gClockSource.wallMs != nullptr) return gClockSource.wallMs();
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return ((int64_t)tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+}
+
+time_t clockNow() {
+  if (gClockSource.wallMs != nullptr) return (time_t)(gClockSource.wallMs() / 1000);
+  return time(nullptr);
+}
+
+uint32_t clockMillis() {
+  return gClockSource.monotonicMs != nullptr ? gClockSource.monotonicMs() : millis();
+}
+
+bool clockIdle(uint32_t ms) {
+  if (gClockSource.idle == nullptr) return false;
+  gClockSource.idle(ms);
+  return true;
+}
+
 uint16_t normalizeResolutionMinutes(uint16_t resolutionMinutes) {
   if (resolutionMinutes == 15 || resolutionMinutes == 30 || resolutionMinutes == 60) {
     return resolutionMinutes;
@@ -109,23 +127,20 @@ bool isValidClock(time_t now, time_t validEpochMin) {
 
 bool formatDateYmd(time_t ts, char *out, size_t outSize) {
   struct tm localTm;
-  if (!localtime_r(&ts, &localTm)) return false;
+  if (!localTimeFromUtc(ts, localTm)) return false;
   return strftime(out, outSize, "%Y-%m-%d", &localTm) > 0;
 }
 
-String utcIsoToLocalIsoSlot(const String &utcIso) {
+time_t utcIsoToEpoch(const char *utcIso) {
   struct tm tmUtc;
-  if (!parseUtcIso(utcIso, tmUtc)) return utcIso;
-
-  const time_t epochUtc = utcToEpochSeconds(tmUtc);
-  if (epochUtc <= 0) return utcIso;
+  if (!parseUtcIso(utcIso, tmUtc)) return 0;
+  return utcToEpochSeconds(tmUtc);
+}
 
+bool formatLocalSlot(time_t ts, char *out, size_t outSize) {
   struct tm localTm;
-  if (!localtime_r(&epochUtc, &localTm)) return utcIso;
-
-  char out[32];
-  strftime(out, sizeof(out), "%Y-%m-%dT%H:%M:00", &localTm);
-  return String(out);
+  if (!localTimeFromUtc(ts, localTm)) return false;
+  return strftime(out, outSize, "%Y-%m-%dT%H:%M", &localTm) > 0;
 }
 
 const char *timezoneSpecForNordpoolArea(const String &area) {
@@ -135,52 +150,65 @@ const char *timezoneSpecForNordpoolArea(const String &area) {
   return kTimezoneCetCest;
 }
 
-String intervalKeyFromIso(const String &iso, uint16_t resolutionMinutes) {
-  if (iso.length() < 13) return "";
+time_t localDayStart(time_t ts, int dayOffset) {
+  struct tm localTm;
+  if (!localTimeFromUtc(ts, localTm)) return 0;
+  localTm.tm_mday += dayOffset;
+  localTm.tm_hour = 0;
+  localTm.tm_min = 0;
+  localTm.tm_sec = 0;
+  return localTimeToUtc(localTm);
+}
 
-  const uint16_t normalizedResolution = normalizeResolutionMinutes(resolutionMinutes);
-  const char *isoChars = iso.c_str();
-  char key[20];
+bool stateCoversRange(const PriceState &state, time_t rangeStart, time_t rangeEnd) {
+  if (!state.ok || state.count == 0 || rangeEnd <= rangeStart) return false;
 
-  if (normalizedResolution >= 60 || iso.length() < 16) {
-    memcpy(key, isoChars, 13);
-    key[13] = '\0';
-    return String(key);
+  const time_t resolutionSec = (time_t)normalizeResolutionMinutes(state.resolutionMinutes) * 60;
+  const size_t expected = (size_t)((rangeEnd - rangeStart) / resolutionSec);
+  size_t found = 0;
+  for (size_t i = 0; i < state.count; ++i) {
+    const time_t startsAt = (time_t)state.points[i].startsAt;
+    if (startsAt >= rangeStart && startsAt < rangeEnd) ++found;
   }
+  return found >= expected;
+}
 
-  int minute = 0;
-  if (!parseTwoDigits(&isoChars[14], minute)) {
-    minute = 0;
-  }
-  const int slotMinute = minute - (minute % normalizedResolution);
-  snprintf(key, sizeof(key), "%.13s:%02d", isoChars, slotMinute);
-  return String(key);
+time_t intervalStartForTime(time_t ts, uint16_t resolutionMinutes) {
+  // Nord Pool zones are offset from UTC by whole hours, so aligning the UTC
+  // epoch to 15/30/60 minutes gives the same slot boundaries as local time.
+  const time_t resolutionSec = (time_t)normalizeResolutionMinutes(resolutionMinutes) * 60;
+  return ts - (ts % resolutionSec);
 }
 
-String currentIntervalKey(uint16_t resolutionMinutes) {
-  time_t now = time(nullptr);
-  if (now < kValidEpochMin) return "";
+void updatePriceStateSlotIndex(PriceState &state) {
+  state.slotBaseStartsAt = 0;
+  state.slotsUniform = false;
+  if (state.count == 0) return;
 
-  struct tm localTm;
-  localtime_r(&now, &localTm);
+  const uint32_t resolutionSec = (uint32_t)normalizeResolutionMinutes(state.resolutionMinutes) * 60;
+  const uint32_t base = state.points[0].startsAt;
+  if (base == 0 || (base % resolutionSec) != 0) return;
 
-  const uint16_t normalizedResolution = normalizeResolutionMinutes(resolutionMinutes);
-  const int slotMinute = localTm.tm_min - (localTm.tm_min % normalizedResolution);
-  char key[20];
-  if (normalizedResolution >= 60) {
-    strftime(key, sizeof(key), "%Y-%m-%dT%H", &localTm);
-  } else {
-    char hourPrefix[20];
-    strftime(hourPrefix, sizeof(hourPrefix), "%Y-%m-%dT%H", &localTm);
-    snprintf(key, sizeof(key), "%s:%02d", hourPrefix, slotMinute);
+  state.slotBaseStartsAt = base;
+  for (size_t i = 1; i < state.count; ++i) {
+    if (state.points[i].startsAt != base + (uint32_t)i * resolutionSec) return;
   }
-  return String(key);
+  state.slotsUniform = true;
 }
 
-int findPricePointIndexForInterval(const PriceState &state, const String &intervalKey, uint16_t resolutionMinutes) {
-  if (intervalKey.isEmpty()) return -1;
+int findPricePointIndexForInterval(const PriceState &state, time_t intervalStart, uint16_t resolutionMinutes) {
+  if (intervalStart <= 0 || state.count == 0) return -1;
+
+  const uint16_t normalizedResolution = normalizeResolutionMinutes(resolutionMinutes);
+  if (state.slotsUniform && normalizedResolution == normalizeResolutionMinutes(state.resolutionMinutes)) {
+    if (intervalStart < (time_t)state.slotBaseStartsAt) return -1;
+    const size_t idx = (size_t)((intervalStart - (time_t)state.slotBaseStartsAt) / ((time_t)normalizedResolution * 60));
+    return idx < state.count ? (int)idx : -1;
+  }
+
+  // Gapped or mixed-resolution series: fall back to a scan.
   for (size_t i = 0; i < state.count; ++i) {
-    if (intervalKeyFromIso(state.points[i].startsAt, resolutionMinutes) == intervalKey) {
+    if (intervalStartForTime((time_t)state.points[i].startsAt, normalizedResolution) == intervalStart) {
       return (int)i;
     }
   }
@@ -188,9 +216,9 @@ int findPricePointIndexForInterval(const PriceState &state, const String &interv
 }
 
 int findCurrentPricePointIndex(const PriceState &state, uint16_t resolutionMinutes) {
-  const String key = currentIntervalKey(resolutionMinutes);
-  if (key.isEmpty()) return -1;
-  return findPricePointIndexForInterval(state, key, resolutionMinutes);
+  const time_t now = clockNow();
+  if (now < kValidEpochMin) return -1;
+  return findPricePointIndexForInterval(state, intervalStartForTime(now, resolutionMinutes), resolutionMinutes);
 }
 
 bool shouldCatchUpMissedDailyUpdate(
@@ -202,27 +230,25 @@ bool shouldCatchUpMissedDailyUpdate(
   if (!isValidClock(now, validEpochMin)) return false;
 
   struct tm tmToday;
-  localtime_r(&now, &tmToday);
+  if (!localTimeFromUtc(now, tmToday)) return false;
   tmToday.tm_hour = dailyFetchHour;
   tmToday.tm_min = dailyFetchMinute;
   tmToday.tm_sec = 0;
-  const time_t todayFetchTime = mktime(&tmToday);
-  if (todayFetchTime == (time_t)-1 || now < todayFetchTime) return false;
-
-  struct tm tmTomorrow = tmToday;
-  tmTomorrow.tm_mday += 1;
-  tmTomorrow.tm_hour = 0;
-  tmTomorrow.tm_min = 0;
-  tmTomorrow.tm_sec = 0;
-  const time_t tomorrow = mktime(&tmTomorrow);
+  const time_t todayFetchTime = localTimeToUtc(tmToday);
+  if (todayFetchTime == 0 || now < todayFetchTime) return false;
+
+  const time_t tomorrow = localDayStart(now, 1);
   if (!isValidClock(tomorrow, validEpochMin)) return false;
+  const time_t dayAfter = localDayStart(now, 2);
+  if (!isValidClock(dayAfter, validEpochMin)) return false;
 
   const String tomorrowDate = dateKeyFromTime(tomorrow, validEpochMin);
   if (tomorrowDate.isEmpty()) return false;
 
-  const bool hasTomorrow = stateContainsDate(state, tomorrowDate);
+  const bool hasTomorrow = stateContainsRange(state, tomorrow, dayAfter);
   if (!hasTomorrow) {
-    logf(
+    LOG_INFO(
+        App,
         "After %02d:%02d and cache is missing %s, catch-up fetch needed",
         dailyFetchHour,
         dailyFetchMinute,
@@ -231,31 +257,38 @@ bool shouldCatchUpMissedDailyUpdate(
   return !hasTomorrow;
 }
 
+void selectTimezone(const char *timezoneSpec) {
+  if (timezoneSpec == nullptr) return;
+  setenv("TZ", timezoneSpec, 1);
+  tzset();
+  localTimeSetZone(timezoneSpec);
+}
+
 void syncClock(const char *timezoneSpec) {
-  logf("Clock sync start: tz=%s", timezoneSpec ? timezoneSpec : "(null)");
+  LOG_INFO(Net, "Clock sync start: tz=%s", timezoneSpec ? timezoneSpec : "(null)");
   configTzTime(timezoneSpec, "pool.ntp.org", "time.nist.gov");
+  localTimeSetZone(timezoneSpec);
   for (int i = 0; i < 20; ++i) {
     if (time(nullptr) > 1700000000) break;
     delay(250);
   }
-  logf("Clock sync status: now=%ld", (long)time(nullptr));
+  LOG_DEBUG(Net, "Clock sync status: now=%ld", (long)time(nullptr));
 }
 
 time_t scheduleNextDailyFetch(time_t now, int hour, int minute) {
   if (now < kValidEpochMin) return 0;
 
   struct tm tmTarget;
-  if (!localtime_r(&now, &tmTarget)) return 0;
+  if (!localTimeFromUtc(now, tmTarget)) return 0;
   tmTarget.tm_hour = hour;
   tmTarget.tm_min = minute;
   tmTarget.tm_sec = 0;
 
-  time_t next = mktime(&tmTarget);
-  if (next == (time_t)-1) return 0;
+  time_t next = localTimeToUtc(tmTarget);
+  if (next == 0) return 0;
   if (next <= now) {
     tmTarget.tm_mday += 1;
-    next = mktime(&tmTarget);
-    if (next == (time_t)-1) return 0;
+    next = localTimeToUtc(tmTarget);
   }
   return next;
 }
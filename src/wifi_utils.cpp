@@ -2,11 +2,13 @@
 #include <Preferences.h>
 #include <WiFi.h>
 #include <WiFiManager.h>
+#include <atomic>
 #include <ctype.h>
 #include <inttypes.h>
 #include <math.h>
 #include <stdlib.h>
 
+#include "app_types.h"
 #include "display_ui.h"
 #include "logging_utils.h"
 #include "time_utils.h"
@@ -17,6 +19,7 @@ namespace
   constexpr char kPrefsNamespace[] = "elcfg";
   constexpr char kApiUrlKey[] = "np_apiurl";
   constexpr char kAreaKey[] = "np_area";
+  constexpr char kExtraAreasKey[] = "np_xareas";
   constexpr char kCurrencyKey[] = "np_curr";
   constexpr char kResolutionKey[] = "np_res";
   constexpr char kVatPercentKey[] = "np_vat";
@@ -37,6 +40,7 @@ namespace
   constexpr size_t kNordpoolCurrencyCount = sizeof(kNordpoolCurrencies) / sizeof(kNordpoolCurrencies[0]);
   constexpr size_t kApiUrlMaxLen = 127;
   constexpr size_t kAreaMaxLen = 8;
+  constexpr size_t kExtraAreasMaxLen = kMaxAreas * kStateAreaLen - 1;
   constexpr size_t kCurrencyMaxLen = 8;
   constexpr size_t kResolutionMaxLen = 4;
   constexpr size_t kVatPercentMaxLen = 16;
@@ -45,6 +49,17 @@ namespace
 
   bool gSaveConfigRequested = false;
   uint32_t gLastReconnectAttemptMs = 0;
+  // Who is driving the station: the worker's reconnects and the loop's
+  // background portal each claim it with a compare-exchange, so neither
+  // starts while the other is mid-way. Failures are counted for the loop.
+  enum RadioOwner : uint8_t
+  {
+    kRadioFree = 0,
+    kRadioReconnect,
+    kRadioPortal,
+  };
+  std::atomic<uint8_t> gRadioOwner{kRadioFree};
+  std::atomic<uint8_t> gReconnectFailures{0};
 
   constexpr char kPortalCustomHead[] PROGMEM = R"HTML(
 <script>
@@ -130,6 +145,33 @@ namespace
     return value;
   }
 
+  // Keeps known areas other than the primary, once each, up to kMaxExtraAreas.
+  String normalizeExtraAreas(const String &value, const String &primaryArea)
+  {
+    String result;
+    size_t kept = 0;
+    int start = 0;
+    while (start <= (int)value.length() && kept < kMaxExtraAreas)
+    {
+      int end = value.indexOf(',', start);
+      if (end < 0)
+        end = value.length();
+      String area = value.substring(start, end);
+      start = end + 1;
+      area.trim();
+      area.toUpperCase();
+      if (area.isEmpty() || area == primaryArea || !isAllowedToken(area, kNordpoolAreas, kNordpoolAreaCount))
+        continue;
+      if (("," + result + ",").indexOf("," + area + ",") >= 0)
+        continue;
+      if (!result.isEmpty())
+        result += ",";
+      result += area;
+      ++kept;
+    }
+    return result;
+  }
+
   uint16_t parseResolutionToken(const String &value)
   {
     String parsed = value;
@@ -178,6 +220,7 @@ namespace
       secrets.nordpoolApiUrl = kDefaultNordpoolApiUrl;
     secrets.nordpoolArea =
         normalizeToken(secrets.nordpoolArea, kDefaultNordpoolArea, kAreaMaxLen, kNordpoolAreas, kNordpoolAreaCount);
+    secrets.nordpoolExtraAreas = normalizeExtraAreas(secrets.nordpoolExtraAreas, secrets.nordpoolArea);
     secrets.nordpoolCurrency = normalizeToken(
         secrets.nordpoolCurrency,
         kDefaultNordpoolCurrency,
@@ -209,31 +252,154 @@ namespace
     Preferences prefs;
     if (!prefs.begin(kPrefsNamespace, false))
     {
-      logf("Secrets save failed: prefs begin");
+      LOG_ERROR(Storage, "Secrets save failed: prefs begin");
       return;
     }
     prefs.putString(kApiUrlKey, secrets.nordpoolApiUrl);
     prefs.putString(kAreaKey, secrets.nordpoolArea);
+    prefs.putString(kExtraAreasKey, secrets.nordpoolExtraAreas);
     prefs.putString(kCurrencyKey, secrets.nordpoolCurrency);
     prefs.putUShort(kResolutionKey, secrets.nordpoolResolutionMinutes);
     prefs.putFloat(kVatPercentKey, secrets.vatPercent);
     prefs.putFloat(kFixedCostPerKwhKey, secrets.fixedCostPerKwh);
     prefs.end();
-    logf(
-        "Secrets saved: area=%s currency=%s resolution=%u vat=%.2f%% fixed_minor_kwh=%.2f",
+    LOG_INFO(
+        Storage,
+        "Secrets saved: area=%s extra_areas=%s currency=%s resolution=%u vat=%.2f%% fixed_minor_kwh=%.2f",
         secrets.nordpoolArea.c_str(),
+        secrets.nordpoolExtraAreas.c_str(),
         secrets.nordpoolCurrency.c_str(),
         (unsigned)secrets.nordpoolResolutionMinutes,
         secrets.vatPercent,
         secrets.fixedCostPerKwh);
   }
 
+  // The portal fields' initial values. Filled before the parameters are
+  // built, since WiFiManagerParameter copies its default on construction.
+  struct PortalDefaults
+  {
+    char apiUrl[kApiUrlMaxLen + 1];
+    char area[kAreaMaxLen + 1];
+    char extraAreas[kExtraAreasMaxLen + 1];
+    char currency[kCurrencyMaxLen + 1];
+    char resolution[kResolutionMaxLen + 1];
+    char vatPercent[kVatPercentMaxLen + 1];
+    char fixedCostPerKwh[kFixedCostPerKwhMaxLen + 1];
+    char apName[32];
+
+    explicit PortalDefaults(const AppSecrets &secrets)
+    {
+      secrets.nordpoolApiUrl.toCharArray(apiUrl, sizeof(apiUrl));
+      secrets.nordpoolArea.toCharArray(area, sizeof(area));
+      secrets.nordpoolExtraAreas.toCharArray(extraAreas, sizeof(extraAreas));
+      secrets.nordpoolCurrency.toCharArray(currency, sizeof(currency));
+      snprintf(resolution, sizeof(resolution), "%u", (unsigned)secrets.nordpoolResolutionMinutes);
+      snprintf(vatPercent, sizeof(vatPercent), "%.2f", secrets.vatPercent);
+      snprintf(fixedCostPerKwh, sizeof(fixedCostPerKwh), "%.4f", secrets.fixedCostPerKwh);
+      snprintf(apName, sizeof(apName), "ElMeter-%" PRIx64, ESP.getEfuseMac());
+    }
+  };
+
+  // One config portal run: the WiFiManager with the Nord Pool settings as
+  // custom parameters.
+  struct PortalSession : PortalDefaults
+  {
+    WiFiManager manager;
+    WiFiManagerParameter apiUrlParam;
+    WiFiManagerParameter areaParam;
+    WiFiManagerParameter extraAreasParam;
+    WiFiManagerParameter currencyParam;
+    WiFiManagerParameter resolutionParam;
+    WiFiManagerParameter vatPercentParam;
+    WiFiManagerParameter fixedCostPerKwhParam;
+
+    PortalSession(const AppSecrets &secrets, uint16_t portalTimeoutSeconds)
+        : PortalDefaults(secrets),
+          apiUrlParam("NordPoolApiUrl", "Nord Pool API URL:", apiUrl, sizeof(apiUrl)),
+          areaParam("NordPoolArea", "Nord Pool area:", area, sizeof(area)),
+          extraAreasParam(
+              "NordPoolExtraAreas",
+              "Extra areas, comma-separated (optional):",
+              extraAreas,
+              sizeof(extraAreas)),
+          currencyParam("NordPoolCurrency", "currency:", currency, sizeof(currency)),
+          resolutionParam("NordPoolResolution", "Resolution (minutes):", resolution, sizeof(resolution)),
+          vatPercentParam("VatPercent", "VAT (%):", vatPercent, sizeof(vatPercent)),
+          fixedCostPerKwhParam(
+              "FixedCostPerKwh",
+              "Total fixed cost / kWh (cents):",
+              fixedCostPerKwh,
+              sizeof(fixedCostPerKwh))
+    {
+      gSaveConfigRequested = false;
+      manager.addParameter(&apiUrlParam);
+      manager.addParameter(&areaParam);
+      manager.addParameter(&extraAreasParam);
+      manager.addParameter(&currencyParam);
+      manager.addParameter(&resolutionParam);
+      manager.addParameter(&vatPercentParam);
+      manager.addParameter(&fixedCostPerKwhParam);
+      manager.setConfigPortalTimeout(portalTimeoutSeconds);
+      manager.setSaveConfigCallback(saveConfigCallback);
+      manager.setCustomHeadElement(kPortalCustomHead);
+      manager.setDarkMode(true);
+    }
+
+    // Takes over what was saved in the portal, if anything, once connected.
+    void applySaved(AppSecrets &secrets)
+    {
+      if (!gSaveConfigRequested)
+      {
+        normalizeSecrets(secrets);
+        return;
+      }
+      secrets.nordpoolApiUrl = String(apiUrlParam.getValue());
+      secrets.nordpoolArea = String(areaParam.getValue());
+      secrets.nordpoolExtraAreas = String(extraAreasParam.getValue());
+      secrets.nordpoolCurrency = String(currencyParam.getValue());
+      secrets.nordpoolResolutionMinutes = parseResolutionToken(String(resolutionParam.getValue()));
+      secrets.vatPercent = parseFloatToken(String(vatPercentParam.getValue()), secrets.vatPercent);
+      secrets.fixedCostPerKwh = parseFloatToken(String(fixedCostPerKwhParam.getValue()), secrets.fixedCostPerKwh);
+      normalizeSecrets(secrets);
+      saveSecretsToPrefs(secrets);
+      gSaveConfigRequested = false;
+    }
+  };
+
+  PortalSession *gBackgroundPortal = nullptr;
+
+  void logConnected(const AppSecrets &secrets)
+  {
+    LOG_INFO(
+        Net,
+        "WiFi connected: ssid='%s' ip=%s area=%s extra_areas=%s currency=%s resolution=%u vat=%.2f%% "
+        "fixed_minor_kwh=%.2f",
+        WiFi.SSID().c_str(),
+        WiFi.localIP().toString().c_str(),
+        secrets.nordpoolArea.c_str(),
+        secrets.nordpoolExtraAreas.c_str(),
+        secrets.nordpoolCurrency.c_str(),
+        (unsigned)secrets.nordpoolResolutionMinutes,
+        secrets.vatPercent,
+        secrets.fixedCostPerKwh);
+  }
+
+  void closeBackgroundPortal()
+  {
+    delete gBackgroundPortal;
+    gBackgroundPortal = nullptr;
+    gRadioOwner.store(kRadioFree);
+    gReconnectFailures.store(0);
+    displaySetNotice(nullptr);
+  }
+
 } // namespace
 
 void loadAppSecrets(AppSecrets &out)
 {
   out.nordpoolApiUrl = kDefaultNordpoolApiUrl;
   out.nordpoolArea = kDefaultNordpoolArea;
+  out.nordpoolExtraAreas = "";
   out.nordpoolCurrency = kDefaultNordpoolCurrency;
   out.nordpoolResolutionMinutes = kDefaultNordpoolResolutionMinutes;
   out.vatPercent = kDefaultVatPercent;
@@ -244,6 +410,7 @@ void loadAppSecrets(AppSecrets &out)
   {
     out.nordpoolApiUrl = prefs.getString(kApiUrlKey, out.nordpoolApiUrl);
     out.nordpoolArea = prefs.getString(kAreaKey, out.nordpoolArea);
+    out.nordpoolExtraAreas = prefs.getString(kExtraAreasKey, out.nordpoolExtraAreas);
     out.nordpoolCurrency = prefs.getString(kCurrencyKey, out.nordpoolCurrency);
     out.nordpoolResolutionMinutes = prefs.getUShort(kResolutionKey, out.nordpoolResolutionMinutes);
     if (prefs.isKey(kVatPercentKey))
@@ -281,95 +448,90 @@ bool wifiConnectWithConfigPortal(AppSecrets &secrets, uint16_t portalTimeoutSeco
 
   WiFi.mode(WIFI_STA);
 
-  char apiUrlBuffer[kApiUrlMaxLen + 1];
-  char areaBuffer[kAreaMaxLen + 1];
-  char currencyBuffer[kCurrencyMaxLen + 1];
-  char resolutionBuffer[kResolutionMaxLen + 1];
-  char vatPercentBuffer[kVatPercentMaxLen + 1];
-  char fixedCostPerKwhBuffer[kFixedCostPerKwhMaxLen + 1];
-  secrets.nordpoolApiUrl.toCharArray(apiUrlBuffer, sizeof(apiUrlBuffer));
-  secrets.nordpoolArea.toCharArray(areaBuffer, sizeof(areaBuffer));
-  secrets.nordpoolCurrency.toCharArray(currencyBuffer, sizeof(currencyBuffer));
-  snprintf(resolutionBuffer, sizeof(resolutionBuffer), "%u", (unsigned)secrets.nordpoolResolutionMinutes);
-  snprintf(vatPercentBuffer, sizeof(vatPercentBuffer), "%.2f", secrets.vatPercent);
-  snprintf(fixedCostPerKwhBuffer, sizeof(fixedCostPerKwhBuffer), "%.4f", secrets.fixedCostPerKwh);
+  PortalSession session(secrets, portalTimeoutSeconds);
+  const String apNameString(session.apName);
+  session.manager.setAPCallback([apNameString, portalTimeoutSeconds](WiFiManager *)
+                                { displayDrawWifiConfigPortal(apNameString.c_str(), portalTimeoutSeconds); });
+  session.manager.setConfigPortalTimeoutCallback([portalTimeoutSeconds]()
+                                                 { displayDrawWifiConfigTimeout(portalTimeoutSeconds); });
 
-  WiFiManager wifiManager;
-  WiFiManagerParameter apiUrlParam("NordPoolApiUrl", "Nord Pool API URL:", apiUrlBuffer, sizeof(apiUrlBuffer));
-  WiFiManagerParameter areaParam("NordPoolArea", "Nord Pool area:", areaBuffer, sizeof(areaBuffer));
-  WiFiManagerParameter currencyParam("NordPoolCurrency", "currency:", currencyBuffer, sizeof(currencyBuffer));
-  WiFiManagerParameter resolutionParam(
-      "NordPoolResolution",
-      "Resolution (minutes):",
-      resolutionBuffer,
-      sizeof(resolutionBuffer));
-  WiFiManagerParameter vatPercentParam(
-      "VatPercent",
-      "VAT (%):",
-      vatPercentBuffer,
-      sizeof(vatPercentBuffer));
-  WiFiManagerParameter fixedCostPerKwhParam(
-      "FixedCostPerKwh",
-      "Total fixed cost / kWh (cents):",
-      fixedCostPerKwhBuffer,
-      sizeof(fixedCostPerKwhBuffer));
-
-  gSaveConfigRequested = false;
-  wifiManager.addParameter(&apiUrlParam);
-  wifiManager.addParameter(&areaParam);
-  wifiManager.addParameter(&currencyParam);
-  wifiManager.addParameter(&resolutionParam);
-  wifiManager.addParameter(&vatPercentParam);
-  wifiManager.addParameter(&fixedCostPerKwhParam);
-  wifiManager.setConfigPortalTimeout(portalTimeoutSeconds);
-  wifiManager.setSaveConfigCallback(saveConfigCallback);
-  wifiManager.setCustomHeadElement(kPortalCustomHead);
-  wifiManager.setDarkMode(true);
-
-  char apName[32];
-  snprintf(apName, sizeof(apName), "ElMeter-%" PRIx64, ESP.getEfuseMac());
-  const String apNameString(apName);
-
-  wifiManager.setAPCallback([apNameString, portalTimeoutSeconds](WiFiManager *)
-                            { displayDrawWifiConfigPortal(apNameString.c_str(), portalTimeoutSeconds); });
-  wifiManager.setConfigPortalTimeoutCallback([portalTimeoutSeconds]()
-                                             { displayDrawWifiConfigTimeout(portalTimeoutSeconds); });
-
-  logf("WiFiManager autoConnect start: AP='%s' timeout=%us", apName, (unsigned)portalTimeoutSeconds);
-  if (!wifiManager.autoConnect(apName))
+  LOG_INFO(Net, "WiFiManager autoConnect start: AP='%s' timeout=%us", session.apName, (unsigned)portalTimeoutSeconds);
+  if (!session.manager.autoConnect(session.apName))
   {
-    logf("WiFiManager failed or timed out");
+    LOG_WARN(Net, "WiFiManager failed or timed out");
     return false;
   }
 
-  if (gSaveConfigRequested)
+  session.applySaved(secrets);
+  logConnected(secrets);
+  return true;
+}
+
+bool wifiConfigPortalStart(const AppSecrets &secrets, uint16_t portalTimeoutSeconds)
+{
+  if (gBackgroundPortal != nullptr)
+    return true;
+
+  // A reconnect in progress would switch the radio back to STA under the
+  // portal; the caller tries again once it has finished.
+  uint8_t expected = kRadioFree;
+  if (!gRadioOwner.compare_exchange_strong(expected, kRadioPortal))
   {
-    secrets.nordpoolApiUrl = String(apiUrlParam.getValue());
-    secrets.nordpoolArea = String(areaParam.getValue());
-    secrets.nordpoolCurrency = String(currencyParam.getValue());
-    secrets.nordpoolResolutionMinutes = parseResolutionToken(String(resolutionParam.getValue()));
-    secrets.vatPercent = parseFloatToken(String(vatPercentParam.getValue()), secrets.vatPercent);
-    secrets.fixedCostPerKwh = parseFloatToken(String(fixedCostPerKwhParam.getValue()), secrets.fixedCostPerKwh);
-    normalizeSecrets(secrets);
-    saveSecretsToPrefs(secrets);
-    gSaveConfigRequested = false;
+    LOG_DEBUG(Net, "WiFi config portal deferred: reconnect in progress");
+    return false;
   }
-  else
+  gBackgroundPortal = new PortalSession(secrets, portalTimeoutSeconds);
+  gBackgroundPortal->manager.setConfigPortalBlocking(false);
+  gBackgroundPortal->manager.startConfigPortal(gBackgroundPortal->apName);
+  if (!gBackgroundPortal->manager.getConfigPortalActive())
   {
-    normalizeSecrets(secrets);
+    LOG_ERROR(Net, "WiFi config portal failed to start");
+    closeBackgroundPortal();
+    return false;
   }
 
-  logf("WiFi connected: ssid='%s' ip=%s area=%s currency=%s resolution=%u vat=%.2f%% fixed_minor_kwh=%.2f",
-       WiFi.SSID().c_str(),
-       WiFi.localIP().toString().c_str(),
-       secrets.nordpoolArea.c_str(),
-       secrets.nordpoolCurrency.c_str(),
-       (unsigned)secrets.nordpoolResolutionMinutes,
-       secrets.vatPercent,
-       secrets.fixedCostPerKwh);
+  char notice[48];
+  snprintf(notice, sizeof(notice), "Wi-Fi setup: join %s", gBackgroundPortal->apName);
+  displaySetNotice(notice);
+  LOG_INFO(
+      Net,
+      "WiFi config portal open beside cached prices: AP='%s' timeout=%us",
+      gBackgroundPortal->apName,
+      (unsigned)portalTimeoutSeconds);
   return true;
 }
 
+WifiPortalState wifiConfigPortalProcess(AppSecrets &secrets)
+{
+  if (gBackgroundPortal == nullptr)
+    return WifiPortalState::Idle;
+
+  if (gBackgroundPortal->manager.process())
+  {
+    gBackgroundPortal->applySaved(secrets);
+    logConnected(secrets);
+    closeBackgroundPortal();
+    return WifiPortalState::Connected;
+  }
+  if (!gBackgroundPortal->manager.getConfigPortalActive())
+  {
+    LOG_INFO(Net, "WiFi config portal closed without new settings");
+    closeBackgroundPortal();
+    return WifiPortalState::Closed;
+  }
+  return WifiPortalState::Open;
+}
+
+uint8_t wifiReconnectFailures()
+{
+  return gReconnectFailures.load();
+}
+
+bool wifiReconnectInProgress()
+{
+  return gRadioOwner.load() == kRadioReconnect;
+}
+
 bool wifiReconnect(uint32_t timeoutMs)
 {
   if (WiFi.status() == WL_CONNECTED)
@@ -378,23 +540,37 @@ bool wifiReconnect(uint32_t timeoutMs)
   }
 
   const uint32_t now = millis();
-  if (now - gLastReconnectAttemptMs < kReconnectCooldownMs)
+  // The first attempt is never held back, so a fast boot connects at once.
+  if (gLastReconnectAttemptMs != 0 && now - gLastReconnectAttemptMs < kReconnectCooldownMs)
+  {
+    return false;
+  }
+
+  // Stands down while a background portal owns the radio.
+  uint8_t expected = kRadioFree;
+  if (!gRadioOwner.compare_exchange_strong(expected, kRadioReconnect))
   {
     return false;
   }
   gLastReconnectAttemptMs = now;
 
   WiFi.mode(WIFI_STA);
-  logf("WiFi reconnect start");
+  LOG_DEBUG(Net, "WiFi reconnect start");
   WiFi.begin();
 
-  if (waitForConnection(timeoutMs))
+  const bool connected = waitForConnection(timeoutMs);
+  gRadioOwner.store(kRadioFree);
+  if (connected)
   {
-    logf("WiFi connected: ip=%s rssi=%d", WiFi.localIP().toString().c_str(), WiFi.RSSI());
+    LOG_INFO(Net, "WiFi connected: ip=%s rssi=%d", WiFi.localIP().toString().c_str(), WiFi.RSSI());
+    gReconnectFailures.store(0);
     return true;
   }
 
-  logf("WiFi reconnect timeout: status=%d", WiFi.status());
+  const uint8_t failures = gReconnectFailures.load();
+  if (failures < UINT8_MAX)
+    gReconnectFailures.store(failures + 1);
+  LOG_WARN(Net, "WiFi reconnect timeout: status=%d", WiFi.status());
   return false;
 }
 
@@ -0,0 +1,173 @@
+// Host microbenchmarks for the per-slot and per-fetch hot paths, over
+// two-day 15-minute datasets: a plain pair of days (192 points) and the
+// pairs starting on the CET/CEST switch days (92 + 96 and 100 + 96).
+// Build and run with `pio run -e native_bench -t exec`. Each line is the
+// best of kRepeats timed runs, in nanoseconds per call.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "bar_colors.h"
+#include "nordpool_parser.h"
+#include "price_fixtures.h"
+#include "price_state_utils.h"
+#include "time_utils.h"
+
+namespace {
+typedef std::chrono::steady_clock BenchClock;
+
+constexpr int kRepeats = 7;
+constexpr size_t kParserChunkBytes = 512;  // nordpool_client's stream chunk
+
+struct Dataset {
+  const char *name;
+  FixtureDay first;
+};
+
+const Dataset kDatasets[] = {
+    {"plain", kFixturePlainDay},
+    {"spring-dst", kFixtureSpringForward},
+    {"fall-dst", kFixtureFallBack},
+};
+
+PriceState gState;
+PriceState gOther;
+volatile uint32_t gSink = 0;
+
+// Calls `body` `calls` times per run and returns the best ns per call.
+template <typename Body>
+double bestNsPerCall(size_t calls, Body body) {
+  double best = 0;
+  for (int r = 0; r < kRepeats; ++r) {
+    const BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < calls; ++i) body(i);
+    const double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() / (double)calls;
+    if (r == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+void report(const char *bench, const Dataset &dataset, size_t points, double ns) {
+  printf("%-28s %-11s points=%3u %12.1f ns/op\n", bench, dataset.name, (unsigned)points, ns);
+}
+
+void benchSlotLookup(const Dataset &dataset) {
+  fillFixtureDays(gState, dataset.first, 2);
+  const size_t count = gState.count;
+  double ns = bestNsPerCall(count * 200, [count](size_t i) {
+    const time_t slot = (time_t)gState.points[i % count].startsAt;
+    gSink += (uint32_t)findPricePointIndexForInterval(gState, slot, 15);
+  });
+  report("slot lookup (uniform)", dataset, count, ns);
+
+  ns = bestNsPerCall(count * 200, [count](size_t i) {
+    const time_t now = (time_t)gState.points[i % count].startsAt + 7 * 60;
+    gSink += (uint32_t)findPricePointIndexForInterval(gState, intervalStartForTime(now, 15), 15);
+  });
+  report("slot lookup from clock", dataset, count, ns);
+
+  // Hourly view over a 15-minute series always takes the scan.
+  ns = bestNsPerCall(count * 20, [count](size_t i) {
+    const time_t slot = (time_t)gState.points[i % count].startsAt;
+    gSink += (uint32_t)findPricePointIndexForInterval(gState, intervalStartForTime(slot, 60), 60);
+  });
+  report("slot lookup (scan)", dataset, count, ns);
+}
+
+void benchStateUtils(const Dataset &dataset) {
+  fillFixtureDays(gState, dataset.first, 2);
+  fillFixtureDays(gOther, dataset.first, 1);
+  const size_t count = gState.count;
+  double ns = bestNsPerCall(2000, [](size_t) {
+    updatePriceStateSlotIndex(gState);
+    gSink += gState.slotsUniform ? 1 : 0;
+  });
+  report("updatePriceStateSlotIndex", dataset, count, ns);
+
+  ns = bestNsPerCall(2000, [](size_t) { gSink += priceStateFingerprint(gState); });
+  report("priceStateFingerprint", dataset, count, ns);
+
+  ns = bestNsPerCall(20000, [](size_t) { gSink += hasNewPriceInfo(gState, gOther) ? 1 : 0; });
+  report("hasNewPriceInfo", dataset, count, ns);
+
+  ns = bestNsPerCall(2000, [](size_t) { gSink += wouldReduceCoverage(gState, gOther) ? 1 : 0; });
+  report("wouldReduceCoverage", dataset, count, ns);
+}
+
+void benchBarColors(const Dataset &dataset) {
+  fillFixtureDays(gState, dataset.first, 2);
+  const size_t count = gState.count;
+  int32_t low = gState.points[0].price;
+  int32_t high = low;
+  for (size_t i = 0; i < count; ++i) {
+    low = std::min(low, gState.points[i].price);
+    high = std::max(high, gState.points[i].price);
+  }
+  const double ns = bestNsPerCall(2000, [count, low, high](size_t) {
+    LevelBand bands[kLevelBandCount];
+    computeLevelBands(gState, bands);
+    for (size_t i = 0; i < count; ++i) gSink += barGradientColor(gState.points[i], bands, low, high - low);
+  });
+  report("bar colours (whole chart)", dataset, count, ns);
+}
+
+void benchSlotText(const Dataset &dataset) {
+  fillFixtureDays(gState, dataset.first, 2);
+  const size_t count = gState.count;
+  char isoSlots[kMaxPoints][24];
+  for (size_t i = 0; i < count; ++i) {
+    const time_t slot = (time_t)gState.points[i].startsAt;
+    struct tm utcTm;
+    gmtime_r(&slot, &utcTm);
+    strftime(isoSlots[i], sizeof(isoSlots[i]), "%Y-%m-%dT%H:%M:%SZ", &utcTm);
+  }
+  double ns = bestNsPerCall(count * 100, [count, &isoSlots](size_t i) {
+    gSink += (uint32_t)utcIsoToEpoch(isoSlots[i % count]);
+  });
+  report("utcIsoToEpoch", dataset, count, ns);
+
+  ns = bestNsPerCall(count * 100, [count](size_t i) {
+    char text[20];
+    gSink += formatLocalSlot((time_t)gState.points[i % count].startsAt, text, sizeof(text)) ? (uint8_t)text[15] : 0;
+  });
+  report("formatLocalSlot", dataset, count, ns);
+}
+
+void countEntry(void *ctx, const char *, uint8_t, int32_t price) {
+  *(uint32_t *)ctx += (uint32_t)price;
+}
+
+void benchParser(const Dataset &dataset) {
+  static const char *const kAreas[] = {"SE3", "SE4"};
+  const std::string body = fixtureNordPoolBody(dataset.first, kAreas, 2);
+  size_t entries = 0;
+  const double ns = bestNsPerCall(200, [&body, &entries](size_t) {
+    NordPoolStreamParser parser;
+    uint32_t sum = 0;
+    nordPoolParserBegin(parser, kAreas, 2, countEntry, &sum);
+    const uint8_t *data = (const uint8_t *)body.data();
+    for (size_t at = 0; at < body.size(); at += kParserChunkBytes) {
+      nordPoolParserFeed(parser, data + at, std::min(kParserChunkBytes, body.size() - at));
+    }
+    entries = parser.entries;
+    gSink += sum;
+  });
+  report("parser (one day, 2 areas)", dataset, entries, ns);
+  printf("%-28s %-11s bytes=%u %11.1f MB/s\n", "", "", (unsigned)body.size(), (double)body.size() * 1000.0 / ns);
+}
+}  // namespace
+
+int main() {
+  selectTimezone(kTimezoneCetCest);
+  for (const Dataset &dataset : kDatasets) {
+    benchSlotLookup(dataset);
+    benchStateUtils(dataset);
+    benchBarColors(dataset);
+    benchSlotText(dataset);
+    benchParser(dataset);
+  }
+  return gSink == 0xFFFFFFFFu ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+// Realistic price datasets for the native tests, benchmark and replay: whole
+// local days of 15-minute slots, so the CET/CEST switch days have 92 and 100
+// points. Prices follow a fixed daily curve (cheap night, morning and evening
+// peaks) so every run sees the same data. Call selectTimezone() first.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+#include "app_types.h"
+#include "local_time.h"
+#include "price_fixed.h"
+#include "price_state_utils.h"
+#include "time_utils.h"
+
+struct FixtureDay {
+  int year;
+  unsigned month;
+  unsigned day;
+};
+
+constexpr FixtureDay kFixturePlainDay = {2025, 1, 15};
+constexpr FixtureDay kFixtureSpringForward = {2025, 3, 30};  // 23 h, 92 slots
+constexpr FixtureDay kFixtureFallBack = {2025, 10, 26};      // 25 h, 100 slots
+constexpr time_t kFixtureSlotSec = 15 * 60;
+
+inline time_t fixtureLocalMidnight(const FixtureDay &day, int dayOffset = 0) {
+  struct tm local = {};
+  local.tm_year = day.year - 1900;
+  local.tm_mon = (int)day.month - 1;
+  local.tm_mday = (int)day.day + dayOffset;
+  return localTimeToUtc(local);
+}
+
+// Raw price for the slot starting at `slotStart`, by local time of day.
+inline int32_t fixtureRawPrice(time_t slotStart, uint8_t areaIndex = 0) {
+  struct tm local;
+  if (!localTimeFromUtc(slotStart, local)) return 0;
+  const int quarter = local.tm_hour * 4 + local.tm_min / 15;
+  static const int16_t kHourly[24] = {
+      420, 380, 350, 340, 360, 450, 900, 1600, 1800, 1500, 1200, 1000,
+      950, 900, 950, 1100, 1500, 2100, 2400, 2000, 1500, 1100, 800, 600,
+  };
+  // Quarter-hours wobble around the hourly value, and every ninth local
+  // day is dearer, so days differ as they do on the market.
+  const int wobble = ((quarter * 37) % 11) * 7 - 35;
+  const int dayBias = (local.tm_yday % 9) * 40;
+  return (int32_t)(kHourly[local.tm_hour] + wobble + dayBias + areaIndex * 150) * 10;
+}
+
+inline PriceLevel fixtureLevel(int32_t rawPrice) {
+  if (rawPrice < 5000) return PriceLevel::VeryCheap;
+  if (rawPrice < 9000) return PriceLevel::Cheap;
+  if (rawPrice < 14000) return PriceLevel::Normal;
+  if (rawPrice < 19000) return PriceLevel::Expensive;
+  return PriceLevel::VeryExpensive;
+}
+
+// `days` consecutive local days of 15-minute points from `first`, with the
+// default price formula applied and the slot index and fingerprint updated.
+inline void fillFixtureDays(PriceState &state, const FixtureDay &first, int days) {
+  state = PriceState();
+  state.ok = true;
+  copyStateText(state.area, "SE3");
+  copyStateText(state.source, "fixture");
+  state.resolutionMinutes = 15;
+  const PriceFormula formula;
+  const time_t start = fixtureLocalMidnight(first);
+  const time_t end = fixtureLocalMidnight(first, days);
+  for (time_t slot = start; slot < end && state.count < kMaxPoints; slot += kFixtureSlotSec) {
+    PricePoint &point = state.points[state.count++];
+    point.startsAt = (uint32_t)slot;
+    point.rawPrice = fixtureRawPrice(slot);
+    point.hasRawPrice = true;
+    point.price = applyPriceFormula(formula, point.rawPrice);
+    point.level = fixtureLevel(point.rawPrice);
+  }
+  updatePriceStateSlotIndex(state);
+  state.fingerprint = priceStateFingerprint(state);
+}
+
+// A DayAheadPriceIndices response for one local delivery day, prices per
+// MWh as Nord Pool publishes them.
+inline std::string fixtureNordPoolBody(const FixtureDay &day, const char *const *areas, size_t areaCount) {
+  std::string body = "{\"deliveryDateCET\":\"";
+  char text[64];
+  snprintf(text, sizeof(text), "%04d-%02u-%02u", day.year, day.month, day.day);
+  body += text;
+  body += "\",\"version\":1,\"market\":\"DayAhead\",\"currency\":\"SEK\",\"multiIndexEntries\":[";
+  const time_t start = fixtureLocalMidnight(day);
+  const time_t end = fixtureLocalMidnight(day, 1);
+  for (time_t slot = start; slot < end; slot += kFixtureSlotSec) {
+    if (slot != start) body += ',';
+    struct tm from;
+    struct tm to;
+    const time_t next = slot + kFixtureSlotSec;
+    gmtime_r(&slot, &from);
+    gmtime_r(&next, &to);
+    strftime(text, sizeof(text), "{\"deliveryStart\":\"%Y-%m-%dT%H:%M:%SZ\",", &from);
+    body += text;
+    strftime(text, sizeof(text), "\"deliveryEnd\":\"%Y-%m-%dT%H:%M:%SZ\",\"entryPerArea\":{", &to);
+    body += text;
+    for (size_t a = 0; a < areaCount; ++a) {
+      // Fixed-point per kWh is 1/10 per MWh.
+      const int32_t price = fixtureRawPrice(slot, (uint8_t)a);
+      snprintf(text, sizeof(text), "%s\"%s\":%d.%d", a > 0 ? "," : "", areas[a], (int)(price / 10), (int)(price % 10));
+      body += text;
+    }
+    body += "}}";
+  }
+  body += "],\"areaStates\":[]}";
+  return body;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino-ESP32 core the pure modules
+// use, for the `native` PlatformIO environment. Behaviour follows the
+// device where code depends on it (String, millis wrap, configTzTime);
+// everything else is the minimum that compiles.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+
+#include "WString.h"
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+#define CHANGE 0x03
+
+typedef uint8_t byte;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// Fixed-seed, so host runs that draw jitter repeat exactly.
+inline long random(long howBig) {
+  static uint32_t seed = 1;
+  if (howBig <= 0) return 0;
+  seed = seed * 1103515245u + 12345u;
+  return (long)((seed >> 1) % (uint32_t)howBig);
+}
+inline long random(long howSmall, long howBig) {
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+// No GPIO on the host: pins read inactive and interrupts never fire.
+inline void pinMode(int, int) {}
+inline int digitalRead(int) { return HIGH; }
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+
+// The device also starts SNTP here; on the host the system clock is
+// already set, so only the zone is applied.
+inline void configTzTime(const char *tz, const char *, const char * = nullptr, const char * = nullptr) {
+  if (tz == nullptr) return;
+  setenv("TZ", tz, 1);
+  tzset();
+}
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *data, size_t len) {
+    size_t written = 0;
+    while (written < len && write(data[written]) == 1) ++written;
+    return written;
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t *data, size_t len) {
+    size_t got = 0;
+    while (got < len && available() > 0) data[got++] = (uint8_t)read();
+    return (int)got;
+  }
+};
+
+// Heap figures for logs; the host reports a fixed ESP32-sized heap.
+class EspClass {
+ public:
+  uint32_t getFreeHeap() const { return 200 * 1024; }
+  uint32_t getMinFreeHeap() const { return 200 * 1024; }
+  uint32_t getMaxAllocHeap() const { return 110 * 1024; }
+  uint64_t getEfuseMac() const { return 0x0000A1B2C3D4E5F6ull; }
+  [[noreturn]] void restart() const { exit(0); }
+};
+
+extern EspClass ESP;
+
+// Logs go to stderr on the host; Serial only has to accept the calls.
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long) {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+};
+
+extern HardwareSerial Serial;
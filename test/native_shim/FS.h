@@ -0,0 +1,85 @@
+#pragma once
+
+// In-memory stand-in for the Arduino-ESP32 FS layer. Files live in a map
+// owned by the filesystem object and are written through on every write,
+// as on the device; an open File shares the stored bytes.
+
+#include <Arduino.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+typedef std::vector<uint8_t> FileBytes;
+
+class File : public Stream {
+ public:
+  File() = default;
+  File(std::shared_ptr<FileBytes> bytes, bool writable, size_t position)
+      : bytes_(std::move(bytes)), writable_(writable), position_(position) {}
+
+  explicit operator bool() const { return bytes_ != nullptr; }
+  size_t size() const { return bytes_ ? bytes_->size() : 0; }
+  size_t position() const { return position_; }
+  bool seek(uint32_t position) {
+    if (!bytes_ || position > bytes_->size()) return false;
+    position_ = position;
+    return true;
+  }
+  int available() override { return bytes_ ? (int)(bytes_->size() - position_) : 0; }
+  int read() override {
+    uint8_t c = 0;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int read(uint8_t *data, size_t len) override {
+    if (!bytes_) return 0;
+    const size_t got = std::min(len, bytes_->size() - position_);
+    memcpy(data, bytes_->data() + position_, got);
+    position_ += got;
+    return (int)got;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t len) override {
+    if (!bytes_ || !writable_) return 0;
+    if (position_ + len > bytes_->size()) bytes_->resize(position_ + len);
+    memcpy(bytes_->data() + position_, data, len);
+    position_ += len;
+    return len;
+  }
+  void flush() {}
+  void close() { bytes_.reset(); }
+
+ private:
+  std::shared_ptr<FileBytes> bytes_;
+  bool writable_ = false;
+  size_t position_ = 0;
+};
+
+class FS {
+ public:
+  File open(const char *path, const char *mode = FILE_READ, bool create = false);
+  bool exists(const char *path) const { return files_.count(path) != 0; }
+  bool remove(const char *path) { return files_.erase(path) != 0; }
+  // Fails onto an existing name, like SPIFFS.
+  bool rename(const char *from, const char *to);
+  size_t usedBytes() const;
+  bool format() {
+    files_.clear();
+    return true;
+  }
+
+ private:
+  std::map<std::string, std::shared_ptr<FileBytes>> files_;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
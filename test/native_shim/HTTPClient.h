@@ -0,0 +1,43 @@
+#pragma once
+
+// Host stand-in for HTTPClient. GET() asks the installed handler for the
+// status and body instead of going to the network, so a host run decides
+// what the API returns. Bodies are sent with a Content-Length.
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include <string>
+
+// Returns the HTTP status for `url` and fills `body`; <= 0 is a transport
+// error as on the device.
+typedef int (*HttpHostHandler)(const char *url, std::string &body);
+
+// Without a handler every GET fails to connect.
+void httpSetHostHandler(HttpHostHandler handler);
+
+class HTTPClient {
+ public:
+  void setConnectTimeout(int32_t) {}
+  void setTimeout(uint16_t) {}
+  void useHTTP10(bool) {}
+  void setReuse(bool) {}
+  void collectHeaders(const char *[], const size_t) {}
+  bool begin(WiFiClient &client, const String &url) {
+    client_ = &client;
+    url_ = url;
+    size_ = -1;
+    return true;
+  }
+  void addHeader(const String &, const String &) {}
+  int GET();
+  WiFiClient &getStream() { return *client_; }
+  int getSize() const { return size_; }
+  String header(const char *) const { return String(); }
+  void end() {}
+
+ private:
+  WiFiClient *client_ = nullptr;
+  String url_;
+  int size_ = -1;
+};
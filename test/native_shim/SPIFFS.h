@@ -0,0 +1,11 @@
+#pragma once
+
+#include "FS.h"
+
+class SPIFFSFS : public fs::FS {
+ public:
+  bool begin(bool = false) { return true; }
+  size_t totalBytes() const { return 1408 * 1024; }  // default_16MB.csv data partition
+};
+
+extern SPIFFSFS SPIFFS;
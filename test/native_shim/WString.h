@@ -0,0 +1,97 @@
+#pragma once
+
+// Host stand-in for the Arduino String, backed by std::string.
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+class String {
+ public:
+  String() = default;
+  String(const char *text) : value_(text != nullptr ? text : "") {}
+  String(const std::string &text) : value_(text) {}
+  explicit String(char c) : value_(1, c) {}
+  explicit String(int value) : value_(std::to_string(value)) {}
+  explicit String(unsigned value) : value_(std::to_string(value)) {}
+  explicit String(long value) : value_(std::to_string(value)) {}
+  explicit String(unsigned long value) : value_(std::to_string(value)) {}
+
+  const char *c_str() const { return value_.c_str(); }
+  unsigned length() const { return (unsigned)value_.size(); }
+  bool isEmpty() const { return value_.empty(); }
+  bool reserve(unsigned size) {
+    value_.reserve(size);
+    return true;
+  }
+  char operator[](unsigned index) const { return index < value_.size() ? value_[index] : '\0'; }
+  char charAt(unsigned index) const { return (*this)[index]; }
+
+  int indexOf(char c, unsigned from = 0) const { return position(value_.find(c, from)); }
+  int indexOf(const char *text, unsigned from = 0) const { return position(value_.find(text, from)); }
+  int indexOf(const String &text, unsigned from = 0) const { return indexOf(text.c_str(), from); }
+  bool startsWith(const char *prefix) const { return value_.compare(0, strlen(prefix), prefix) == 0; }
+  String substring(unsigned from) const { return from < value_.size() ? String(value_.substr(from)) : String(); }
+  String substring(unsigned from, unsigned to) const {
+    if (to > value_.size()) to = (unsigned)value_.size();
+    return from < to ? String(value_.substr(from, to - from)) : String();
+  }
+  void toCharArray(char *out, unsigned size) const {
+    if (size == 0) return;
+    const size_t len = std::min((size_t)size - 1, value_.size());
+    memcpy(out, value_.data(), len);
+    out[len] = '\0';
+  }
+  long toInt() const { return strtol(value_.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(value_.c_str(), nullptr); }
+  void trim() {
+    const size_t first = value_.find_first_not_of(" \t\r\n");
+    const size_t last = value_.find_last_not_of(" \t\r\n");
+    value_ = first == std::string::npos ? std::string() : value_.substr(first, last - first + 1);
+  }
+  void toUpperCase() {
+    for (char &c : value_) c = (char)toupper((unsigned char)c);
+  }
+
+  bool concat(const char *text) {
+    value_ += text;
+    return true;
+  }
+  bool concat(const char *text, unsigned len) {
+    value_.append(text, len);
+    return true;
+  }
+  bool concat(char c) {
+    value_ += c;
+    return true;
+  }
+  String &operator+=(const String &other) {
+    value_ += other.value_;
+    return *this;
+  }
+  String &operator+=(const char *text) {
+    value_ += text;
+    return *this;
+  }
+  String &operator+=(char c) {
+    value_ += c;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) { return String(a.value_ + b.value_); }
+  friend String operator+(const String &a, const char *b) { return String(a.value_ + b); }
+  friend String operator+(const char *a, const String &b) { return String(a + b.value_); }
+
+  bool operator==(const String &other) const { return value_ == other.value_; }
+  bool operator==(const char *text) const { return value_ == text; }
+  bool operator!=(const String &other) const { return value_ != other.value_; }
+  bool operator!=(const char *text) const { return value_ != text; }
+  bool operator<(const String &other) const { return value_ < other.value_; }
+
+ private:
+  static int position(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+  std::string value_;
+};
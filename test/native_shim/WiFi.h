@@ -0,0 +1,70 @@
+#pragma once
+
+// Host stand-in for the WiFi station: always connected, no events. The
+// client side only serves responses that HTTPClient loaded into it.
+
+#include <Arduino.h>
+
+#include <string>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_MAX,
+} arduino_event_id_t;
+
+struct arduino_event_info_t {};
+
+typedef void (*WiFiEventFuncCb)(arduino_event_id_t event, arduino_event_info_t info);
+
+class WiFiClass {
+ public:
+  wl_status_t status() const { return WL_CONNECTED; }
+  int onEvent(WiFiEventFuncCb, arduino_event_id_t = ARDUINO_EVENT_MAX) { return 0; }
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+ public:
+  int connect(const char *, uint16_t) {
+    open_ = true;
+    return 1;
+  }
+  uint8_t connected() const { return open_ || position_ < body_.size(); }
+  void stop() {
+    open_ = false;
+    body_.clear();
+    position_ = 0;
+  }
+
+  int available() override { return (int)(body_.size() - position_); }
+  int read() override { return position_ < body_.size() ? (uint8_t)body_[position_++] : -1; }
+  int read(uint8_t *data, size_t len) override {
+    const size_t got = std::min(len, body_.size() - position_);
+    memcpy(data, body_.data() + position_, got);
+    position_ += got;
+    return (int)got;
+  }
+  size_t write(uint8_t) override { return 1; }
+
+  // Host side: the bytes the following reads return, on an open connection.
+  void hostSetResponse(std::string body) {
+    open_ = true;
+    body_ = std::move(body);
+    position_ = 0;
+  }
+
+ private:
+  bool open_ = false;
+  std::string body_;
+  size_t position_ = 0;
+};
@@ -0,0 +1,121 @@
+#include <stdarg.h>
+
+#include <chrono>
+#include <thread>
+
+#include "Arduino.h"
+#include "HTTPClient.h"
+#include "SPIFFS.h"
+#include "WiFi.h"
+#include "logging_utils.h"
+#include "time_utils.h"
+
+EspClass ESP;
+HardwareSerial Serial;
+WiFiClass WiFi;
+SPIFFSFS SPIFFS;
+
+namespace {
+typedef std::chrono::steady_clock SteadyClock;
+
+const SteadyClock::time_point gStart = SteadyClock::now();
+HttpHostHandler gHttpHandler = nullptr;
+
+char levelTag(LogLevel level) {
+  switch (level) {
+    case LogLevel::Error: return 'E';
+    case LogLevel::Warn: return 'W';
+    case LogLevel::Debug: return 'D';
+    case LogLevel::Info:
+    default: return 'I';
+  }
+}
+
+const char *categoryName(LogCategory category) {
+  switch (category) {
+    case LogCategory::Net: return "net";
+    case LogCategory::Display: return "disp";
+    case LogCategory::Storage: return "fs";
+    case LogCategory::Power: return "pwr";
+    case LogCategory::App:
+    default: return "app";
+  }
+}
+}  // namespace
+
+uint32_t millis() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(SteadyClock::now() - gStart).count();
+}
+
+uint32_t micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - gStart).count();
+}
+
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void httpSetHostHandler(HttpHostHandler handler) {
+  gHttpHandler = handler;
+}
+
+int HTTPClient::GET() {
+  constexpr int kConnectionRefused = -1;  // HTTPC_ERROR_CONNECTION_REFUSED
+  if (gHttpHandler == nullptr || client_ == nullptr) return kConnectionRefused;
+  std::string body;
+  const int status = gHttpHandler(url_.c_str(), body);
+  if (status <= 0) {
+    client_->stop();
+    return status;
+  }
+  size_ = (int)body.size();
+  client_->hostSetResponse(std::move(body));
+  return status;
+}
+
+namespace fs {
+
+File FS::open(const char *path, const char *mode, bool) {
+  auto found = files_.find(path);
+  if (strcmp(mode, FILE_READ) == 0) {
+    if (found == files_.end()) return File();
+    return File(found->second, false, 0);
+  }
+  if (found == files_.end() || strcmp(mode, FILE_WRITE) == 0) {
+    found = files_.insert_or_assign(path, std::make_shared<FileBytes>()).first;
+  }
+  return File(found->second, true, found->second->size());
+}
+
+bool FS::rename(const char *from, const char *to) {
+  auto found = files_.find(from);
+  if (found == files_.end() || files_.count(to) != 0) return false;
+  files_[to] = found->second;
+  files_.erase(found);
+  return true;
+}
+
+size_t FS::usedBytes() const {
+  size_t used = 0;
+  for (const auto &file : files_) used += file.second->size();
+  return used;
+}
+
+}  // namespace fs
+
+// Host logging is synchronous: lines go straight to stderr, stamped with
+// the installed clock so replayed runs log simulated time.
+void logWrite(LogLevel level, LogCategory category, const char *fmt, ...) {
+  char message[120];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(message, sizeof(message), fmt, args);
+  va_end(args);
+  fprintf(stderr, "[%10lu] %c %s: %s\n", (unsigned long)clockMillis(), levelTag(level), categoryName(category), message);
+}
+
+void logInit() {}
+
+void logFlush() {
+  fflush(stderr);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// Host replay of the firmware: main.cpp's setup()/loop() run unchanged
+// against a virtual clock, with these modules standing in for the display,
+// power manager, WiFi setup and network worker. They count what the loop
+// asked of them so the driver can report it per simulated day.
+
+#include <stdint.h>
+
+#include "wifi_utils.h"
+
+struct ReplayCounts {
+  uint32_t priceDraws = 0;
+  uint32_t historyDraws = 0;
+  uint32_t clockRefreshes = 0;
+  uint32_t clockSyncs = 0;
+  uint32_t fetches = 0;
+};
+
+// Running totals since boot.
+ReplayCounts &replayCounts();
+// What loadAppSecrets() hands the firmware; set before setup().
+AppSecrets &replaySecrets();
+// Runs the job the loop submitted, as the worker does on the device while
+// the loop waits. Returns false when nothing was queued.
+bool replayRunQueuedJob();
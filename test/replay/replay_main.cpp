@@ -0,0 +1,304 @@
+// Replays days of the firmware's schedule on the host in seconds. The real
+// setup()/loop() run against a virtual clock that jumps to each deadline,
+// and Nord Pool answers come from recorded bodies or the fixtures, only
+// once the day-ahead auction for that date has been published. Prints one
+// row per simulated local day: requests, clock syncs, renders, flash
+// writes and heap.
+//
+// Build and run with `pio run -e native_replay -t exec`, or pass options:
+//   --start YYYY-MM-DD   first local day (default 2025-10-22, so the week
+//                        crosses the CEST -> CET switch)
+//   --hour H             local boot hour on the first day (default 10)
+//   --days N             whole local days to run after the first (default 7)
+//   --bodies DIR         serve DIR/<date>.json; dates without a file are
+//                        not published yet (HTTP 204)
+//   --publish HH:MM      local publish time on the day before delivery
+//                        (default 12:45)
+//   --fail-every N       answer every Nth request with HTTP 503 (default 0, off)
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "flash_storage.h"
+#include "local_time.h"
+#include "price_fixtures.h"
+#include "replay_host.h"
+#include "time_utils.h"
+
+void setup();
+void loop();
+
+namespace {
+constexpr uint32_t kBootMonotonicMs = 1000;
+constexpr uint32_t kRequestMs = 300;  // virtual time one HTTPS request takes
+constexpr size_t kMaxReplayAreas = 4;
+
+struct ReplayOptions {
+  FixtureDay start = {2025, 10, 22};
+  int hour = 10;
+  int days = 7;
+  const char *bodiesDir = nullptr;
+  int publishHour = 12;
+  int publishMinute = 45;
+  uint32_t failEvery = 0;
+};
+
+struct HttpCounts {
+  uint32_t requests = 0;
+  uint32_t notPublished = 0;
+  uint32_t failures = 0;
+};
+
+// Everything a report row is the difference of.
+struct Sample {
+  int64_t wallMs = 0;
+  ReplayCounts counts;
+  HttpCounts http;
+  StorageStats storage;
+};
+
+ReplayOptions gOptions;
+int64_t gWallMs = 0;
+uint32_t gMonotonicMs = kBootMonotonicMs;
+HttpCounts gHttp;
+
+int64_t virtualWallMs() {
+  return gWallMs;
+}
+
+uint32_t virtualMonotonicMs() {
+  return gMonotonicMs;
+}
+
+void advance(uint32_t ms) {
+  gWallMs += ms;
+  gMonotonicMs += ms;
+}
+
+// The loop's wait ends early when the worker finishes a job, so a queued
+// job runs first and the deadline wait resumes on the next pass.
+void virtualIdle(uint32_t ms) {
+  if (replayRunQueuedJob()) return;
+  advance(ms > 0 ? ms : 1);
+}
+
+const ClockSource kVirtualClock = {virtualWallMs, virtualMonotonicMs, virtualIdle};
+
+// Copies the value of `key=` in the query into out; false when missing.
+bool queryValue(const char *url, const char *key, char *out, size_t outSize) {
+  const char *query = strchr(url, '?');
+  const size_t keyLen = strlen(key);
+  for (const char *p = query; p != nullptr; p = strchr(p + 1, '&')) {
+    if (strncmp(p + 1, key, keyLen) != 0 || p[1 + keyLen] != '=') continue;
+    const char *value = p + 2 + keyLen;
+    const size_t len = strcspn(value, "&");
+    if (len >= outSize) return false;
+    memcpy(out, value, len);
+    out[len] = '\0';
+    return true;
+  }
+  return false;
+}
+
+time_t publishTime(const FixtureDay &delivery) {
+  struct tm local = {};
+  local.tm_year = delivery.year - 1900;
+  local.tm_mon = (int)delivery.month - 1;
+  local.tm_mday = (int)delivery.day - 1;
+  local.tm_hour = gOptions.publishHour;
+  local.tm_min = gOptions.publishMinute;
+  return localTimeToUtc(local);
+}
+
+bool readFile(const char *path, std::string &out) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) return false;
+  char buffer[4096];
+  size_t got = 0;
+  out.clear();
+  while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0) out.append(buffer, got);
+  fclose(file);
+  return true;
+}
+
+int replayHttp(const char *url, std::string &body) {
+  ++gHttp.requests;
+  advance(kRequestMs);
+  if (gOptions.failEvery > 0 && gHttp.requests % gOptions.failEvery == 0) {
+    ++gHttp.failures;
+    return 503;
+  }
+
+  char date[16];
+  char indexNames[64];
+  FixtureDay delivery;
+  if (!queryValue(url, "date", date, sizeof(date)) || !queryValue(url, "indexNames", indexNames, sizeof(indexNames)) ||
+      sscanf(date, "%d-%u-%u", &delivery.year, &delivery.month, &delivery.day) != 3) {
+    return 400;
+  }
+  if (clockNow() < publishTime(delivery)) {
+    ++gHttp.notPublished;
+    return 204;
+  }
+
+  if (gOptions.bodiesDir != nullptr) {
+    const std::string path = std::string(gOptions.bodiesDir) + "/" + date + ".json";
+    if (!readFile(path.c_str(), body)) {
+      ++gHttp.notPublished;
+      return 204;
+    }
+    return 200;
+  }
+
+  const char *areas[kMaxReplayAreas];
+  size_t areaCount = 0;
+  for (char *area = strtok(indexNames, ","); area != nullptr && areaCount < kMaxReplayAreas;
+       area = strtok(nullptr, ",")) {
+    areas[areaCount++] = area;
+  }
+  body = fixtureNordPoolBody(delivery, areas, areaCount);
+  return 200;
+}
+
+Sample takeSample() {
+  Sample sample;
+  sample.wallMs = gWallMs;
+  sample.counts = replayCounts();
+  sample.http = gHttp;
+  sample.storage = storageStats();
+  return sample;
+}
+
+void printHeader() {
+  printf(
+      "%-10s %5s %4s %4s %4s %5s %5s %4s %5s %6s %8s %4s %9s %9s %5s\n",
+      "day",
+      "hours",
+      "gets",
+      "204",
+      "fail",
+      "syncs",
+      "draws",
+      "hist",
+      "clock",
+      "writes",
+      "written",
+      "repl",
+      "heap_used",
+      "heap_free",
+      "frag%");
+}
+
+// The device's heap fragmentation is 1 - largest block / free. glibc has no
+// largest-block figure, so the host reports the free share of the arena:
+// memory the allocator holds but cannot hand back.
+void printRow(const char *label, const Sample &from, const Sample &to) {
+  const double hours = (double)(to.wallMs - from.wallMs) / 3600000.0;
+  printf(
+      "%-10s %5.1f %4u %4u %4u %5u %5u %4u %5u %6u %8u %4u",
+      label,
+      hours,
+      (unsigned)(to.http.requests - from.http.requests),
+      (unsigned)(to.http.notPublished - from.http.notPublished),
+      (unsigned)(to.http.failures - from.http.failures),
+      (unsigned)(to.counts.clockSyncs - from.counts.clockSyncs),
+      (unsigned)(to.counts.priceDraws - from.counts.priceDraws),
+      (unsigned)(to.counts.historyDraws - from.counts.historyDraws),
+      (unsigned)(to.counts.clockRefreshes - from.counts.clockRefreshes),
+      (unsigned)(to.storage.writes - from.storage.writes),
+      (unsigned)(to.storage.bytesWritten - from.storage.bytesWritten),
+      (unsigned)(to.storage.replaces - from.storage.replaces));
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  const struct mallinfo2 heap = mallinfo2();
+  const double fragmentation = heap.arena > 0 ? 100.0 * (double)heap.fordblks / (double)heap.arena : 0.0;
+  printf(" %9zu %9zu %5.1f\n", heap.uordblks, heap.fordblks, fragmentation);
+#else
+  printf(" %9s %9s %5s\n", "-", "-", "-");
+#endif
+}
+
+bool parseOptions(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (value == nullptr) return false;
+    if (strcmp(argv[i], "--start") == 0) {
+      if (sscanf(value, "%d-%u-%u", &gOptions.start.year, &gOptions.start.month, &gOptions.start.day) != 3) {
+        return false;
+      }
+    } else if (strcmp(argv[i], "--hour") == 0) {
+      gOptions.hour = atoi(value);
+    } else if (strcmp(argv[i], "--days") == 0) {
+      gOptions.days = atoi(value);
+    } else if (strcmp(argv[i], "--bodies") == 0) {
+      gOptions.bodiesDir = value;
+    } else if (strcmp(argv[i], "--publish") == 0) {
+      if (sscanf(value, "%d:%d", &gOptions.publishHour, &gOptions.publishMinute) != 2) return false;
+    } else if (strcmp(argv[i], "--fail-every") == 0) {
+      gOptions.failEvery = (uint32_t)strtoul(value, nullptr, 10);
+    } else {
+      return false;
+    }
+    ++i;
+  }
+  return gOptions.days >= 0 && gOptions.hour >= 0 && gOptions.hour < 24;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (!parseOptions(argc, argv)) {
+    fprintf(
+        stderr,
+        "usage: %s [--start YYYY-MM-DD] [--hour H] [--days N] [--bodies DIR] [--publish HH:MM] [--fail-every N]\n",
+        argv[0]);
+    return 2;
+  }
+
+  AppSecrets &secrets = replaySecrets();
+  secrets.nordpoolApiUrl = "https://dataportal-api.nordpoolgroup.com/api/DayAheadPriceIndices";
+  secrets.nordpoolArea = "SE3";
+  secrets.nordpoolCurrency = "SEK";
+  secrets.nordpoolResolutionMinutes = 15;
+
+  selectTimezone(timezoneSpecForNordpoolArea(secrets.nordpoolArea));
+  const time_t boot = fixtureLocalMidnight(gOptions.start) + (time_t)gOptions.hour * 3600;
+  const time_t end = fixtureLocalMidnight(gOptions.start, gOptions.days + 1);
+  gWallMs = (int64_t)boot * 1000;
+  clockSetSource(&kVirtualClock);
+  httpSetHostHandler(replayHttp);
+
+  printHeader();
+  const auto realStart = std::chrono::steady_clock::now();
+  const Sample first = takeSample();
+  Sample dayStart = first;
+  setup();
+  while (clockNow() < end) {
+    loop();
+    const time_t now = clockNow();
+    if (localDayStart(now, 0) * 1000 <= dayStart.wallMs) continue;
+
+    char label[16];
+    formatDateYmd((time_t)(dayStart.wallMs / 1000), label, sizeof(label));
+    // Deadlines land on the minute, so the row closes a little into the
+    // next day; the spill-over is counted there.
+    const Sample sample = takeSample();
+    printRow(label, dayStart, sample);
+    dayStart = sample;
+  }
+  const Sample last = takeSample();
+  printRow("total", first, last);
+
+  const auto realMs =
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - realStart).count();
+  printf("Simulated %.1f h in %lld ms\n", (double)(last.wallMs - first.wallMs) / 3600000.0, (long long)realMs);
+  return 0;
+}
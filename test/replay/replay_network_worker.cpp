@@ -0,0 +1,82 @@
+// network_worker.h without the task: a submitted job waits until the loop
+// idles, then runs on the loop's thread, so the loop sees the same
+// queued/busy/completed sequence as with the worker on the other core.
+
+#include "network_worker.h"
+
+#include "logging_utils.h"
+#include "nordpool_client.h"
+#include "replay_host.h"
+#include "time_utils.h"
+
+namespace {
+enum class JobPhase : uint8_t {
+  Idle,
+  Queued,
+  Done,
+};
+
+JobPhase gPhase = JobPhase::Idle;
+NetworkJobRequest gRequest;
+bool gStarted = false;
+NetworkJobDoneCallback gOnJobDone = nullptr;
+}  // namespace
+
+bool networkWorkerStart(uint32_t, NetworkJobDoneCallback onJobDone) {
+  gStarted = true;
+  gOnJobDone = onJobDone;
+  return true;
+}
+
+void networkWorkerWake() {}
+
+bool networkWorkerSubmit(const NetworkJobRequest &request) {
+  if (!gStarted || request.job == NetworkJob::None) return false;
+  if (request.job == NetworkJob::FetchPrices && request.out == nullptr) return false;
+  if (gPhase != JobPhase::Idle) return false;
+  gRequest = request;
+  gPhase = JobPhase::Queued;
+  return true;
+}
+
+NetworkJob networkWorkerTakeCompleted() {
+  if (gPhase != JobPhase::Done) return NetworkJob::None;
+  gPhase = JobPhase::Idle;
+  return gRequest.job;
+}
+
+bool networkWorkerBusy() {
+  return gPhase != JobPhase::Idle;
+}
+
+uint32_t networkWorkerBusyMs() {
+  return 0;
+}
+
+bool replayRunQueuedJob() {
+  if (gPhase != JobPhase::Queued) return false;
+  switch (gRequest.job) {
+    case NetworkJob::SyncClock:
+      // The virtual clock is the synced time; only the zone is applied.
+      ++replayCounts().clockSyncs;
+      syncClock(gRequest.timezoneSpec);
+      break;
+    case NetworkJob::FetchPrices:
+      ++replayCounts().fetches;
+      fetchNordPoolPriceInfo(
+          gRequest.apiUrl,
+          gRequest.area,
+          gRequest.extraAreas,
+          gRequest.currency,
+          gRequest.formula,
+          gRequest.existing,
+          *gRequest.out);
+      break;
+    case NetworkJob::None:
+    default:
+      break;
+  }
+  gPhase = JobPhase::Done;
+  if (gOnJobDone != nullptr) gOnJobDone();
+  return true;
+}
@@ -0,0 +1,100 @@
+// Display, power and WiFi-setup stand-ins for the replay. Drawing only
+// counts; the station is always up and the config portal never opens.
+
+#include "display_ui.h"
+#include "power_manager.h"
+#include "replay_host.h"
+#include "wifi_utils.h"
+
+namespace {
+constexpr int kReplayChartWidth = 286;  // display_ui's 320x240 chart
+
+ReplayCounts gCounts;
+AppSecrets gSecrets;
+PowerMode gPowerMode = PowerMode::Performance;
+}  // namespace
+
+ReplayCounts &replayCounts() {
+  return gCounts;
+}
+
+AppSecrets &replaySecrets() {
+  return gSecrets;
+}
+
+void displayInit() {}
+
+void displayDrawPrices(const PriceState &) {
+  ++gCounts.priceDraws;
+}
+
+int displayChartWidth() {
+  return kReplayChartWidth;
+}
+
+void displayDrawHistory(const HistoryView &, const PriceState &, const PriceFormula &) {
+  ++gCounts.historyDraws;
+}
+
+void displayRefreshClock() {
+  ++gCounts.clockRefreshes;
+}
+
+void displaySetNotice(const char *) {}
+
+void displayDrawWifiConfigPortal(const char *, uint16_t) {}
+
+void displayDrawWifiConfigTimeout(uint16_t) {}
+
+// The virtual clock's idle hook replaces powerIdle(), so the mode is only
+// reported back.
+void powerInit(PowerMode mode, int, int) {
+  gPowerMode = mode;
+}
+
+PowerMode powerMode() {
+  return gPowerMode;
+}
+
+bool powerRadioOnDemand() {
+  return false;
+}
+
+void powerIdle(uint32_t, bool) {}
+
+void powerNoteRadio(bool) {}
+
+bool powerRadioOn() {
+  return true;
+}
+
+void loadAppSecrets(AppSecrets &out) {
+  out = gSecrets;
+}
+
+bool wifiConnectWithConfigPortal(AppSecrets &secrets, uint16_t) {
+  loadAppSecrets(secrets);
+  return true;
+}
+
+bool wifiConfigPortalStart(const AppSecrets &, uint16_t) {
+  return false;
+}
+
+WifiPortalState wifiConfigPortalProcess(AppSecrets &) {
+  return WifiPortalState::Idle;
+}
+
+uint8_t wifiReconnectFailures() {
+  return 0;
+}
+
+bool wifiReconnectInProgress() {
+  return false;
+}
+
+bool wifiReconnect(uint32_t) {
+  return true;
+}
+
+void wifiResetSettings() {}
@@ -0,0 +1,136 @@
+#include <unity.h>
+
+#include "bar_colors.h"
+
+namespace {
+PriceState gState;
+LevelBand gBands[kLevelBandCount];
+
+void addPoint(int32_t price, PriceLevel level) {
+  PricePoint &point = gState.points[gState.count++];
+  point.price = price;
+  point.level = level;
+}
+
+PricePoint point(int32_t price, PriceLevel level) {
+  PricePoint p;
+  p.price = price;
+  p.level = level;
+  return p;
+}
+
+void computeBands() {
+  for (LevelBand &band : gBands) band = LevelBand();
+  computeLevelBands(gState, gBands);
+}
+}  // namespace
+
+void setUp() {
+  gState = PriceState();
+  gState.ok = true;
+}
+
+void tearDown() {}
+
+void test_rgb565_packing() {
+  TEST_ASSERT_EQUAL_HEX16(0x0000, rgb565(0, 0, 0));
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, rgb565(255, 255, 255));
+  TEST_ASSERT_EQUAL_HEX16(0xF800, rgb565(255, 0, 0));
+  TEST_ASSERT_EQUAL_HEX16(0x07E0, rgb565(0, 255, 0));
+  TEST_ASSERT_EQUAL_HEX16(0x001F, rgb565(0, 0, 255));
+}
+
+void test_level_colors() {
+  TEST_ASSERT_EQUAL_HEX16(rgb565(170, 255, 170), levelColor(PriceLevel::VeryCheap));
+  TEST_ASSERT_EQUAL_HEX16(rgb565(245, 190, 70), levelColor(PriceLevel::Normal));
+  TEST_ASSERT_EQUAL_HEX16(rgb565(100, 0, 0), levelColor(PriceLevel::VeryExpensive));
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, levelColor(PriceLevel::Unknown));
+}
+
+void test_bands_track_min_max_per_level() {
+  addPoint(1200, PriceLevel::Normal);
+  addPoint(900, PriceLevel::Cheap);
+  addPoint(1500, PriceLevel::Normal);
+  addPoint(99999, PriceLevel::Unknown);
+  addPoint(1000, PriceLevel::Normal);
+  computeBands();
+  TEST_ASSERT_TRUE(gBands[2].has);
+  TEST_ASSERT_EQUAL(1000, gBands[2].minPrice);
+  TEST_ASSERT_EQUAL(1500, gBands[2].maxPrice);
+  TEST_ASSERT_TRUE(gBands[1].has);
+  TEST_ASSERT_EQUAL(900, gBands[1].minPrice);
+  TEST_ASSERT_EQUAL(900, gBands[1].maxPrice);
+  TEST_ASSERT_FALSE(gBands[0].has);
+  TEST_ASSERT_FALSE(gBands[3].has);
+  TEST_ASSERT_FALSE(gBands[4].has);
+}
+
+void test_lone_level_keeps_its_hue() {
+  addPoint(1000, PriceLevel::Normal);
+  addPoint(2000, PriceLevel::Normal);
+  computeBands();
+  const uint16_t normal = levelColor(PriceLevel::Normal);
+  TEST_ASSERT_EQUAL_HEX16(normal, barGradientColor(point(1000, PriceLevel::Normal), gBands, 1000, 1000));
+  TEST_ASSERT_EQUAL_HEX16(normal, barGradientColor(point(1500, PriceLevel::Normal), gBands, 1000, 1000));
+  TEST_ASSERT_EQUAL_HEX16(normal, barGradientColor(point(2000, PriceLevel::Normal), gBands, 1000, 1000));
+}
+
+void test_flat_band_is_solid() {
+  addPoint(1000, PriceLevel::Cheap);
+  addPoint(1005, PriceLevel::Normal);
+  addPoint(1005 + kMinBandSpan - 1, PriceLevel::Normal);
+  computeBands();
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::Normal),
+                          barGradientColor(point(1005, PriceLevel::Normal), gBands, 1000, 1000));
+}
+
+void test_band_ends_lean_toward_present_neighbours() {
+  addPoint(500, PriceLevel::Cheap);
+  addPoint(1000, PriceLevel::Normal);
+  addPoint(2000, PriceLevel::Normal);
+  computeBands();
+  // Low end: Normal blended 179/256 of the way to Cheap, (141, 204, 98).
+  TEST_ASSERT_EQUAL_HEX16(0x8E6C, barGradientColor(point(1000, PriceLevel::Normal), gBands, 500, 1500));
+  TEST_ASSERT_EQUAL_HEX16(rgb565(141, 204, 98), barGradientColor(point(1000, PriceLevel::Normal), gBands, 500, 1500));
+  // No Expensive points, so the high end stays Normal.
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::Normal),
+                          barGradientColor(point(2000, PriceLevel::Normal), gBands, 500, 1500));
+}
+
+void test_unknown_level_uses_range_gradient() {
+  computeBands();
+  const int32_t low = 0;
+  const int32_t span = 4000;
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::VeryCheap),
+                          barGradientColor(point(-100, PriceLevel::Unknown), gBands, low, span));
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::VeryCheap),
+                          barGradientColor(point(0, PriceLevel::Unknown), gBands, low, span));
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::Cheap),
+                          barGradientColor(point(1000, PriceLevel::Unknown), gBands, low, span));
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::Normal),
+                          barGradientColor(point(2000, PriceLevel::Unknown), gBands, low, span));
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::VeryExpensive),
+                          barGradientColor(point(4000, PriceLevel::Unknown), gBands, low, span));
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::VeryExpensive),
+                          barGradientColor(point(9000, PriceLevel::Unknown), gBands, low, span));
+}
+
+void test_level_missing_from_bands_uses_range_gradient() {
+  addPoint(1000, PriceLevel::Normal);
+  computeBands();
+  TEST_ASSERT_EQUAL_HEX16(levelColor(PriceLevel::VeryExpensive),
+                          barGradientColor(point(4000, PriceLevel::Cheap), gBands, 0, 4000));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_rgb565_packing);
+  RUN_TEST(test_level_colors);
+  RUN_TEST(test_bands_track_min_max_per_level);
+  RUN_TEST(test_lone_level_keeps_its_hue);
+  RUN_TEST(test_flat_band_is_solid);
+  RUN_TEST(test_band_ends_lean_toward_present_neighbours);
+  RUN_TEST(test_unknown_level_uses_range_gradient);
+  RUN_TEST(test_level_missing_from_bands_uses_range_gradient);
+  return UNITY_END();
+}
@@ -0,0 +1,96 @@
+#include <SPIFFS.h>
+#include <string.h>
+#include <unity.h>
+
+#include "flash_storage.h"
+
+// The native build uses the SPIFFS shim, whose rename fails onto an existing
+// name, so every replace takes the "<path>.new" route.
+
+namespace {
+constexpr char kPath[] = "/store.bin";
+constexpr char kTempPath[] = "/store.bin.tmp";
+constexpr char kNewPath[] = "/store.bin.new";
+
+void writeRaw(const char *path, const char *text) {
+  File file = SPIFFS.open(path, FILE_WRITE);
+  file.write((const uint8_t *)text, strlen(text));
+  file.close();
+}
+
+bool saveText(const char *text) {
+  StorageChunk chunk;
+  chunk.data = text;
+  chunk.len = strlen(text);
+  return storageWriteAtomic(kPath, &chunk, 1);
+}
+
+const char *readText(const char *path) {
+  static char text[32];
+  memset(text, 0, sizeof(text));
+  File file = storageOpen(path, FILE_READ);
+  if (!file) return "";
+  storageRead(file, text, sizeof(text) - 1);
+  file.close();
+  return text;
+}
+}  // namespace
+
+void setUp() {
+  SPIFFS.format();
+}
+
+void tearDown() {}
+
+void test_atomic_write_replaces_and_cleans_up() {
+  TEST_ASSERT_TRUE(saveText("old"));
+  TEST_ASSERT_TRUE(saveText("new"));
+  TEST_ASSERT_EQUAL_STRING("new", readText(kPath));
+  TEST_ASSERT_FALSE(SPIFFS.exists(kTempPath));
+  TEST_ASSERT_FALSE(SPIFFS.exists(kNewPath));
+}
+
+void test_partial_temp_is_not_promoted() {
+  // Reset mid-way through a first-ever save.
+  writeRaw(kTempPath, "ha");
+  TEST_ASSERT_FALSE(storageExists(kPath));
+  TEST_ASSERT_EQUAL_STRING("", readText(kPath));
+  TEST_ASSERT_TRUE(saveText("whole"));
+  TEST_ASSERT_EQUAL_STRING("whole", readText(kPath));
+}
+
+void test_finished_temp_is_promoted() {
+  // Reset after the temp was marked complete and the target removed.
+  const uint32_t recoveries = storageStats().recoveries;
+  writeRaw(kNewPath, "new");
+  TEST_ASSERT_TRUE(storageExists(kPath));
+  TEST_ASSERT_EQUAL_STRING("new", readText(kPath));
+  TEST_ASSERT_FALSE(SPIFFS.exists(kNewPath));
+  TEST_ASSERT_EQUAL(recoveries + 1, storageStats().recoveries);
+}
+
+void test_finished_temp_replaces_old_target() {
+  // Reset after the temp was marked complete, before the target was removed.
+  writeRaw(kPath, "old");
+  writeRaw(kNewPath, "new");
+  TEST_ASSERT_EQUAL_STRING("new", readText(kPath));
+}
+
+void test_remove_drops_leftovers() {
+  writeRaw(kTempPath, "ha");
+  writeRaw(kNewPath, "new");
+  TEST_ASSERT_TRUE(storageRemove(kPath));
+  TEST_ASSERT_FALSE(storageExists(kPath));
+  TEST_ASSERT_FALSE(SPIFFS.exists(kTempPath));
+  TEST_ASSERT_FALSE(SPIFFS.exists(kNewPath));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_atomic_write_replaces_and_cleans_up);
+  RUN_TEST(test_partial_temp_is_not_promoted);
+  RUN_TEST(test_finished_temp_is_promoted);
+  RUN_TEST(test_finished_temp_replaces_old_target);
+  RUN_TEST(test_remove_drops_leftovers);
+  return UNITY_END();
+}
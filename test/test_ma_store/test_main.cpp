@@ -0,0 +1,104 @@
+#include <SPIFFS.h>
+#include <unity.h>
+
+#include "nordpool_ma_store.h"
+
+namespace {
+MovingAverageStore gStore;
+MovingAverageStore gLoaded;
+
+constexpr uint32_t kSlotStart = 1736895600;  // 2025-01-15T00:00 local (CET)
+constexpr uint32_t kSlotSec = 15 * 60;
+
+void fillWindow(MovingAverageStore &store, uint16_t samples, int32_t firstValue) {
+  for (uint16_t i = 0; i < samples; ++i) {
+    addMovingAverageSample(store, kSlotStart + i * kSlotSec, firstValue + i);
+  }
+}
+}  // namespace
+
+void setUp() {
+  SPIFFS.format();
+  resetMovingAverageStore(gStore);
+  gStore.resolutionMinutes = 15;
+  gStore.windowSamples = 4;
+}
+
+void tearDown() {}
+
+void test_empty_average_is_zero() {
+  TEST_ASSERT_EQUAL(0, movingAverageValue(gStore));
+}
+
+void test_average_rounds_half_away_from_zero() {
+  addMovingAverageSample(gStore, kSlotStart, 1);
+  addMovingAverageSample(gStore, kSlotStart + kSlotSec, 2);
+  TEST_ASSERT_EQUAL(2, movingAverageValue(gStore));
+
+  resetMovingAverageStore(gStore);
+  gStore.windowSamples = 4;
+  addMovingAverageSample(gStore, kSlotStart, -1);
+  addMovingAverageSample(gStore, kSlotStart + kSlotSec, -2);
+  TEST_ASSERT_EQUAL(-2, movingAverageValue(gStore));
+
+  addMovingAverageSample(gStore, kSlotStart + 2 * kSlotSec, 6);
+  TEST_ASSERT_EQUAL(1, movingAverageValue(gStore));
+}
+
+void test_window_drops_oldest() {
+  fillWindow(gStore, 6, 1);  // 1..6, window keeps 3..6
+  TEST_ASSERT_EQUAL(4, gStore.count);
+  TEST_ASSERT_EQUAL(18, gStore.sum);
+  TEST_ASSERT_EQUAL(5, movingAverageValue(gStore));  // 4.5 rounds up
+  TEST_ASSERT_EQUAL(kSlotStart + 5 * kSlotSec, gStore.lastSlotStart);
+}
+
+void test_sum_stays_exact_over_many_wraps() {
+  gStore.windowSamples = kMaxMovingAverageWindowSamples;
+  for (uint32_t i = 0; i < 10 * kMaxMovingAverageWindowSamples; ++i) {
+    addMovingAverageSample(gStore, kSlotStart + i * kSlotSec, (int32_t)((i * 7919) % 30000) - 5000);
+  }
+  int64_t sum = 0;
+  for (size_t i = 0; i < gStore.count; ++i) sum += gStore.values[i];
+  TEST_ASSERT_EQUAL(sum, gStore.sum);
+}
+
+void test_invalid_window_falls_back_to_hourly() {
+  gStore.windowSamples = 0;
+  addMovingAverageSample(gStore, kSlotStart, 100);
+  TEST_ASSERT_EQUAL(kMovingAverageWindowHours, gStore.windowSamples);
+  TEST_ASSERT_EQUAL(100, movingAverageValue(gStore));
+}
+
+void test_snapshot_and_log_round_trip() {
+  fillWindow(gStore, 3, 100);
+  TEST_ASSERT_TRUE(saveMovingAverageStore(gStore));
+
+  MovingAverageSample added[2];
+  for (uint16_t i = 0; i < 2; ++i) {
+    added[i].slotStart = kSlotStart + (3 + i) * kSlotSec;
+    added[i].value = 200 + i;
+    addMovingAverageSample(gStore, added[i].slotStart, added[i].value);
+  }
+  TEST_ASSERT_TRUE(appendMovingAverageSamples(gStore, added, 2));
+
+  TEST_ASSERT_TRUE(loadMovingAverageStore(gLoaded));
+  TEST_ASSERT_EQUAL(gStore.count, gLoaded.count);
+  TEST_ASSERT_EQUAL(gStore.sum, gLoaded.sum);
+  TEST_ASSERT_EQUAL(gStore.lastSlotStart, gLoaded.lastSlotStart);
+  TEST_ASSERT_EQUAL(movingAverageValue(gStore), movingAverageValue(gLoaded));
+
+  TEST_ASSERT_TRUE(clearMovingAverageStore());
+  TEST_ASSERT_FALSE(loadMovingAverageStore(gLoaded));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_average_is_zero);
+  RUN_TEST(test_average_rounds_half_away_from_zero);
+  RUN_TEST(test_window_drops_oldest);
+  RUN_TEST(test_sum_stays_exact_over_many_wraps);
+  RUN_TEST(test_invalid_window_falls_back_to_hourly);
+  RUN_TEST(test_snapshot_and_log_round_trip);
+  return UNITY_END();
+}
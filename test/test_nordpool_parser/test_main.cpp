@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "nordpool_parser.h"
+
+// Prices reach the callback as fixed-point per kWh, i.e. tenths per MWh:
+// the first decimal is kept and the rest rounds half away from zero.
+
+namespace {
+const char *const kAreas[] = {"SE3"};
+
+NordPoolParseStatus gStatus = NordPoolParseStatus::InProgress;
+size_t gEntries = 0;
+int32_t gPrice = 0;
+
+void captureEntry(void *, const char *, uint8_t, int32_t pricePerKwh) {
+  ++gEntries;
+  gPrice = pricePerKwh;
+}
+
+// Parses one multiIndexEntries item whose SE3 value is the JSON text
+// `value`; true when the document parsed and a price was reported for it.
+bool parsePrice(const char *value) {
+  char body[256];
+  snprintf(body, sizeof(body),
+           "{\"multiIndexEntries\":[{\"deliveryStart\":\"2025-01-15T00:00:00Z\","
+           "\"entryPerArea\":{\"SE3\":%s}}]}",
+           value);
+  NordPoolStreamParser parser;
+  nordPoolParserBegin(parser, kAreas, 1, captureEntry, nullptr);
+  gStatus = nordPoolParserFeed(parser, (const uint8_t *)body, strlen(body));
+  return gStatus == NordPoolParseStatus::Done && gEntries == 1;
+}
+}  // namespace
+
+void setUp() {
+  gStatus = NordPoolParseStatus::InProgress;
+  gEntries = 0;
+  gPrice = 0;
+}
+
+void tearDown() {}
+
+void test_whole_and_one_decimal_are_exact() {
+  TEST_ASSERT_TRUE(parsePrice("45"));
+  TEST_ASSERT_EQUAL(450, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("45.6"));
+  TEST_ASSERT_EQUAL(456, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("-3.2"));
+  TEST_ASSERT_EQUAL(-32, gPrice);
+}
+
+void test_second_decimal_rounds_half_away_from_zero() {
+  TEST_ASSERT_TRUE(parsePrice("45.67"));
+  TEST_ASSERT_EQUAL(457, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("45.65"));
+  TEST_ASSERT_EQUAL(457, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("45.64"));
+  TEST_ASSERT_EQUAL(456, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("-0.05"));
+  TEST_ASSERT_EQUAL(-1, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("-45.67"));
+  TEST_ASSERT_EQUAL(-457, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("12.349"));
+  TEST_ASSERT_EQUAL(123, gPrice);
+}
+
+void test_exponent_form() {
+  TEST_ASSERT_TRUE(parsePrice("1.5e2"));
+  TEST_ASSERT_EQUAL(1500, gPrice);
+  setUp();
+  TEST_ASSERT_TRUE(parsePrice("-2.25E1"));
+  TEST_ASSERT_EQUAL(-225, gPrice);
+}
+
+void test_values_past_int32_are_dropped() {
+  TEST_ASSERT_TRUE(parsePrice("214748364.7"));
+  TEST_ASSERT_EQUAL(2147483647, gPrice);
+  setUp();
+  TEST_ASSERT_FALSE(parsePrice("214748364.8"));
+  TEST_ASSERT_FALSE(parsePrice("300000000"));
+  TEST_ASSERT_FALSE(parsePrice("99999999999999999999"));
+  TEST_ASSERT_FALSE(parsePrice("3e8"));
+  // The entry is skipped; the document still parses.
+  TEST_ASSERT_TRUE(gStatus == NordPoolParseStatus::Done);
+  TEST_ASSERT_EQUAL(0, gEntries);
+}
+
+void test_null_and_non_numeric_are_dropped() {
+  TEST_ASSERT_FALSE(parsePrice("null"));
+  TEST_ASSERT_TRUE(gStatus == NordPoolParseStatus::Done);
+  TEST_ASSERT_EQUAL(0, gEntries);
+  TEST_ASSERT_FALSE(parsePrice("\"45.67\""));
+  TEST_ASSERT_FALSE(parsePrice("-"));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_whole_and_one_decimal_are_exact);
+  RUN_TEST(test_second_decimal_rounds_half_away_from_zero);
+  RUN_TEST(test_exponent_form);
+  RUN_TEST(test_values_past_int32_are_dropped);
+  RUN_TEST(test_null_and_non_numeric_are_dropped);
+  return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include <unity.h>
+
+#include "price_fixtures.h"
+#include "price_state_utils.h"
+
+namespace {
+PriceState gCurrent;
+PriceState gFetched;
+}  // namespace
+
+void setUp() {
+  selectTimezone(kTimezoneCetCest);
+}
+
+void tearDown() {}
+
+void test_new_info_needs_ok_fetched_prices() {
+  fillFixtureDays(gCurrent, kFixturePlainDay, 1);
+  gFetched = PriceState();
+  TEST_ASSERT_FALSE(hasNewPriceInfo(gFetched, gCurrent));
+  fillFixtureDays(gFetched, kFixturePlainDay, 2);
+  gFetched.ok = false;
+  TEST_ASSERT_FALSE(hasNewPriceInfo(gFetched, gCurrent));
+}
+
+void test_new_info_against_empty_current() {
+  fillFixtureDays(gFetched, kFixturePlainDay, 1);
+  gCurrent = PriceState();
+  TEST_ASSERT_TRUE(hasNewPriceInfo(gFetched, gCurrent));
+}
+
+void test_new_info_compares_fingerprints() {
+  fillFixtureDays(gCurrent, kFixtureFallBack, 2);
+  fillFixtureDays(gFetched, kFixtureFallBack, 2);
+  TEST_ASSERT_FALSE(hasNewPriceInfo(gFetched, gCurrent));
+
+  gFetched.points[50].rawPrice += 10;
+  gFetched.fingerprint = priceStateFingerprint(gFetched);
+  TEST_ASSERT_TRUE(hasNewPriceInfo(gFetched, gCurrent));
+
+  fillFixtureDays(gFetched, kFixtureFallBack, 2);
+  gFetched.points[50].level = PriceLevel::VeryExpensive;
+  gFetched.fingerprint = priceStateFingerprint(gFetched);
+  TEST_ASSERT_TRUE(hasNewPriceInfo(gFetched, gCurrent));
+}
+
+void test_tomorrow_arriving_is_new_info() {
+  fillFixtureDays(gCurrent, kFixtureSpringForward, 1);
+  fillFixtureDays(gFetched, kFixtureSpringForward, 2);
+  TEST_ASSERT_EQUAL(92 + 96, gFetched.count);
+  TEST_ASSERT_TRUE(hasNewPriceInfo(gFetched, gCurrent));
+  TEST_ASSERT_FALSE(wouldReduceCoverage(gFetched, gCurrent));
+}
+
+void test_fewer_points_reduce_coverage() {
+  fillFixtureDays(gCurrent, kFixtureFallBack, 2);
+  fillFixtureDays(gFetched, kFixtureFallBack, 1);
+  TEST_ASSERT_TRUE(wouldReduceCoverage(gFetched, gCurrent));
+}
+
+void test_fewer_days_reduce_coverage() {
+  // Same point count: 100 slots of the fall-back day against a whole day
+  // plus the first hour of the next.
+  fillFixtureDays(gCurrent, kFixturePlainDay, 2);
+  gCurrent.count = 100;
+  fillFixtureDays(gFetched, kFixtureFallBack, 1);
+  TEST_ASSERT_EQUAL(100, gFetched.count);
+  TEST_ASSERT_TRUE(wouldReduceCoverage(gFetched, gCurrent));
+}
+
+void test_rolled_off_dst_day_keeps_coverage() {
+  // Yesterday was the 25-hour fall-back day: 100 + 96 against 96 + 96.
+  fillFixtureDays(gCurrent, kFixtureFallBack, 2);
+  fillFixtureDays(gFetched, FixtureDay{2025, 10, 27}, 2);
+  TEST_ASSERT_FALSE(wouldReduceCoverage(gFetched, gCurrent));
+  // And the day before the 23-hour spring-forward day: 96 + 96 against 92 + 96.
+  fillFixtureDays(gCurrent, FixtureDay{2025, 3, 29}, 2);
+  fillFixtureDays(gFetched, kFixtureSpringForward, 2);
+  TEST_ASSERT_FALSE(wouldReduceCoverage(gFetched, gCurrent));
+  // Only today before tomorrow is published still keeps yesterday and today.
+  fillFixtureDays(gFetched, kFixtureSpringForward, 1);
+  TEST_ASSERT_TRUE(wouldReduceCoverage(gFetched, gCurrent));
+}
+
+void test_coverage_ignores_unusable_states() {
+  fillFixtureDays(gCurrent, kFixturePlainDay, 2);
+  gFetched = PriceState();
+  TEST_ASSERT_FALSE(wouldReduceCoverage(gFetched, gCurrent));
+  fillFixtureDays(gFetched, kFixturePlainDay, 1);
+  gCurrent = PriceState();
+  TEST_ASSERT_FALSE(wouldReduceCoverage(gFetched, gCurrent));
+  fillFixtureDays(gCurrent, kFixturePlainDay, 2);
+  fillFixtureDays(gFetched, kFixturePlainDay, 2);
+  TEST_ASSERT_FALSE(wouldReduceCoverage(gFetched, gCurrent));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_new_info_needs_ok_fetched_prices);
+  RUN_TEST(test_new_info_against_empty_current);
+  RUN_TEST(test_new_info_compares_fingerprints);
+  RUN_TEST(test_tomorrow_arriving_is_new_info);
+  RUN_TEST(test_fewer_points_reduce_coverage);
+  RUN_TEST(test_fewer_days_reduce_coverage);
+  RUN_TEST(test_rolled_off_dst_day_keeps_coverage);
+  RUN_TEST(test_coverage_ignores_unusable_states);
+  return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include <unity.h>
+
+#include "nordpool_publish_stats.h"
+#include "price_fixtures.h"
+#include "time_utils.h"
+
+// Publication learning as main.cpp drives it: a poll that found no new day
+// (missedAt) followed by the poll that did (seenAt) adds one sample.
+
+namespace {
+PublishStats gStats;
+
+time_t utc(const char *iso) {
+  return utcIsoToEpoch(iso);
+}
+}  // namespace
+
+void setUp() {
+  selectTimezone(kTimezoneCetCest);
+  resetPublishStats(gStats, "SE3");
+}
+
+void tearDown() {}
+
+void test_default_window_until_min_samples() {
+  const PublishWindow window = publishWindow(gStats);
+  TEST_ASSERT_FALSE(window.learned);
+  TEST_ASSERT_EQUAL(12 * 60 + 30, window.firstMinute);
+  TEST_ASSERT_EQUAL(13 * 60 + 30, window.lastMinute);
+}
+
+void test_observed_uses_midpoint() {
+  // 12:56 and 13:00 local (CET).
+  TEST_ASSERT_TRUE(notePublishObserved(gStats, utc("2025-01-15T11:56:00Z"), utc("2025-01-15T12:00:00Z")));
+  TEST_ASSERT_EQUAL(1, gStats.count);
+  TEST_ASSERT_EQUAL(12 * 60 + 58, gStats.minutes[0]);
+}
+
+void test_observed_rejects_loose_brackets() {
+  // Over the gap limit, reversed, across local midnight, or no valid clock.
+  TEST_ASSERT_FALSE(notePublishObserved(gStats, utc("2025-01-15T11:00:00Z"), utc("2025-01-15T12:00:00Z")));
+  TEST_ASSERT_FALSE(notePublishObserved(gStats, utc("2025-01-15T12:00:00Z"), utc("2025-01-15T11:58:00Z")));
+  TEST_ASSERT_FALSE(notePublishObserved(gStats, utc("2025-01-15T22:50:00Z"), utc("2025-01-15T23:05:00Z")));
+  TEST_ASSERT_FALSE(notePublishObserved(gStats, 0, utc("2025-01-15T12:00:00Z")));
+  TEST_ASSERT_EQUAL(0, gStats.count);
+}
+
+void test_published_before_window_only_at_first_poll() {
+  const PublishWindow window = publishWindow(gStats);
+  TEST_ASSERT_FALSE(notePublishedBeforeWindow(gStats, utc("2025-01-15T12:00:00Z"), window));
+  TEST_ASSERT_TRUE(notePublishedBeforeWindow(gStats, utc("2025-01-15T11:30:40Z"), window));
+  TEST_ASSERT_EQUAL(1, gStats.count);
+  TEST_ASSERT_EQUAL(window.firstMinute, gStats.minutes[0]);
+}
+
+void test_samples_grow_daily_until_learned() {
+  // Steady state: the poll at 12:58 misses, the one at 13:00 sees the new day.
+  const time_t missed = utc("2025-01-15T11:58:00Z");
+  for (int day = 0; day < 5; ++day) {
+    const time_t missedAt = missed + day * 86400;
+    TEST_ASSERT_TRUE(notePublishObserved(gStats, missedAt, missedAt + 2 * 60));
+    TEST_ASSERT_EQUAL(day + 1, gStats.count);
+    TEST_ASSERT_EQUAL(day + 1 >= (int)kPublishStatsMinSamples, publishWindow(gStats).learned);
+  }
+
+  const PublishWindow window = publishWindow(gStats);
+  TEST_ASSERT_EQUAL(12 * 60 + 49, window.firstMinute);
+  TEST_ASSERT_EQUAL(13 * 60 + 9, window.lastMinute);
+}
+
+void test_samples_wrap_at_capacity() {
+  const time_t missed = utc("2025-01-15T11:58:00Z");
+  for (int day = 0; day < (int)kPublishStatsMaxSamples + 2; ++day) {
+    const time_t missedAt = missed + day * 86400;
+    TEST_ASSERT_TRUE(notePublishObserved(gStats, missedAt, missedAt + 2 * 60));
+  }
+  TEST_ASSERT_EQUAL(kPublishStatsMaxSamples, gStats.count);
+  TEST_ASSERT_EQUAL(2, gStats.head);
+}
+
+void test_retry_delay_by_window_phase() {
+  const PublishWindow window = publishWindow(gStats);
+  // 12:00 local: sparse poll, capped before the window opens.
+  TEST_ASSERT_EQUAL(kPublishSparsePollSec, publishRetryDelaySec(utc("2025-01-15T11:00:00Z"), window));
+  // 12:25 local: land on the window start.
+  TEST_ASSERT_EQUAL(5 * 60, publishRetryDelaySec(utc("2025-01-15T11:25:00Z"), window));
+  TEST_ASSERT_EQUAL(kPublishTightPollSec, publishRetryDelaySec(utc("2025-01-15T11:45:00Z"), window));
+  TEST_ASSERT_EQUAL(kPublishSparsePollSec, publishRetryDelaySec(utc("2025-01-15T13:00:00Z"), window));
+}
+
+void test_first_poll_after() {
+  const PublishWindow window = publishWindow(gStats);
+  TEST_ASSERT_EQUAL(utc("2025-01-15T11:30:00Z"), publishFirstPollAfter(utc("2025-01-15T09:00:00Z"), window));
+  TEST_ASSERT_EQUAL(utc("2025-01-16T11:30:00Z"), publishFirstPollAfter(utc("2025-01-15T12:00:00Z"), window));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_default_window_until_min_samples);
+  RUN_TEST(test_observed_uses_midpoint);
+  RUN_TEST(test_observed_rejects_loose_brackets);
+  RUN_TEST(test_published_before_window_only_at_first_poll);
+  RUN_TEST(test_samples_grow_daily_until_learned);
+  RUN_TEST(test_samples_wrap_at_capacity);
+  RUN_TEST(test_retry_delay_by_window_phase);
+  RUN_TEST(test_first_poll_after);
+  return UNITY_END();
+}
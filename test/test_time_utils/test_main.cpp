@@ -0,0 +1,132 @@
+#include <unity.h>
+
+#include "price_fixtures.h"
+#include "time_utils.h"
+
+// The Nord Pool key helpers are utcIsoToEpoch (deliveryStart to slot key),
+// formatLocalSlot (slot key to local "YYYY-MM-DDTHH:MM") and
+// intervalStartForTime (any instant to its slot key).
+
+namespace {
+PriceState gState;
+
+time_t utc(const char *iso) {
+  return utcIsoToEpoch(iso);
+}
+
+const char *localSlot(const char *iso) {
+  static char text[20];
+  if (!formatLocalSlot(utc(iso), text, sizeof(text))) return "";
+  return text;
+}
+}  // namespace
+
+void setUp() {
+  selectTimezone(kTimezoneCetCest);
+}
+
+void tearDown() {}
+
+void test_utc_iso_to_epoch() {
+  TEST_ASSERT_EQUAL(1743294600, utc("2025-03-30T00:30:00Z"));
+  TEST_ASSERT_EQUAL(1743294600, utc("2025-03-30T00:30:00.000Z"));
+  TEST_ASSERT_EQUAL(0, utc("2025-03-30"));
+  TEST_ASSERT_EQUAL(0, utc("garbage"));
+  TEST_ASSERT_EQUAL(0, utc(nullptr));
+}
+
+void test_local_slot_across_spring_forward() {
+  TEST_ASSERT_EQUAL_STRING("2025-03-30T01:45", localSlot("2025-03-30T00:45:00Z"));
+  // 02:00-02:59 local does not exist that night.
+  TEST_ASSERT_EQUAL_STRING("2025-03-30T03:00", localSlot("2025-03-30T01:00:00Z"));
+  TEST_ASSERT_EQUAL_STRING("2025-03-29T23:00", localSlot("2025-03-29T22:00:00Z"));
+}
+
+void test_local_slot_across_fall_back() {
+  // 02:00-02:59 local happens twice; both map to the same text.
+  TEST_ASSERT_EQUAL_STRING("2025-10-26T02:15", localSlot("2025-10-26T00:15:00Z"));
+  TEST_ASSERT_EQUAL_STRING("2025-10-26T02:15", localSlot("2025-10-26T01:15:00Z"));
+  TEST_ASSERT_EQUAL_STRING("2025-10-26T03:00", localSlot("2025-10-26T02:00:00Z"));
+}
+
+void test_local_slot_eet_zone() {
+  selectTimezone(kTimezoneEetEest);
+  TEST_ASSERT_EQUAL_STRING("2025-01-15T02:00", localSlot("2025-01-15T00:00:00Z"));
+  TEST_ASSERT_EQUAL_STRING("2025-07-01T03:00", localSlot("2025-07-01T00:00:00Z"));
+}
+
+void test_interval_start_for_time() {
+  const time_t slot = utc("2025-10-26T01:15:00Z");
+  TEST_ASSERT_EQUAL(slot, intervalStartForTime(slot, 15));
+  TEST_ASSERT_EQUAL(slot, intervalStartForTime(slot + 14 * 60 + 59, 15));
+  TEST_ASSERT_EQUAL(slot + 15 * 60, intervalStartForTime(slot + 15 * 60, 15));
+  TEST_ASSERT_EQUAL(utc("2025-10-26T01:00:00Z"), intervalStartForTime(slot, 30));
+  TEST_ASSERT_EQUAL(utc("2025-10-26T01:00:00Z"), intervalStartForTime(slot, 60));
+  // Unsupported resolutions are treated as hourly.
+  TEST_ASSERT_EQUAL(utc("2025-10-26T01:00:00Z"), intervalStartForTime(slot, 20));
+}
+
+void test_dst_days_have_92_and_100_slots() {
+  fillFixtureDays(gState, kFixtureSpringForward, 1);
+  TEST_ASSERT_EQUAL(92, gState.count);
+  fillFixtureDays(gState, kFixtureFallBack, 1);
+  TEST_ASSERT_EQUAL(100, gState.count);
+  fillFixtureDays(gState, kFixturePlainDay, 2);
+  TEST_ASSERT_EQUAL(192, gState.count);
+  TEST_ASSERT_TRUE(gState.slotsUniform);
+}
+
+void test_find_index_uniform_two_days() {
+  const FixtureDay days[] = {kFixturePlainDay, kFixtureSpringForward, kFixtureFallBack};
+  for (const FixtureDay &day : days) {
+    fillFixtureDays(gState, day, 2);
+    TEST_ASSERT_TRUE(gState.slotsUniform);
+    for (size_t i = 0; i < gState.count; ++i) {
+      TEST_ASSERT_EQUAL((int)i, findPricePointIndexForInterval(gState, (time_t)gState.points[i].startsAt, 15));
+    }
+    const time_t first = (time_t)gState.points[0].startsAt;
+    const time_t last = (time_t)gState.points[gState.count - 1].startsAt;
+    TEST_ASSERT_EQUAL(-1, findPricePointIndexForInterval(gState, first - kFixtureSlotSec, 15));
+    TEST_ASSERT_EQUAL(-1, findPricePointIndexForInterval(gState, last + kFixtureSlotSec, 15));
+  }
+  TEST_ASSERT_EQUAL(-1, findPricePointIndexForInterval(gState, 0, 15));
+}
+
+void test_find_index_gapped_series_scans() {
+  fillFixtureDays(gState, kFixtureFallBack, 2);
+  // Drop one slot so the series is no longer uniform.
+  const size_t gap = 10;
+  const time_t after = (time_t)gState.points[gap + 1].startsAt;
+  const time_t missing = (time_t)gState.points[gap].startsAt;
+  memmove(&gState.points[gap], &gState.points[gap + 1], (gState.count - gap - 1) * sizeof(PricePoint));
+  --gState.count;
+  updatePriceStateSlotIndex(gState);
+  TEST_ASSERT_FALSE(gState.slotsUniform);
+  TEST_ASSERT_EQUAL(-1, findPricePointIndexForInterval(gState, missing, 15));
+  TEST_ASSERT_EQUAL((int)gap, findPricePointIndexForInterval(gState, after, 15));
+  TEST_ASSERT_EQUAL((int)gState.count - 1,
+                    findPricePointIndexForInterval(gState, (time_t)gState.points[gState.count - 1].startsAt, 15));
+}
+
+void test_find_index_coarser_resolution() {
+  fillFixtureDays(gState, kFixturePlainDay, 2);
+  // An hourly lookup in a 15-minute series lands on the hour's first quarter.
+  const time_t hour = (time_t)gState.points[8].startsAt;
+  TEST_ASSERT_EQUAL(8, findPricePointIndexForInterval(gState, hour, 60));
+  TEST_ASSERT_EQUAL(8, findPricePointIndexForInterval(gState, hour, 30));
+  TEST_ASSERT_EQUAL(10, findPricePointIndexForInterval(gState, hour + 30 * 60, 30));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_utc_iso_to_epoch);
+  RUN_TEST(test_local_slot_across_spring_forward);
+  RUN_TEST(test_local_slot_across_fall_back);
+  RUN_TEST(test_local_slot_eet_zone);
+  RUN_TEST(test_interval_start_for_time);
+  RUN_TEST(test_dst_days_have_92_and_100_slots);
+  RUN_TEST(test_find_index_uniform_two_days);
+  RUN_TEST(test_find_index_gapped_series_scans);
+  RUN_TEST(test_find_index_coarser_resolution);
+  return UNITY_END();
+}